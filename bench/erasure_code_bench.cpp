@@ -0,0 +1,103 @@
+// Measures the throughput of encoding and decoding by the erasure code for every instruction set supported by the CPU
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "erasure_code.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr size_t kColumnLength{256 * 1024};
+constexpr auto kDuration{std::chrono::milliseconds{500}};
+
+struct Geometry {
+    size_t data;
+    size_t parity;
+};
+
+constexpr Geometry kGeometries[]{{4, 1}, {8, 1}, {4, 2}, {8, 2}, {12, 2}};
+
+// Runs f repeatedly for the duration given, returns the throughput in GiB/s of the data processed per run
+template <typename F>
+double throughput(size_t bytes, F&& f)
+{
+    using clock = std::chrono::steady_clock;
+
+    size_t runs{0};
+    auto const start = clock::now();
+    auto elapsed     = clock::duration{};
+    for (; elapsed < kDuration; elapsed = clock::now() - start, ++runs)
+        f();
+
+    return static_cast<double>(bytes * runs) / std::chrono::duration<double>(elapsed).count() / (1 << 30);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::mt19937_64 rng{std::random_device{}()};
+
+    std::cout << std::left << std::setw(8) << "isa" << std::setw(10) << "geometry" << std::right << std::setw(12) << "encode" << std::setw(12)
+              << "decode-1" << std::setw(12) << "decode-2" << "  (GiB/s of data)\n";
+
+    for (auto const isa : {ErasureCode::Isa::kScalar, ErasureCode::Isa::kAvx2, ErasureCode::Isa::kAvx512}) {
+        if (!ErasureCode::supported(isa))
+            continue;
+
+        for (auto const [data, parity] : kGeometries) {
+            ErasureCode const code{data, parity, isa};
+
+            std::vector<std::byte> buf((data + parity) * kColumnLength);
+            for (auto& b : buf)
+                b = static_cast<std::byte>(rng());
+
+            std::vector<std::byte*> columns(data + parity);
+            for (size_t i = 0; i < columns.size(); ++i)
+                columns[i] = buf.data() + i * kColumnLength;
+            std::vector<std::byte const*> const data_columns(columns.begin(), columns.begin() + data);
+
+            auto const bytes = data * kColumnLength;
+            auto const enc   = throughput(bytes, [&] { code.encode(data_columns, std::span{columns}.subspan(data), kColumnLength); });
+
+            // a copy of the columns, so that the columns rebuilt are verified
+            auto const expected = buf;
+
+            std::vector<double> dec;
+            for (size_t lost_count = 1; lost_count <= parity; ++lost_count) {
+                std::vector<size_t> lost(lost_count);
+                for (size_t i = 0; i < lost_count; ++i)
+                    lost[i] = i * (data - 1) / std::max<size_t>(1, lost_count - 1);
+
+                dec.push_back(throughput(bytes, [&] {
+                    if (!code.decode(columns, lost, kColumnLength))
+                        std::abort();
+                }));
+
+                if (expected != buf) {
+                    std::cerr << "columns rebuilt by " << ErasureCode::name(isa) << " differ from the ones lost\n";
+                    return EXIT_FAILURE;
+                }
+            }
+
+            std::cout << std::left << std::setw(8) << ErasureCode::name(isa) << std::setw(10)
+                      << (std::to_string(data) + "+" + std::to_string(parity)) << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << enc;
+            for (auto const d : dec)
+                std::cout << std::setw(12) << d;
+            std::cout << '\n';
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+// Measures how long rebuilding the metadata by scanning the backends takes, the worst case of mounting a file system. The chunk files are
+// created empty in the fan-out trees of the backends under the directory given and scanned once the numbers of chunk files given are reached,
+// so the metadata of the chunk files is usually cached by the kernel, drop the caches in between to measure cold scans.
+//
+// Usage: metadata_scanner_bench <directory> [chunk files...], 1000000 and 10000000 chunk files by default
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "backend.hpp"
+#include "chunk_name.hpp"
+#include "file_system_reflector.hpp"
+#include "layout.hpp"
+#include "metadata_replayer_interface.hpp"
+#include "metadata_scanner.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr size_t kBackends{4};
+constexpr size_t kFileChunks{16}; ///< Number of chunks every file consists of, they are spread over the backends round-robin
+constexpr size_t kChunkSize{64 * 1024 * 1024};
+constexpr uint64_t kSalt{0x6d756c746966737f};
+
+// Counts the records replayed, the file system is not built to measure the scan alone
+class Counter final : public IMetadataReplayer
+{
+public:
+    size_t inodes{0};
+    size_t chunk_files{0};
+    size_t links{0};
+
+    void inode(InodeRecord const& /*record*/) override { ++inodes; }
+    void chunk(ChunkRecord const& record) override { chunk_files += record.backends.size(); }
+    void chunks(uint64_t /*ino*/, size_t /*count*/) override {}
+    void link(std::string_view /*name*/, uint64_t /*ino*/) override { ++links; }
+    void unlink(std::string_view /*name*/) override {}
+};
+
+// Creates the chunk files of the files numbered in the range given
+bool populate(std::vector<std::filesystem::path> const& dirs, size_t first_file, size_t last_file)
+{
+    for (auto file_idx = first_file; file_idx < last_file; ++file_idx) {
+        for (size_t chunk_idx = 0; chunk_idx < kFileChunks; ++chunk_idx) {
+            auto const path = dirs[(file_idx + chunk_idx) % dirs.size()] / (chunk_base(kSalt, file_idx).substr(1) + '.' + std::to_string(chunk_idx));
+            auto fd         = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                std::error_code ec;
+                std::filesystem::create_directories(path.parent_path(), ec);
+                fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            }
+            if (fd < 0)
+                return false;
+            ::close(fd);
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <directory> [chunk files...]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<size_t> counts;
+    for (int i = 2; i < argc; ++i)
+        counts.push_back(std::stoull(argv[i]));
+    if (counts.empty())
+        counts = {1'000'000, 10'000'000};
+    std::ranges::sort(counts);
+
+    std::filesystem::path const root{std::filesystem::absolute(argv[1]) / "multifs-scan-bench"};
+    std::filesystem::remove_all(root);
+
+    std::vector<std::filesystem::path> dirs;
+    std::vector<std::shared_ptr<Backend>> backends;
+    for (size_t i = 0; i < kBackends; ++i) {
+        auto const& dir = dirs.emplace_back(root / std::to_string(i));
+        std::filesystem::create_directories(dir);
+        backends.push_back(std::make_shared<Backend>(std::make_shared<FileSystemReflector>(dir), 1, Tier::kFast, dir.string()));
+    }
+
+    MetadataScanner const scanner{Layout{.chunk_size = kChunkSize}, 0};
+
+    std::cout << std::right << std::setw(12) << "chunk files" << std::setw(12) << "files" << std::setw(12) << "scan s" << std::setw(16) << "chunk files/s"
+              << '\n';
+
+    size_t files{0};
+    for (auto const count : counts) {
+        auto const target = (count + kFileChunks - 1) / kFileChunks;
+        if (!populate(dirs, files, target)) {
+            std::cerr << "failed to create chunk files in " << root << '\n';
+            return EXIT_FAILURE;
+        }
+        files = target;
+
+        Counter counter;
+        auto const start   = std::chrono::steady_clock::now();
+        scanner.scan(backends, counter);
+        auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // the files are recovered in /lost+found, which is made by the scan
+        if (counter.inodes != files + 1 || counter.links != files + 1 || counter.chunk_files != files * kFileChunks) {
+            std::cerr << "files found by the scan are wrong\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::setw(12) << counter.chunk_files << std::setw(12) << files << std::fixed << std::setprecision(2) << std::setw(12) << elapsed
+                  << std::setprecision(0) << std::setw(16) << static_cast<double>(counter.chunk_files) / elapsed << '\n';
+    }
+
+    std::filesystem::remove_all(root);
+
+    return EXIT_SUCCESS;
+}
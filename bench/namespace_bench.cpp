@@ -0,0 +1,150 @@
+// Measures the memory the namespace takes and how long looking a path up takes. The namespace is a tree of directories of the numbers
+// of entries given. It is built twice: with every entry referring to the same inode, so the memory measured is the one of the entries and
+// their names alone, and with every entry referring to a file of its own holding a single chunk, the common case of small files.
+//
+// Usage: namespace_bench [entries per directory] [directories], 1000 entries in every one of 1000 directories by default
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <malloc.h>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "backend.hpp"
+#include "chunk_name.hpp"
+#include "directory.hpp"
+#include "file.hpp"
+#include "file_system_reflector.hpp"
+#include "inode.hpp"
+#include "layout.hpp"
+#include "metadata_record.hpp"
+#include "name_arena.hpp"
+#include "placement.hpp"
+#include "placement/most_free_space.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr size_t kLookups{10'000'000};
+
+size_t heap_used() noexcept { return ::mallinfo2().uordblks; }
+
+struct Result {
+    double bytes;  ///< Heap taken per entry
+    double insert; ///< Seconds taken per entry inserted
+    double lookup; ///< Seconds taken per path looked up
+};
+
+// Builds the namespace, the inode of every entry is made by the function given
+template <typename F>
+Result measure(std::vector<std::string> const& dir_names, std::vector<std::string> const& entry_names, F make_inode)
+{
+    auto const heap_start = heap_used();
+
+    auto const names = std::make_shared<NameArena>();
+    auto const root  = std::make_shared<INode>(std::in_place_type<Directory>, names, 0755, 0, 0);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& dir_name : dir_names) {
+        auto const dir = std::make_shared<INode>(std::in_place_type<Directory>, names, 0755, 0, 0);
+        for (auto const& entry_name : entry_names)
+            std::get<Directory>(*dir).insert(entry_name, make_inode());
+        std::get<Directory>(*root).insert(dir_name, dir);
+    }
+    auto const inserted = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto const total = dir_names.size() * entry_names.size();
+    auto const bytes = static_cast<double>(heap_used() - heap_start) / total;
+
+    // the paths are looked up component by component the way the file system does, in an order the caches do not help with
+    std::vector<std::pair<uint32_t, uint32_t>> paths(1 << 20);
+    std::mt19937_64 rng{42};
+    for (auto& [dir_idx, entry_idx] : paths) {
+        dir_idx   = static_cast<uint32_t>(rng() % dir_names.size());
+        entry_idx = static_cast<uint32_t>(rng() % entry_names.size());
+    }
+
+    size_t found{0};
+    auto const lookup_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kLookups; ++i) {
+        auto const& [dir_idx, entry_idx] = paths[i % paths.size()];
+        auto const* dir                  = std::get<Directory>(*root).find(dir_names[dir_idx]);
+        found += nullptr != std::get<Directory>(**dir).find(entry_names[entry_idx]);
+    }
+    auto const looked_up = std::chrono::duration<double>(std::chrono::steady_clock::now() - lookup_start).count();
+
+    if (found != kLookups)
+        throw std::runtime_error("entries looked up are missing");
+
+    return {bytes, inserted / total, looked_up / kLookups};
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    size_t const entries = argc > 1 ? std::stoull(argv[1]) : 1000;
+    size_t const dirs    = argc > 2 ? std::stoull(argv[2]) : 1000;
+
+    std::vector<std::string> dir_names;
+    std::vector<std::string> entry_names;
+    for (size_t i = 0; i < dirs; ++i)
+        dir_names.push_back("directory-" + std::to_string(i));
+    for (size_t i = 0; i < entries; ++i)
+        entry_names.push_back("file-" + std::to_string(i) + ".dat");
+
+    // the backend is never accessed, the chunks are merely recorded to reside on it
+    auto const backend   = std::make_shared<Backend>(std::make_shared<FileSystemReflector>(std::filesystem::temp_directory_path()), 1, Tier::kFast, "0");
+    auto const placement = std::make_shared<Placement>(std::vector{backend}, std::make_unique<placement::MostFreeSpace>());
+    std::array const backends{backend};
+
+    auto const leaf  = std::make_shared<INode>(std::in_place_type<Directory>, nullptr, 0755, 0, 0);
+    auto const index = measure(dir_names, entry_names, [&] { return leaf; });
+
+    auto const base = chunk_base(0, 1);
+    InodeRecord record{
+        .ino        = 0,
+        .kind       = InodeRecord::Kind::kFile,
+        .mode       = S_IFREG | 0644,
+        .owner_uid  = 0,
+        .owner_gid  = 0,
+        .flags      = 0,
+        .size       = 4096,
+        .atime      = {},
+        .mtime      = {},
+        .ctime      = {},
+        .layout     = Layout{},
+        .zero_block = 0,
+        .data       = base,
+    };
+    auto const files = measure(dir_names, entry_names, [&] {
+        auto inode = std::make_shared<INode>(std::in_place_type<File>, record, placement);
+        std::get<File>(*inode).restore_chunk(0, {}, backends);
+        std::get<File>(*inode).restore_chunks(1);
+        return inode;
+    });
+
+    std::cout << std::right << std::setw(12) << "entries" << std::setw(10) << "inodes" << std::setw(16) << "bytes/entry" << std::setw(16)
+              << "insert ns/op" << std::setw(16) << "lookup ns/op" << '\n';
+    for (auto const& [inodes, result] : {std::pair{"shared", index}, std::pair{"files", files}}) {
+        std::cout << std::setw(12) << entries * dirs << std::setw(10) << inodes << std::fixed << std::setprecision(1) << std::setw(16) << result.bytes
+                  << std::setw(16) << result.insert * 1e9 << std::setw(16) << result.lookup * 1e9 << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
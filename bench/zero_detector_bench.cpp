@@ -0,0 +1,90 @@
+// Measures the cost of scanning written blocks for zeros for every instruction set supported by the CPU, the blocks are scanned as a whole
+// when they hold zeros only or their last byte only is not zero, whereas blocks of data are usually given up on at the first cache line
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "zero_detector.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr size_t kBufferSize{64 * 1024 * 1024};
+constexpr size_t kBlockSizes[]{4 * 1024, 64 * 1024, 1024 * 1024};
+constexpr auto kDuration{std::chrono::milliseconds{500}};
+
+// Runs f repeatedly for the duration given, returns the throughput in GiB/s of the data processed per run
+template <typename F>
+double throughput(size_t bytes, F&& f)
+{
+    using clock = std::chrono::steady_clock;
+
+    size_t runs{0};
+    auto const start = clock::now();
+    auto elapsed     = clock::duration{};
+    for (; elapsed < kDuration; elapsed = clock::now() - start, ++runs)
+        f();
+
+    return static_cast<double>(bytes * runs) / std::chrono::duration<double>(elapsed).count() / (1 << 30);
+}
+
+// Scans the buffer block by block the way writes are, returns the number of blocks found holding zeros only
+size_t scan(ZeroDetector const& detector, std::vector<std::byte> const& buf, size_t block_size)
+{
+    size_t zeros{0};
+    for (size_t offset = 0; offset < buf.size(); offset += block_size)
+        zeros += detector.zero({buf.data() + offset, block_size});
+    return zeros;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    std::mt19937_64 rng{std::random_device{}()};
+
+    std::vector<std::byte> zeros(kBufferSize);
+    std::vector<std::byte> data(kBufferSize);
+    for (auto& b : data)
+        b = static_cast<std::byte>(rng() | 1);
+
+    std::cout << std::left << std::setw(8) << "isa" << std::setw(8) << "block" << std::right << std::setw(12) << "zeros" << std::setw(12) << "last-byte"
+              << std::setw(12) << "data" << std::setw(14) << "zeros ms/GiB" << "  (GiB/s scanned)\n";
+
+    for (auto const isa : {ZeroDetector::Isa::kScalar, ZeroDetector::Isa::kSse2, ZeroDetector::Isa::kAvx2}) {
+        if (!ZeroDetector::supported(isa))
+            continue;
+
+        ZeroDetector const detector{isa};
+        for (auto const block_size : kBlockSizes) {
+            // the worst case of data, every block but its last byte holds zeros
+            auto last_byte = zeros;
+            for (size_t offset = block_size - 1; offset < last_byte.size(); offset += block_size)
+                last_byte[offset] = std::byte{1};
+
+            size_t found{0};
+            auto const z = throughput(kBufferSize, [&] { found += scan(detector, zeros, block_size); });
+            auto const l = throughput(kBufferSize, [&] { found += scan(detector, last_byte, block_size); });
+            auto const d = throughput(kBufferSize, [&] { found += scan(detector, data, block_size); });
+
+            if (0 == found || 0 != scan(detector, last_byte, block_size) + scan(detector, data, block_size)) {
+                std::cerr << "blocks found by " << ZeroDetector::name(isa) << " are wrong\n";
+                return EXIT_FAILURE;
+            }
+
+            std::cout << std::left << std::setw(8) << ZeroDetector::name(isa) << std::setw(8) << (std::to_string(block_size / 1024) + "K") << std::right
+                      << std::fixed << std::setprecision(2) << std::setw(12) << z << std::setw(12) << l << std::setw(12) << d << std::setw(14) << 1000 / z
+                      << '\n';
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
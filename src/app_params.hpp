@@ -1,14 +1,35 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <filesystem>
 #include <list>
 
+#include "layout.hpp"
+#include "mount_point.hpp"
+
 namespace multifs
 {
 
+enum class PlacementPolicyKind : uint8_t {
+    kMostFreeSpace,
+    kWeightedRoundRobin,
+    kLeastLatency,
+    kSpreadWriters,
+};
+
 struct app_params {
     bool show_help;
-    std::list<std::filesystem::path> mpts; ///< Mount points
+    std::list<mount_point> mpts;                                       ///< Mount points
+    Layout layout;                                                     ///< Layout of files being created
+    PlacementPolicyKind placement{PlacementPolicyKind::kMostFreeSpace}; ///< Policy of placing new chunks
+    size_t rebalance_rate{64 * 1024 * 1024};                           ///< Bytes per second chunks are moved between backends at, 0 disables it
+    size_t chunk_pool{4};                                              ///< Number of chunk files created ahead on every backend, 0 disables it
+    size_t chunk_prealloc{0};                                          ///< Bytes allocated ahead for every chunk file created ahead
+    size_t zero_block{0};                                              ///< Size of the blocks of zeros written which are left holes, 0 disables it
+    std::filesystem::path metadata;                                    ///< Directory the namespace is kept in, it lives in memory only if none
+    bool low_level{false};                                             ///< Whether the requests are served over the low-level API of FUSE
 #ifndef NDEBUG
     std::filesystem::path logp; ///< Log path
 #endif
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include "chunk_name.hpp"
+#include "chunk_pool.hpp"
+#include "file_system_interface.hpp"
+#include "reaper.hpp"
+
+namespace multifs
+{
+
+// Storage class of a backend, new chunks are placed on the fast tier and the cold ones get moved to the slow tier
+enum class Tier : uint8_t {
+    kFast,
+    kSlow,
+};
+
+// An underlying file system chunks are placed on, it keeps track of the statistics placement policies rely on
+class Backend final : public IFileSystem
+{
+private:
+    static constexpr std::chrono::seconds kStatfsTTL{1};
+    static constexpr size_t kLatencyBuckets{64};
+    static constexpr uint32_t kLatencyWindow{4096};    ///< Number of samples the latency histogram halves after
+    static constexpr uint32_t kLatencyMinSamples{128}; ///< Number of samples a percentile is not estimated below
+
+    std::shared_ptr<IFileSystem> fs_;
+    size_t bandwidth_; ///< Relative bandwidth configured for the backend
+    Tier tier_;
+    std::string name_; ///< Mount point the backend is known by
+
+    std::atomic<bool> draining_{false}; ///< Whether the chunks are being moved off the backend to remove it
+    std::shared_ptr<ChunkPool> pool_;   ///< Files new chunks are created out of, none if disabled
+    std::shared_ptr<Reaper> reaper_;    ///< Deletes the chunks discarded in the background
+
+    std::array<std::atomic<uint64_t>, 256 * 256 / 64> fanout_made_{}; ///< Leaves of the fan-out tree of the chunks known to exist, a bit each
+
+    mutable std::atomic<uint64_t> latency_ns_{0}; ///< Exponentially weighted moving average of read/write latencies
+    mutable std::atomic<uint32_t> inflight_{0};   ///< Number of read/write requests being executed
+    std::atomic<uint32_t> writers_{0};            ///< Number of files being written to the backend
+
+    mutable std::array<std::atomic<uint32_t>, kLatencyBuckets> read_latencies_{}; ///< Histogram of read latencies by powers of two of nanoseconds
+    mutable std::atomic<uint32_t> read_samples_{0};
+
+    mutable std::mutex statfs_mtx_;
+    mutable std::chrono::steady_clock::time_point statfs_time_;
+    mutable size_t free_space_{0};
+    mutable size_t total_space_{0};
+    mutable size_t block_size_{0};
+    mutable size_t consumed_{0};  ///< Bytes written since the space was requested last, which the space cached is short of
+    mutable uint64_t reclaims_{0}; ///< Number of files the reaper had unlinked when the space was requested last
+    size_t reserved_{0};          ///< Bytes reserved for the files being written to grow by
+
+    void statfs_refresh() const
+    {
+        // the space freed by the files unlinked in the background is picked up right away rather than once the cache expires
+        auto const now      = std::chrono::steady_clock::now();
+        auto const reclaims = reaper_->reclaimed();
+        if (statfs_time_ + kStatfsTTL <= now || reclaims_ != reclaims) {
+            // clang-format off
+            struct statvfs stbuf {};
+            // clang-format on
+            if (0 == fs_->statfs("/", stbuf)) {
+                free_space_  = stbuf.f_bavail * stbuf.f_frsize;
+                total_space_ = stbuf.f_blocks * stbuf.f_frsize;
+                block_size_  = stbuf.f_bsize;
+                consumed_    = 0;
+            }
+            statfs_time_ = now;
+            reclaims_    = reclaims;
+        }
+    }
+
+    size_t available() const noexcept { return free_space_ - std::min(free_space_, consumed_ + reserved_); }
+
+    template <typename F>
+    auto metered(F&& f, bool read) const
+    {
+        inflight_.fetch_add(1, std::memory_order_relaxed);
+        auto const start = std::chrono::steady_clock::now();
+        auto const res   = std::forward<F>(f)();
+        auto const ns    = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        // racy updates merely lose samples, that is fine for an estimation
+        auto const avg = latency_ns_.load(std::memory_order_relaxed);
+        latency_ns_.store(avg ? avg - avg / 8 + ns / 8 : ns, std::memory_order_relaxed);
+        if (read)
+            read_latency_add(ns);
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        return res;
+    }
+
+    void read_latency_add(uint64_t ns) const noexcept
+    {
+        read_latencies_[std::min<size_t>(std::bit_width(ns), kLatencyBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+        // the histogram halves once in a while, so that it follows the recent latencies
+        if (kLatencyWindow == read_samples_.fetch_add(1, std::memory_order_relaxed) + 1) {
+            read_samples_.store(0, std::memory_order_relaxed);
+            for (auto& bucket : read_latencies_)
+                bucket.store(bucket.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+    }
+
+    int create_file(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi)
+    {
+        if (pool_ && fi && O_RDWR == (fi->flags & (O_ACCMODE | O_APPEND | O_EXCL))) {
+            if (auto const r = pool_->take(path, mode, *fi); -EAGAIN != r)
+                return r;
+        }
+        return fs_->create(path, mode, fi);
+    }
+
+    // Makes the leaf of the fan-out tree the chunk is to be created in unless it is known to exist already, so that no file is taken out
+    // of the pool only to fail to be moved into a directory missing. The leaves are left behind once emptied, so each is made once
+    int fanout_make(std::filesystem::path const& path)
+    {
+        // the chunks are named /.multifs.chunks/<hh>/<hh>/<ID>.chunk, see chunk_base()
+        std::string_view const sv{path.native()};
+        if (!sv.starts_with(kChunkDir) || sv.size() < kChunkDir.size() + 7)
+            return 0;
+        auto const* p = sv.data() + kChunkDir.size();
+        unsigned hi{0};
+        unsigned lo{0};
+        if (std::errc{} != std::from_chars(p + 1, p + 3, hi, 16).ec || std::errc{} != std::from_chars(p + 4, p + 6, lo, 16).ec)
+            return 0;
+
+        auto const leaf = hi << 8 | lo;
+        auto& made      = fanout_made_[leaf / 64];
+        auto const bit  = uint64_t{1} << (leaf % 64);
+        if (made.load(std::memory_order_relaxed) & bit)
+            return 0;
+        if (auto const r = parents_make(path))
+            return r;
+        made.fetch_or(bit, std::memory_order_relaxed);
+        return 0;
+    }
+
+    int parents_make(std::filesystem::path const& path)
+    {
+        std::filesystem::path dir{path.root_path()};
+        for (auto const& name : path.relative_path().parent_path()) {
+            dir /= name;
+            if (auto const r = fs_->mkdir(dir, S_IRWXU); r && -EEXIST != r)
+                return r;
+        }
+        return 0;
+    }
+
+public:
+    explicit Backend(std::shared_ptr<IFileSystem> fs, size_t bandwidth = 1, Tier tier = Tier::kFast, std::string name = {})
+        : fs_(std::move(fs))
+        , bandwidth_(bandwidth)
+        , tier_(tier)
+        , name_(std::move(name))
+    {
+        if (!fs_)
+            throw std::invalid_argument("fs provided cannot be empty");
+        if (0 == bandwidth_)
+            throw std::invalid_argument("bandwidth of a backend must not be zero");
+        reaper_ = std::make_shared<Reaper>(fs_);
+    }
+    ~Backend() override = default;
+
+    Backend(Backend const&)            = delete;
+    Backend& operator=(Backend const&) = delete;
+
+    Backend(Backend&&)            = delete;
+    Backend& operator=(Backend&&) = delete;
+
+    [[nodiscard]] size_t bandwidth() const noexcept { return bandwidth_; }
+    [[nodiscard]] Tier tier() const noexcept { return tier_; }
+    [[nodiscard]] std::string const& name() const noexcept { return name_; }
+    [[nodiscard]] bool draining() const noexcept { return draining_.load(); }
+    // Marks the backend to get no new chunks and to have its chunks moved off
+    void drain() noexcept { draining_.store(true); }
+    [[nodiscard]] std::chrono::nanoseconds latency() const noexcept { return std::chrono::nanoseconds{latency_ns_.load(std::memory_order_relaxed)}; }
+    [[nodiscard]] uint32_t inflight() const noexcept { return inflight_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint32_t writers() const noexcept { return writers_.load(std::memory_order_relaxed); }
+
+    // Returns the 99th percentile of recent read latencies rounded up to a power of two, zero until there are enough samples
+    [[nodiscard]] std::chrono::nanoseconds read_p99() const noexcept
+    {
+        std::array<uint32_t, kLatencyBuckets> buckets;
+        std::ranges::transform(read_latencies_, buckets.begin(), [](auto const& bucket) { return bucket.load(std::memory_order_relaxed); });
+
+        auto const total = std::accumulate(buckets.begin(), buckets.end(), uint64_t{0});
+        if (total < kLatencyMinSamples)
+            return std::chrono::nanoseconds{0};
+
+        uint64_t count{0};
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            count += buckets[i];
+            if (100 * count >= 99 * total)
+                return std::chrono::nanoseconds{uint64_t{1} << i};
+        }
+        return std::chrono::nanoseconds{std::numeric_limits<int64_t>::max()};
+    }
+
+    // Makes new files be created out of a pool of the files created ahead, it is to be done before the backend is used
+    void pool_enable(ChunkPool::Config const& config) { pool_ = config.depth ? std::make_shared<ChunkPool>(fs_, config) : nullptr; }
+
+    // Deletes the file in the background, the path is free to be reused as soon as the call returns
+    int discard(std::filesystem::path const& path) { return reaper_->discard(path); }
+    // Resumes deleting the files discarded by the previous run, which are deleted as well once a file is discarded
+    void reclaim() { reaper_->start(); }
+    // Returns the number of files discarded waiting to be deleted
+    [[nodiscard]] size_t reclaim_pending() { return reaper_->pending(); }
+
+    void writer_attach() noexcept { writers_.fetch_add(1, std::memory_order_relaxed); }
+    void writer_detach() noexcept { writers_.fetch_sub(1, std::memory_order_relaxed); }
+
+    // Returns the space available on the backend less the space reserved, statfs is requested not more often than once in kStatfsTTL
+    // and the space written meanwhile is accounted for
+    [[nodiscard]] size_t free_space() const
+    {
+        std::lock_guard g{statfs_mtx_};
+        statfs_refresh();
+        return available();
+    }
+
+    // Reserves up to the number of bytes given out of the space available, returns the number of bytes reserved
+    size_t reserve(size_t bytes)
+    {
+        std::lock_guard g{statfs_mtx_};
+        statfs_refresh();
+        bytes = std::min(bytes, available());
+        reserved_ += bytes;
+        return bytes;
+    }
+
+    void unreserve(size_t bytes) noexcept
+    {
+        std::lock_guard g{statfs_mtx_};
+        reserved_ -= std::min(bytes, reserved_);
+    }
+
+    // Accounts for the bytes reserved having been written
+    void consume(size_t bytes) noexcept
+    {
+        std::lock_guard g{statfs_mtx_};
+        reserved_ -= std::min(bytes, reserved_);
+        consumed_ += bytes;
+    }
+
+    [[nodiscard]] size_t total_space() const
+    {
+        std::lock_guard g{statfs_mtx_};
+        statfs_refresh();
+        return total_space_;
+    }
+
+    // Returns the preferred I/O block size of the backend, chunk boundaries are aligned to it
+    [[nodiscard]] size_t block_size() const
+    {
+        std::lock_guard g{statfs_mtx_};
+        statfs_refresh();
+        return block_size_ ? block_size_ : 1;
+    }
+
+    int getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* fi) const override { return fs_->getattr(path, stbuf, fi); }
+    int readlink(std::filesystem::path const& path, std::span<char> buf) const override { return fs_->readlink(path, buf); }
+    int mknod(std::filesystem::path const& path, mode_t mode, dev_t rdev) override { return fs_->mknod(path, mode, rdev); }
+    int mkdir(std::filesystem::path const& path, mode_t mode) override { return fs_->mkdir(path, mode); }
+    int rmdir(std::filesystem::path const& path) override { return fs_->rmdir(path); }
+    int symlink(std::filesystem::path const& from, std::filesystem::path const& to) override { return fs_->symlink(from, to); }
+    int rename(std::filesystem::path const& from, std::filesystem::path const& to, unsigned int flags) override { return fs_->rename(from, to, flags); }
+    int link(std::filesystem::path const& from, std::filesystem::path const& to) override { return fs_->link(from, to); }
+    int access(std::filesystem::path const& path, int mask) const override { return fs_->access(path, mask); }
+    int opendir(std::filesystem::path const& path, struct fuse_file_info* fi) override { return fs_->opendir(path, fi); }
+    int readdir(
+        std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const override
+    {
+        return fs_->readdir(path, buf, filler, offset, fi, flags);
+    }
+    int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi) override { return fs_->releasedir(path, fi); }
+    int unlink(std::filesystem::path const& path) override { return fs_->unlink(path); }
+    int chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi) override { return fs_->chmod(path, mode, fi); }
+    int chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi) override { return fs_->chown(path, uid, gid, fi); }
+    int truncate(std::filesystem::path const& path, off_t size, struct fuse_file_info* fi) override { return fs_->truncate(path, size, fi); }
+    int open(std::filesystem::path const& path, struct fuse_file_info* fi) override { return fs_->open(path, fi); }
+    // Creates a file out of the pool if any, files are pooled opened for reading and writing, so other files are created directly.
+    // The directories the files reside in are made once missing and left behind once emptied
+    int create(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi) override
+    {
+        if (auto const r = fanout_make(path))
+            return r;
+        auto r = create_file(path, mode, fi);
+        if (-ENOENT == r && path.has_relative_path() && path.relative_path().has_parent_path()) {
+            if (r = parents_make(path); 0 == r)
+                r = create_file(path, mode, fi);
+        }
+        return r;
+    }
+
+    ssize_t read(std::filesystem::path const& path, std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const override
+    {
+        return metered([&] { return fs_->read(path, buf, offset, fi); }, true);
+    }
+
+    ssize_t write(std::filesystem::path const& path, std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi) override
+    {
+        return metered([&] { return fs_->write(path, buf, offset, fi); }, false);
+    }
+
+    int statfs(std::filesystem::path const& path, struct statvfs& stbuf) const override { return fs_->statfs(path, stbuf); }
+    int release(std::filesystem::path const& path, struct fuse_file_info* fi) override { return fs_->release(path, fi); }
+    int fsync(std::filesystem::path const& path, int isdatasync, struct fuse_file_info* fi) override { return fs_->fsync(path, isdatasync, fi); }
+#ifdef HAVE_UTIMENSAT
+    int utimens(std::filesystem::path const& path, const struct timespec ts[2], struct fuse_file_info* fi) override { return fs_->utimens(path, ts, fi); }
+#endif // HAVE_UTIMENSAT
+#ifdef HAVE_POSIX_FALLOCATE
+    int fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) override
+    {
+        return fs_->fallocate(path, mode, offset, length, fi);
+    }
+#endif // HAVE_POSIX_FALLOCATE
+#ifdef HAVE_SETXATTR
+    int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) override
+    {
+        return fs_->setxattr(path, name, value, flags);
+    }
+    int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const override { return fs_->getxattr(path, name, value); }
+#endif // HAVE_SETXATTR
+    off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const override
+    {
+        return fs_->lseek(path, off, whence, fi);
+    }
+};
+
+} // namespace multifs
@@ -0,0 +1,35 @@
+#include "caller.hpp"
+
+#include <cassert>
+
+#include <fuse.h>
+
+namespace multifs
+{
+
+namespace
+{
+
+thread_local Caller const* t_caller{nullptr}; ///< Caller handed over by the frontend for the request being served by the thread, if any
+
+} // anonymous namespace
+
+CallerScope::CallerScope(Caller const& caller) noexcept
+    : previous_(t_caller)
+{
+    t_caller = &caller;
+}
+
+CallerScope::~CallerScope() { t_caller = previous_; }
+
+Caller caller() noexcept
+{
+    if (t_caller)
+        return *t_caller;
+
+    auto const* ctx = fuse_get_context();
+    assert(ctx);
+    return {.uid = ctx->uid, .gid = ctx->gid};
+}
+
+} // namespace multifs
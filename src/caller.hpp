@@ -0,0 +1,35 @@
+#pragma once
+
+#include <sys/types.h>
+
+namespace multifs
+{
+
+// Credentials of the process the request being served is made by
+struct Caller {
+    uid_t uid;
+    gid_t gid;
+};
+
+// Makes the requests served by the thread be made by the caller given until the scope is left. The high-level API of FUSE keeps the
+// context of the request being served on its own, whereas the low-level one hands it over along with every request
+class CallerScope final
+{
+private:
+    Caller const* previous_;
+
+public:
+    explicit CallerScope(Caller const& caller) noexcept;
+    ~CallerScope();
+
+    CallerScope(CallerScope const&)            = delete;
+    CallerScope& operator=(CallerScope const&) = delete;
+
+    CallerScope(CallerScope&&)            = delete;
+    CallerScope& operator=(CallerScope&&) = delete;
+};
+
+// Returns the credentials of the process the request being served is made by
+Caller caller() noexcept;
+
+} // namespace multifs
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace multifs
+{
+
+// The chunks of a file are named by the ID of the file rather than by its path, so renaming the file leaves the backends alone and the
+// chunks of a file created by a name some file went by earlier do not clash with the ones of that file. The ID is the number the file
+// is created by along with the salt of the mount it is created by, as the numbers given by a mount kept in memory only start over.
+// The chunks reside in a fan-out tree of directories by the hash of the ID, two levels of 256 directories each keep the directories
+// small with tens of millions of chunk files, while the chunks of a file reside together
+inline constexpr std::string_view kChunkDir{"/.multifs.chunks"}; ///< Root of the fan-out tree on every backend
+inline constexpr std::string_view kChunkSuffix{".chunk"};        ///< Suffix of the path the chunks of a file are named after
+inline constexpr size_t kChunkIdLength{32};                      ///< Number of the hex digits of the ID of a file
+
+// Draws the salt of the IDs of the files created by a mount
+inline uint64_t chunk_salt()
+{
+    std::random_device rd;
+    return uint64_t{rd()} << 32 | rd();
+}
+
+// Path the chunks of the file of the ID given are named after, the index of a chunk is appended to it
+inline std::string chunk_base(uint64_t salt, uint64_t serial)
+{
+    // the finalizer of splitmix64 spreads the IDs following each other over the whole tree
+    auto hash = salt ^ serial;
+    hash      = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash      = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    hash      = hash ^ (hash >> 31);
+
+    constexpr std::string_view kDigits{"0123456789abcdef"};
+    auto const hex = [&](std::string& s, uint64_t n, size_t digits) {
+        for (auto shift = digits * 4; shift != 0; shift -= 4)
+            s += kDigits[(n >> (shift - 4)) & 0xf];
+    };
+
+    std::string base{kChunkDir};
+    base.reserve(kChunkDir.size() + 7 + kChunkIdLength + kChunkSuffix.size());
+    base += '/';
+    hex(base, hash >> 56, 2);
+    base += '/';
+    hex(base, hash >> 48, 2);
+    base += '/';
+    hex(base, salt, 16);
+    hex(base, serial, 16);
+    base += kChunkSuffix;
+    return base;
+}
+
+} // namespace multifs
@@ -0,0 +1,147 @@
+#include "chunk_pool.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/post.hpp>
+
+#include "io_pool.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+std::filesystem::path const kPoolDir{"/.multifs.pool"};
+
+} // anonymous namespace
+
+ChunkPool::ChunkPool(std::shared_ptr<IFileSystem> fs, Config config)
+    : fs_(std::move(fs))
+    , config_(config)
+{
+    if (!fs_)
+        throw std::invalid_argument("fs provided cannot be empty");
+    if (0 == config_.depth)
+        throw std::invalid_argument("depth of a chunk pool cannot be zero");
+}
+
+ChunkPool::~ChunkPool()
+{
+    for (auto const& entry : entries_) {
+        fuse_file_info fi{};
+        fi.fh    = entry.fh;
+        fi.flags = O_RDWR;
+        fs_->release(entry.path, &fi);
+        fs_->unlink(entry.path);
+    }
+}
+
+void ChunkPool::prepare()
+{
+    fs_->mkdir(kPoolDir, S_IRWXU);
+
+    std::vector<std::string> names;
+    auto const filler = [](void* buf, char const* name, struct stat const* /*stbuf*/, off_t /*off*/, fuse_fill_dir_flags /*flags*/) {
+        if (std::string_view{"."} != name && std::string_view{".."} != name)
+            static_cast<std::vector<std::string>*>(buf)->emplace_back(name);
+        return 0;
+    };
+    fs_->readdir(kPoolDir, &names, filler, 0, nullptr, fuse_readdir_flags{});
+
+    for (auto const& name : names)
+        fs_->unlink(kPoolDir / name);
+}
+
+void ChunkPool::refill()
+{
+    if (!std::exchange(prepared_, true))
+        prepare();
+
+    for (;;) {
+        std::filesystem::path path;
+        {
+            std::lock_guard g{mtx_};
+            if (config_.depth <= entries_.size())
+                break;
+            path = kPoolDir / std::to_string(next_name_++);
+        }
+
+        fuse_file_info fi{};
+        fi.flags = O_RDWR | O_EXCL;
+        if (fs_->create(path, kMode, &fi))
+            break;
+
+#ifdef HAVE_POSIX_FALLOCATE
+        // the allocation is merely a hint, a file is pooled even if the backend does not support it
+        if (config_.prealloc)
+            fs_->fallocate(path, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(config_.prealloc), &fi);
+#endif
+
+        std::lock_guard g{mtx_};
+        entries_.push_back({std::move(path), fi.fh});
+    }
+}
+
+void ChunkPool::refill_async()
+{
+    if (refilling_.exchange(true))
+        return;
+
+    boost::asio::post(detached_io_pool(), [self = shared_from_this()] {
+        try {
+            self->refill();
+        } catch (...) {
+            // the files failed to be created are retried on the next refill
+        }
+        self->refilling_ = false;
+    });
+}
+
+int ChunkPool::take(std::filesystem::path const& path, mode_t mode, struct fuse_file_info& fi)
+{
+    std::optional<Entry> entry;
+    {
+        std::lock_guard g{mtx_};
+        if (!entries_.empty()) {
+            entry = std::move(entries_.front());
+            entries_.pop_front();
+        }
+    }
+
+    refill_async();
+
+    if (!entry)
+        return -EAGAIN;
+
+    fuse_file_info efi{};
+    efi.fh    = entry->fh;
+    efi.flags = O_RDWR;
+
+    if (auto const r = fs_->rename(entry->path, path, 0)) {
+        fs_->release(entry->path, &efi);
+        fs_->unlink(entry->path);
+        return r;
+    }
+
+    // the chunk gets the mode it would have been created with
+    if ((mode & 07777) != kMode) {
+        if (auto const r = fs_->chmod(path, mode & 07777, nullptr)) {
+            fs_->release(path, &efi);
+            fs_->unlink(path);
+            return r;
+        }
+    }
+
+    fi.fh = entry->fh;
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <fuse.h>
+
+#include "file_system_interface.hpp"
+
+namespace multifs
+{
+
+// Keeps empty chunk files created ahead on a backend, so that a chunk is created by renaming one of them rather than by creating a file
+// in a possibly busy directory. The files are kept opened and get refilled in the background as they are taken
+class ChunkPool final : public std::enable_shared_from_this<ChunkPool>
+{
+public:
+    struct Config {
+        size_t depth{0};    ///< Number of files kept, 0 disables the pool
+        size_t prealloc{0}; ///< Bytes allocated for every file beyond its size ahead, if the backend supports it
+    };
+
+    static constexpr mode_t kMode{S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH}; ///< Mode of the files, a chunk of another mode gets it changed
+
+private:
+    struct Entry {
+        std::filesystem::path path;
+        uint64_t fh;
+    };
+
+    std::shared_ptr<IFileSystem> fs_;
+    Config config_;
+    std::mutex mtx_;
+    std::deque<Entry> entries_;
+    uint64_t next_name_{0};
+    bool prepared_{false};               ///< Whether the directory of the pool has been made and cleaned of the files left by a crash
+    std::atomic<bool> refilling_{false}; ///< Set while a refill is scheduled or runs, so that refills never run concurrently
+
+    void prepare();
+    void refill();
+    void refill_async();
+
+public:
+    explicit ChunkPool(std::shared_ptr<IFileSystem> fs, Config config);
+    ~ChunkPool();
+
+    ChunkPool(ChunkPool const&)            = delete;
+    ChunkPool& operator=(ChunkPool const&) = delete;
+
+    ChunkPool(ChunkPool&&)            = delete;
+    ChunkPool& operator=(ChunkPool&&) = delete;
+
+    // Renames a file of the pool to the path given and passes its handle opened for reading and writing, returns -EAGAIN if the pool is empty.
+    // The pool is filled up on the first call rather than on construction, as the process is forked on daemonizing and threads do not survive it
+    int take(std::filesystem::path const& path, mode_t mode, struct fuse_file_info& fi);
+};
+
+} // namespace multifs
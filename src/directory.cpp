@@ -0,0 +1,256 @@
+#include "directory.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "inode.hpp"
+#include "utilities.hpp"
+
+using namespace multifs;
+
+Directory::Directory(std::shared_ptr<NameArena> names, mode_t mode, uid_t owner_uid, gid_t owner_gid, uint64_t ino) noexcept
+    : ino_(ino)
+    , names_(std::move(names))
+{
+    desc_.mode      = S_IFDIR | (mode & 07777);
+    desc_.owner_uid = owner_uid;
+    desc_.owner_gid = owner_gid;
+    desc_.atime     = current_time();
+    desc_.mtime     = desc_.atime;
+    desc_.ctime     = desc_.atime;
+}
+
+Directory::Directory(InodeRecord const& record, std::shared_ptr<NameArena> names)
+    : ino_(record.ino)
+    , names_(std::move(names))
+{
+    restore(record);
+}
+
+Directory::~Directory()
+{
+    for (auto const& entry : entries_) {
+        // the subdirectories outliving the directory are known to be linked nowhere
+        if (auto* dir = std::get_if<Directory>(entry.inode.get()); dir && this == dir->parent_)
+            dir->parent_ = nullptr;
+        names_->release(entry.name);
+    }
+}
+
+InodeRecord Directory::record() const noexcept
+{
+    return {
+        .ino        = ino_,
+        .kind       = InodeRecord::Kind::kDirectory,
+        .mode       = desc_.mode,
+        .owner_uid  = desc_.owner_uid,
+        .owner_gid  = desc_.owner_gid,
+        .flags      = 0,
+        .size       = 0,
+        .atime      = desc_.atime,
+        .mtime      = desc_.mtime,
+        .ctime      = desc_.ctime,
+        .layout     = {},
+        .zero_block = 0,
+        .data       = {},
+    };
+}
+
+void Directory::modified() noexcept
+{
+    desc_.mtime = current_time();
+    desc_.ctime = desc_.mtime;
+}
+
+off_t Directory::cookie(std::string_view name) noexcept
+{
+    uint64_t hash{0xcbf29ce484222325};
+    for (auto const c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return static_cast<off_t>(hash >> 2) + kFirstCookie;
+}
+
+void Directory::attach(INode& inode, off_t cookie) noexcept
+{
+    std::visit(
+        [this, cookie](auto& item) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(item)>, Directory>) {
+                item.parent_    = this;
+                item.listed_at_ = cookie;
+            } else {
+                item.count_link(1);
+            }
+        },
+        inode);
+}
+
+void Directory::detach(INode& inode, off_t cookie) noexcept
+{
+    std::visit(
+        [this, cookie](auto& item) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(item)>, Directory>) {
+                // the directory may have been linked elsewhere already, as the entries exchanged are
+                if (this == item.parent_ && cookie == item.listed_at_)
+                    item.parent_ = nullptr;
+            } else {
+                item.count_link(-1);
+            }
+        },
+        inode);
+}
+
+std::string_view Directory::name() const noexcept
+{
+    assert(parent_);
+    auto const it = std::ranges::lower_bound(parent_->entries_, listed_at_, std::less<>{}, &Entry::cookie);
+    assert(parent_->entries_.end() != it && listed_at_ == it->cookie);
+    return it->name.view();
+}
+
+std::vector<Directory::Entry>::const_iterator Directory::locate(std::string_view name) const noexcept
+{
+    auto const it = std::ranges::lower_bound(entries_, cookie(name), std::less<>{}, &Entry::cookie);
+    if (entries_.end() != it && it->name.view() == name)
+        return it;
+    // the names colliding are rare enough for the entries displaced to be looked for one by one
+    if (0 != displaced_)
+        return std::ranges::find(entries_, name, [](Entry const& entry) { return entry.name.view(); });
+    return entries_.end();
+}
+
+std::span<Directory::Entry const> Directory::entries(off_t offset) const noexcept
+{
+    auto const it = std::ranges::upper_bound(entries_, offset, std::less<>{}, &Entry::cookie);
+    return {it, entries_.end()};
+}
+
+std::shared_ptr<INode> const* Directory::find(std::string_view name) const noexcept
+{
+    auto const it = locate(name);
+    return entries_.end() != it ? &it->inode : nullptr;
+}
+
+bool Directory::insert(std::string_view name, std::shared_ptr<INode> inode)
+{
+    assert(inode);
+
+    if (entries_.end() != locate(name))
+        return false;
+
+    // the cookie of the name taken, the entry is listed at the next one free
+    auto const hash = cookie(name);
+    auto listed     = hash;
+    auto it         = std::ranges::lower_bound(entries_, listed, std::less<>{}, &Entry::cookie);
+    for (; entries_.end() != it && it->cookie == listed; ++it)
+        ++listed;
+
+    auto& linked      = *inode;
+    auto const subdir = std::holds_alternative<Directory>(linked);
+    auto const added  = names_->add(name);
+    try {
+        entries_.insert(it, Entry{added, std::move(inode), listed});
+    } catch (...) {
+        names_->release(added);
+        throw;
+    }
+    subdirs_ += subdir;
+    displaced_ += hash != listed;
+    attach(linked, listed);
+    modified();
+
+    return true;
+}
+
+std::shared_ptr<INode> Directory::assign(std::string_view name, std::shared_ptr<INode> inode)
+{
+    assert(inode);
+
+    auto const cit = locate(name);
+    if (entries_.end() == cit) {
+        insert(name, std::move(inode));
+        return nullptr;
+    }
+    auto const it = entries_.begin() + (cit - entries_.cbegin());
+
+    subdirs_ += std::holds_alternative<Directory>(*inode);
+    subdirs_ -= std::holds_alternative<Directory>(*it->inode);
+    attach(*inode, it->cookie);
+    detach(*it->inode, it->cookie);
+    modified();
+
+    return std::exchange(it->inode, std::move(inode));
+}
+
+std::shared_ptr<INode> Directory::erase(std::string_view name)
+{
+    auto const cit = locate(name);
+    if (entries_.end() == cit)
+        return nullptr;
+
+    auto const it = entries_.begin() + (cit - entries_.cbegin());
+    auto inode    = std::move(it->inode);
+    subdirs_ -= std::holds_alternative<Directory>(*inode);
+    displaced_ -= cookie(name) != it->cookie;
+    detach(*inode, it->cookie);
+    names_->release(it->name);
+    entries_.erase(it);
+    modified();
+
+    return inode;
+}
+
+void Directory::restore(InodeRecord const& record) noexcept
+{
+    assert(InodeRecord::Kind::kDirectory == record.kind);
+
+    desc_.mode      = record.mode;
+    desc_.owner_uid = record.owner_uid;
+    desc_.owner_gid = record.owner_gid;
+    desc_.atime     = record.atime;
+    desc_.mtime     = record.mtime;
+    desc_.ctime     = record.ctime;
+}
+
+int Directory::chmod(mode_t mode) noexcept
+{
+    desc_.mode  = S_IFDIR | (mode & 07777);
+    desc_.ctime = current_time();
+    return 0;
+}
+
+int Directory::chown(uid_t uid, gid_t gid) noexcept
+{
+    desc_.owner_uid = uid;
+    desc_.owner_gid = gid;
+    desc_.ctime     = current_time();
+    return 0;
+}
+
+#ifdef HAVE_UTIMENSAT
+int Directory::utimens(const struct timespec ts[2]) noexcept
+{
+    auto const cur_time = current_time();
+
+    if (UTIME_NOW == ts[0].tv_nsec)
+        desc_.atime = cur_time;
+    else if (UTIME_OMIT != ts[0].tv_nsec)
+        desc_.atime = ts[0];
+
+    if (UTIME_NOW == ts[1].tv_nsec)
+        desc_.mtime = cur_time;
+    else if (UTIME_OMIT != ts[1].tv_nsec)
+        desc_.mtime = ts[1];
+
+    if (UTIME_OMIT != ts[0].tv_nsec || UTIME_OMIT != ts[1].tv_nsec)
+        desc_.ctime = cur_time;
+
+    return 0;
+}
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "metadata_record.hpp"
+#include "name_arena.hpp"
+
+namespace multifs
+{
+
+struct INode;
+
+// A directory of the namespace. The entries are kept in a vector sorted by their cookies, which is as compact as an index gets: an entry
+// is looked up by a binary search and a subtree is moved by moving a single entry. The cookie of an entry is a hash of its name, so it
+// stays the same as the entries around it come and go, and a listing resumes right past the entry it was interrupted at. The cookies
+// are unique, an entry whose name hashes to a cookie taken gets the next free one past it, so a listing is never resumed in between
+// entries sharing a cookie
+class Directory
+{
+public:
+    struct Descriptor {
+        mode_t mode{S_IFDIR | 0755};
+        uid_t owner_uid;
+        gid_t owner_gid;
+        mutable timespec atime;
+        timespec mtime;
+        timespec ctime;
+    };
+
+    struct Entry {
+        NameArena::Name name;
+        std::shared_ptr<INode> inode;
+        off_t cookie; ///< Offset the entry is listed at, unique within the directory
+    };
+
+    static constexpr off_t kFirstCookie{3}; ///< Offsets below are taken by the start of a listing, "." and ".."
+
+private:
+    std::vector<Entry> entries_; ///< Entries sorted by their cookies
+    size_t subdirs_{0};          ///< Number of the entries being directories, every one of them links back to the directory by ".."
+    size_t displaced_{0};        ///< Number of the entries listed past the cookies of their names, as those were taken by others
+    Directory* parent_{nullptr}; ///< Directory the directory is linked in, none for the root and for the directories removed
+    off_t listed_at_{0};         ///< Cookie of the entry the directory is linked by within its parent
+    uint64_t ino_{0};            ///< Number the directory is known by, in the metadata store as well
+    std::shared_ptr<NameArena> names_;
+
+    Descriptor desc_;
+
+    void modified() noexcept;
+    // Returns the entry of the name, the end of the entries if there is none
+    std::vector<Entry>::const_iterator locate(std::string_view name) const noexcept;
+    // Keeps track of the directory an entry made or removed refers to being linked by it, the other inodes count their links instead
+    void attach(INode& inode, off_t cookie) noexcept;
+    void detach(INode& inode, off_t cookie) noexcept;
+
+public:
+    explicit Directory(std::shared_ptr<NameArena> names, mode_t mode, uid_t owner_uid, gid_t owner_gid, uint64_t ino = 0) noexcept;
+    // Restores the directory kept in the metadata store, its entries are restored separately
+    explicit Directory(InodeRecord const& record, std::shared_ptr<NameArena> names);
+    ~Directory();
+
+    Directory(Directory const&)            = delete;
+    Directory& operator=(Directory const&) = delete;
+
+    Directory(Directory&&) noexcept            = default;
+    Directory& operator=(Directory&&) noexcept = delete;
+
+    [[nodiscard]] auto const& desc() const noexcept { return desc_; }
+    [[nodiscard]] uint64_t ino() const noexcept { return ino_; }
+    [[nodiscard]] InodeRecord record() const noexcept;
+
+    [[nodiscard]] std::span<Entry const> entries() const noexcept { return entries_; }
+    // Returns the entries listed past the offset given, all of them for an offset below the first cookie
+    [[nodiscard]] std::span<Entry const> entries(off_t offset) const noexcept;
+    [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+    [[nodiscard]] nlink_t nlink() const noexcept { return 2 + subdirs_; }
+    // Returns the directory the directory is linked in, null for the root and for the directories removed
+    [[nodiscard]] Directory const* parent() const noexcept { return parent_; }
+    // Returns the name the directory is linked by within its parent, which it is to be linked in
+    [[nodiscard]] std::string_view name() const noexcept;
+
+    // Returns the inode the name refers to, null if there is no such entry. The pointer is valid until the entries are changed
+    [[nodiscard]] std::shared_ptr<INode> const* find(std::string_view name) const noexcept;
+    // Adds the entry unless the name is taken, the name must not be longer than NameArena::kMaxSize
+    bool insert(std::string_view name, std::shared_ptr<INode> inode);
+    // Makes the name refer to the inode given, returns the inode it referred to before, null if there was no such entry
+    std::shared_ptr<INode> assign(std::string_view name, std::shared_ptr<INode> inode);
+    // Removes the entry, returns the inode it referred to, null if there was no such entry
+    std::shared_ptr<INode> erase(std::string_view name);
+
+    // Updates the attributes of the directory to the ones kept in the metadata store
+    void restore(InodeRecord const& record) noexcept;
+
+    // Returns the cookie the name is listed at unless it is taken, a 64-bit FNV-1a hash of the name cut to fit the offsets past the ones taken
+    [[nodiscard]] static off_t cookie(std::string_view name) noexcept;
+
+    int chmod(mode_t mode) noexcept;
+    int chown(uid_t uid, gid_t gid) noexcept;
+    int utimens(const struct timespec ts[2]) noexcept;
+};
+
+} // namespace multifs
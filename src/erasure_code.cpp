@@ -0,0 +1,342 @@
+#include "erasure_code.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MULTIFS_X86 1
+#endif
+
+using namespace multifs;
+
+namespace
+{
+
+// Parity columns are computed by blocks small enough to stay in cache while all the data columns are folded in
+constexpr size_t kBlockSize{16 * 1024};
+
+// GF(2^8) generated by the polynomial x^8 + x^4 + x^3 + x^2 + 1, the one of Linux RAID-6, with 2 as the generator
+constexpr unsigned kPolynomial{0x11d};
+
+struct Tables {
+    std::array<uint8_t, 2 * 255> exp{};
+    std::array<uint8_t, 256> log{};
+};
+
+constexpr Tables kTables{[] {
+    Tables tables;
+    unsigned x{1};
+    for (unsigned i = 0; i < 255; ++i) {
+        tables.exp[i]       = static_cast<uint8_t>(x);
+        tables.exp[i + 255] = static_cast<uint8_t>(x);
+        tables.log[x]       = static_cast<uint8_t>(i);
+        x <<= 1;
+        if (x & 0x100)
+            x ^= kPolynomial;
+    }
+    return tables;
+}()};
+
+constexpr uint8_t gf_mul(uint8_t a, uint8_t b) noexcept { return a && b ? kTables.exp[kTables.log[a] + kTables.log[b]] : 0; }
+
+constexpr uint8_t gf_inv(uint8_t a) noexcept
+{
+    assert(a);
+    return kTables.exp[255 - kTables.log[a]];
+}
+
+// Coefficient the data column is multiplied by in the parity column, 1 for P and the power of the generator for Q
+constexpr uint8_t coefficient(size_t parity_idx, size_t data_idx) noexcept { return parity_idx ? kTables.exp[data_idx % 255] : 1; }
+
+constexpr auto kMulTable{[] {
+    std::array<std::array<uint8_t, 256>, 256> table{};
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned b = 0; b < 256; ++b)
+            table[a][b] = gf_mul(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+    }
+    return table;
+}()};
+
+// Products of the constant and all the values of the low and the high nibble of a byte, the product of the constant and a byte
+// is the XOR of the two products looked up, which is done for a vector of bytes at once by a byte shuffle within 128-bit lanes,
+// so the tables are replicated over the lanes of a vector
+template <size_t Lanes>
+struct NibbleTables {
+    std::array<uint8_t, 16 * Lanes> lo;
+    std::array<uint8_t, 16 * Lanes> hi;
+};
+
+template <size_t Lanes>
+NibbleTables<Lanes> nibble_tables(uint8_t c) noexcept
+{
+    NibbleTables<Lanes> tables;
+    for (unsigned x = 0; x < tables.lo.size(); ++x) {
+        tables.lo[x] = gf_mul(c, static_cast<uint8_t>(x % 16));
+        tables.hi[x] = gf_mul(c, static_cast<uint8_t>(x % 16 << 4));
+    }
+    return tables;
+}
+
+// dst = c * src, or dst ^= c * src if Add, src and dst may be the same
+template <bool Add>
+void mul_scalar(uint8_t c, std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    auto const& row = kMulTable[c];
+    for (size_t i = 0; i < n; ++i) {
+        auto const p = std::byte{row[std::to_integer<uint8_t>(src[i])]};
+        dst[i]       = Add ? dst[i] ^ p : p;
+    }
+}
+
+// dst ^= src
+void add_scalar(std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    size_t i{0};
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t s, d;
+        std::memcpy(&s, src + i, sizeof(s));
+        std::memcpy(&d, dst + i, sizeof(d));
+        d ^= s;
+        std::memcpy(dst + i, &d, sizeof(d));
+    }
+    for (; i < n; ++i)
+        dst[i] ^= src[i];
+}
+
+#ifdef MULTIFS_X86
+template <bool Add>
+__attribute__((target("avx2"))) void mul_avx2(uint8_t c, std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    auto const tables = nibble_tables<2>(c);
+    auto const lo     = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(tables.lo.data()));
+    auto const hi     = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(tables.hi.data()));
+    auto const mask   = _mm256_set1_epi8(0x0f);
+
+    size_t i{0};
+    for (; i + sizeof(__m256i) <= n; i += sizeof(__m256i)) {
+        auto const s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        auto p       = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)), _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(s, 4), mask)));
+        if constexpr (Add)
+            p = _mm256_xor_si256(p, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+    }
+    mul_scalar<Add>(c, src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) void add_avx2(std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    size_t i{0};
+    for (; i + sizeof(__m256i) <= n; i += sizeof(__m256i)) {
+        auto const s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        auto const d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(s, d));
+    }
+    add_scalar(src + i, dst + i, n - i);
+}
+
+template <bool Add>
+__attribute__((target("avx512f,avx512bw"))) void mul_avx512(uint8_t c, std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    auto const tables = nibble_tables<4>(c);
+    auto const lo     = _mm512_loadu_si512(tables.lo.data());
+    auto const hi     = _mm512_loadu_si512(tables.hi.data());
+    auto const mask   = _mm512_set1_epi8(0x0f);
+
+    size_t i{0};
+    for (; i + sizeof(__m512i) <= n; i += sizeof(__m512i)) {
+        auto const s = _mm512_loadu_si512(src + i);
+        auto p       = _mm512_xor_si512(
+            _mm512_shuffle_epi8(lo, _mm512_and_si512(s, mask)), _mm512_shuffle_epi8(hi, _mm512_and_si512(_mm512_srli_epi16(s, 4), mask)));
+        if constexpr (Add)
+            p = _mm512_xor_si512(p, _mm512_loadu_si512(dst + i));
+        _mm512_storeu_si512(dst + i, p);
+    }
+    mul_scalar<Add>(c, src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void add_avx512(std::byte const* src, std::byte* dst, size_t n) noexcept
+{
+    size_t i{0};
+    for (; i + sizeof(__m512i) <= n; i += sizeof(__m512i))
+        _mm512_storeu_si512(dst + i, _mm512_xor_si512(_mm512_loadu_si512(src + i), _mm512_loadu_si512(dst + i)));
+    add_scalar(src + i, dst + i, n - i);
+}
+#endif // MULTIFS_X86
+
+struct Kernels {
+    void (*mul)(uint8_t c, std::byte const* src, std::byte* dst, size_t n) noexcept;
+    void (*mul_add)(uint8_t c, std::byte const* src, std::byte* dst, size_t n) noexcept;
+    void (*add)(std::byte const* src, std::byte* dst, size_t n) noexcept;
+
+    void fold(uint8_t c, std::byte const* src, std::byte* dst, size_t n) const noexcept
+    {
+        if (1 == c)
+            add(src, dst, n);
+        else if (c)
+            mul_add(c, src, dst, n);
+    }
+};
+
+Kernels const& kernels(ErasureCode::Isa isa) noexcept
+{
+    static constexpr Kernels scalar{mul_scalar<false>, mul_scalar<true>, add_scalar};
+#ifdef MULTIFS_X86
+    static constexpr Kernels avx2{mul_avx2<false>, mul_avx2<true>, add_avx2};
+    static constexpr Kernels avx512{mul_avx512<false>, mul_avx512<true>, add_avx512};
+
+    switch (isa) {
+        case ErasureCode::Isa::kAvx2:
+            return avx2;
+        case ErasureCode::Isa::kAvx512:
+            return avx512;
+        default:
+            break;
+    }
+#endif // MULTIFS_X86
+    return scalar;
+}
+
+// Computes the block of the parity column out of the blocks of the data columns
+template <typename Column>
+void encode_block(Kernels const& k, size_t parity_idx, std::span<Column const> data, std::byte* parity, size_t offset, size_t n) noexcept
+{
+    // the coefficient of the first data column is 1 for every parity column
+    std::memcpy(parity + offset, data[0] + offset, n);
+    for (size_t i = 1; i < data.size(); ++i)
+        k.fold(coefficient(parity_idx, i), data[i] + offset, parity + offset, n);
+}
+
+} // anonymous namespace
+
+ErasureCode::ErasureCode(size_t data, size_t parity, Isa isa)
+    : data_(data)
+    , parity_(parity)
+    , isa_(isa)
+{
+    if (0 == data_ || data_ > kMaxData)
+        throw std::invalid_argument("number of data columns is out of range");
+    if (parity_ > kMaxParity)
+        throw std::invalid_argument("number of parity columns is out of range");
+    if (!supported(isa_))
+        throw std::invalid_argument("instruction set is not supported by the CPU");
+}
+
+void ErasureCode::encode(std::span<std::byte const* const> data, std::span<std::byte* const> parity, size_t length) const noexcept
+{
+    assert(data.size() == data_);
+    assert(parity.size() == parity_);
+
+    auto const& k = kernels(isa_);
+    for (size_t offset = 0; offset < length; offset += kBlockSize) {
+        auto const n = std::min(kBlockSize, length - offset);
+        for (size_t j = 0; j < parity_; ++j)
+            encode_block(k, j, data, parity[j], offset, n);
+    }
+}
+
+bool ErasureCode::decode(std::span<std::byte* const> columns, std::span<size_t const> lost, size_t length) const noexcept
+{
+    assert(columns.size() == data_ + parity_);
+
+    if (lost.size() > parity_)
+        return false;
+
+    std::array<size_t, kMaxParity> lost_data;
+    size_t lost_data_count{0};
+    std::array<bool, kMaxParity> lost_parity{};
+    for (auto const idx : lost) {
+        assert(idx < columns.size());
+        if (idx < data_)
+            lost_data[lost_data_count++] = idx;
+        else
+            lost_parity[idx - data_] = true;
+    }
+
+    auto const& k      = kernels(isa_);
+    auto const data    = columns.first(data_);
+    auto const is_lost = [&](size_t idx) { return std::ranges::count(lost_data.begin(), lost_data.begin() + lost_data_count, idx); };
+
+    for (size_t offset = 0; offset < length; offset += kBlockSize) {
+        auto const n = std::min(kBlockSize, length - offset);
+
+        if (1 == lost_data_count) {
+            // D[a] = (P[j] - sum of c[j][i] * D[i] over the data columns survived) / c[j][a], whichever parity column survived
+            auto const a   = lost_data[0];
+            auto const j   = lost_parity[0] ? size_t{1} : size_t{0};
+            auto* const da = data[a] + offset;
+            std::memcpy(da, columns[data_ + j] + offset, n);
+            for (size_t i = 0; i < data_; ++i) {
+                if (i != a)
+                    k.fold(coefficient(j, i), data[i] + offset, da, n);
+            }
+            if (auto const c = coefficient(j, a); 1 != c)
+                k.mul(gf_inv(c), da, da, n);
+        } else if (2 == lost_data_count) {
+            // the syndromes give D[a] + D[b] = S0 and g^a * D[a] + g^b * D[b] = S1, so D[a] = (S1 + g^b * S0) / (g^a + g^b)
+            auto const a   = lost_data[0];
+            auto const b   = lost_data[1];
+            auto* const da = data[a] + offset;
+            auto* const db = data[b] + offset;
+            std::memcpy(da, columns[data_ + 1] + offset, n);
+            std::memcpy(db, columns[data_] + offset, n);
+            for (size_t i = 0; i < data_; ++i) {
+                if (!is_lost(i)) {
+                    k.add(data[i] + offset, db, n);
+                    k.fold(coefficient(1, i), data[i] + offset, da, n);
+                }
+            }
+            k.fold(coefficient(1, b), db, da, n);
+            k.mul(gf_inv(coefficient(1, a) ^ coefficient(1, b)), da, da, n);
+            k.add(da, db, n);
+        }
+
+        // parity columns lost are computed anew out of the data columns complete by now
+        for (size_t j = 0; j < parity_; ++j) {
+            if (lost_parity[j])
+                encode_block(k, j, data, columns[data_ + j], offset, n);
+        }
+    }
+
+    return true;
+}
+
+ErasureCode::Isa ErasureCode::best_isa() noexcept
+{
+    static Isa const isa = supported(Isa::kAvx512) ? Isa::kAvx512 : supported(Isa::kAvx2) ? Isa::kAvx2 : Isa::kScalar;
+    return isa;
+}
+
+bool ErasureCode::supported(Isa isa) noexcept
+{
+    switch (isa) {
+#ifdef MULTIFS_X86
+        case Isa::kAvx2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::kAvx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif // MULTIFS_X86
+        case Isa::kScalar:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string_view ErasureCode::name(Isa isa) noexcept
+{
+    switch (isa) {
+        case Isa::kScalar:
+            return "scalar";
+        case Isa::kAvx2:
+            return "avx2";
+        case Isa::kAvx512:
+            return "avx512";
+    }
+    return "unknown";
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+
+namespace multifs
+{
+
+// Systematic Reed-Solomon code over GF(2^8) protecting data columns by up to two parity columns. The first parity column is the XOR
+// of the data columns (RAID-5), the second one is the sum of the data columns multiplied by the powers of the generator (RAID-6).
+// A byte of a parity column depends on the bytes at the same position of the data columns only
+class ErasureCode
+{
+public:
+    // Instruction sets the kernels of the code are implemented for
+    enum class Isa : uint8_t {
+        kScalar,
+        kAvx2,
+        kAvx512,
+    };
+
+    static constexpr size_t kMaxParity{2};
+    static constexpr size_t kMaxData{255}; ///< The powers of the generator multiplying the data columns are distinct up to the number
+
+private:
+    size_t data_;
+    size_t parity_;
+    Isa isa_;
+
+public:
+    explicit ErasureCode(size_t data, size_t parity, Isa isa = best_isa());
+
+    [[nodiscard]] size_t data() const noexcept { return data_; }
+    [[nodiscard]] size_t parity() const noexcept { return parity_; }
+    [[nodiscard]] Isa isa() const noexcept { return isa_; }
+
+    // Computes the parity columns out of the data columns, all of them of the length given
+    void encode(std::span<std::byte const* const> data, std::span<std::byte* const> parity, size_t length) const noexcept;
+
+    // Rebuilds the columns lost out of the rest, the columns are indexed data ones first and parity ones next.
+    // Returns false if there are more columns lost than the parity columns
+    [[nodiscard]] bool decode(std::span<std::byte* const> columns, std::span<size_t const> lost, size_t length) const noexcept;
+
+    // Returns the most capable instruction set supported by the CPU
+    [[nodiscard]] static Isa best_isa() noexcept;
+    [[nodiscard]] static bool supported(Isa isa) noexcept;
+    [[nodiscard]] static std::string_view name(Isa isa) noexcept;
+};
+
+} // namespace multifs
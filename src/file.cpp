@@ -2,30 +2,141 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
 #include <fcntl.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
 #include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <ranges>
+#include <string>
+#include <utility>
+
+#ifdef HAVE_SETXATTR
+#include <sys/xattr.h>
+#endif
 
 #include <fuse.h>
 
+#include <boost/asio/steady_timer.hpp>
+
+#include "caller.hpp"
+#include "erasure_code.hpp"
+#include "io_pool.hpp"
+#include "scope_exit.hpp"
 #include "utilities.hpp"
+#include "zero_detector.hpp"
 
 using namespace multifs;
 
-void File::init_desc(mode_t mode, struct fuse_file_info* fi) noexcept
+namespace
+{
+
+// Chunks are opened for both reading and writing regardless of the handles of the file, they share the chunk handles
+constexpr int kChunkFlags{O_RDWR};
+
+// Space reserved ahead on the backends a spilled file is appended to, so that concurrent writers do not race to fill the same backend
+constexpr size_t kStreamReservation{64 * 1024 * 1024};
+
+bool is_writable(struct fuse_file_info const* fi) noexcept { return fi && O_RDONLY != (fi->flags & O_ACCMODE); }
+
+// Estimates how long a request to the backend would take considering the requests queued
+std::chrono::nanoseconds expected_wait(Backend const& backend) noexcept { return (backend.inflight() + 1) * backend.latency(); }
+
+// Reads from the first backend by the caller, if it does not respond within the threshold the read is issued to the second backend as well
+// in the background. The second backend is read from by a handle of its own, as the read lagging behind may outlive the handles of the
+// chunk, and it backs the first one failing. Nothing is issued in the background unless the threshold passes
+ssize_t read_hedged(std::filesystem::path const& path,
+    std::span<std::byte> buf,
+    off_t offset,
+    std::shared_ptr<Backend> const& first,
+    struct fuse_file_info* fi,
+    std::shared_ptr<Backend> second,
+    std::chrono::nanoseconds threshold)
+{
+    struct State {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool first_done{false};
+        bool hedged{false};
+        std::vector<std::byte> buf;
+        std::optional<ssize_t> result;
+    };
+    auto state = std::make_shared<State>();
+
+    boost::asio::steady_timer timer{detached_io_pool(), threshold};
+    timer.async_wait([state, path, offset, size = buf.size(), fs = std::move(second)](boost::system::error_code const& ec) {
+        if (ec)
+            return;
+        {
+            std::lock_guard g{state->mtx};
+            if (state->first_done)
+                return;
+            state->hedged = true;
+        }
+
+        std::vector<std::byte> data(size);
+        fuse_file_info ofi{};
+        ofi.flags = O_RDONLY;
+        ssize_t r = fs->open(path, &ofi);
+        if (0 == r) {
+            r = fs->read(path, data, offset, &ofi);
+            fs->release(path, &ofi);
+        }
+
+        std::lock_guard g{state->mtx};
+        state->buf    = std::move(data);
+        state->result = r;
+        state->cv.notify_all();
+    });
+
+    auto const r = first->read(path, buf, offset, fi);
+    {
+        std::lock_guard g{state->mtx};
+        state->first_done = true;
+    }
+    timer.cancel();
+    if (0 <= r)
+        return r;
+
+    std::unique_lock lk{state->mtx};
+    if (!state->hedged)
+        return r;
+    state->cv.wait(lk, [&] { return state->result.has_value(); });
+    if (*state->result < 0)
+        return r;
+    std::memcpy(buf.data(), state->buf.data(), static_cast<size_t>(*state->result));
+    return *state->result;
+}
+
+#ifdef HAVE_SETXATTR
+constexpr std::string_view kStripeUnitXattr{"user.multifs.layout.stripe_unit"};
+constexpr std::string_view kStripeWidthXattr{"user.multifs.layout.stripe_width"};
+constexpr std::string_view kChunkSizeXattr{"user.multifs.layout.chunk_size"};
+constexpr std::string_view kCopiesXattr{"user.multifs.layout.copies"};
+constexpr std::string_view kParityXattr{"user.multifs.layout.parity"};
+#endif
+
+} // anonymous namespace
+
+void File::init_desc(mode_t mode, struct fuse_file_info* fi)
 {
-    auto const* ctx = fuse_get_context();
-    assert(ctx);
+    auto const [uid, gid] = caller();
     desc_.size      = 0;
-    desc_.owner_uid = ctx->uid;
-    desc_.owner_gid = ctx->gid;
+    desc_.owner_uid = uid;
+    desc_.owner_gid = gid;
     desc_.mode      = S_IFREG | mode;
-    if (fi && 0x0 == fi->fh) {
-        fi->fh = reinterpret_cast<uintptr_t>(new std::vector<fuse_file_info>{fss_.size(), *fi});
-    }
+    if (fi)
+        ++opens_;
+    if (is_writable(fi))
+        ++writers_;
     desc_.atime = current_time();
     desc_.mtime = desc_.atime;
     desc_.ctime = desc_.atime;
@@ -38,112 +149,578 @@ void File::truncate(size_t new_size) noexcept
     desc_.mtime = desc_.ctime;
 }
 
-int File::unlink()
+InodeRecord File::record() const noexcept
 {
-    for (auto const& chunk : chunks_)
-        chunk.fs->unlink(path_.c_str());
-    return 0;
+    return {
+        .ino        = ino_,
+        .kind       = InodeRecord::Kind::kFile,
+        .mode       = desc_.mode,
+        .owner_uid  = desc_.owner_uid,
+        .owner_gid  = desc_.owner_gid,
+        .flags      = desc_.flags,
+        .size       = desc_.size,
+        .atime      = desc_.atime,
+        .mtime      = desc_.mtime,
+        .ctime      = desc_.ctime,
+        .layout     = layout_,
+        .zero_block = zero_block_,
+        .data       = path_,
+    };
 }
 
-int File::chmod(mode_t mode, struct fuse_file_info* fi) noexcept
+void File::record_chunk(MetadataStore::Transaction& tx, size_t chunk_idx) const
 {
-    for (int i = 0; i < chunks_.size(); ++i) {
-        fuse_file_info mfi{};
-        if (fi && fi->fh) {
-            auto* v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-            mfi.fh  = (*v)[i].fh;
+    auto const& chunk = chunks_[chunk_idx];
+
+    std::vector<std::string_view> backends;
+    backends.reserve(chunk.replicas.size());
+    std::ranges::transform(chunk.replicas, std::back_inserter(backends), [this](auto const& replica) -> std::string_view { return fs(replica)->name(); });
+
+    tx.chunk({.ino = ino_, .chunk_idx = chunk_idx, .offset_range = chunk.offset_range, .backends = backends});
+}
+
+uint64_t File::journal_chunks(size_t first, size_t last)
+{
+    if (!store_)
+        return 0;
+
+    MetadataStore::Transaction tx;
+    tx.inode(record());
+    for (auto i = first; i < std::min(last, chunks_.size()); ++i)
+        record_chunk(tx, i);
+    tx.chunks(ino_, chunks_.size());
+
+    return store_->commit(std::move(tx));
+}
+
+void File::snapshot(MetadataStore::Transaction& tx) const
+{
+    std::shared_lock g{mtx_};
+
+    tx.inode(record());
+    // the chunks not created of a spilled file hold the ranges of its holes, whereas the ones of a fixed layout are implied by their indices
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        if (!layout_.fixed() || chunks_[i].created())
+            record_chunk(tx, i);
+    }
+    tx.chunks(ino_, chunks_.size());
+}
+
+void File::restore(InodeRecord const& record)
+{
+    assert(InodeRecord::Kind::kFile == record.kind);
+
+    std::lock_guard g{mtx_};
+    ino_            = record.ino;
+    path_           = record.data;
+    layout_         = record.layout;
+    zero_block_     = record.zero_block;
+    desc_.size      = record.size;
+    desc_.owner_uid = record.owner_uid;
+    desc_.owner_gid = record.owner_gid;
+    desc_.mode      = record.mode;
+    desc_.flags     = record.flags;
+    desc_.atime     = record.atime;
+    desc_.mtime     = record.mtime;
+    desc_.ctime     = record.ctime;
+}
+
+void File::restore_chunk(size_t chunk_idx, std::pair<size_t, size_t> offset_range, std::span<std::shared_ptr<Backend> const> backends)
+{
+    std::lock_guard g{mtx_};
+    if (chunks_.size() <= chunk_idx)
+        chunks_.resize(chunk_idx + 1);
+
+    auto& chunk        = chunks_[chunk_idx];
+    chunk.offset_range = offset_range;
+    chunk.replicas.clear();
+    for (auto const& backend : backends)
+        chunk.replicas.emplace_back(placement_->slot(backend));
+}
+
+void File::restore_chunks(size_t count)
+{
+    std::lock_guard g{mtx_};
+    chunks_.resize(count);
+}
+
+std::filesystem::path File::chunk_path(size_t chunk_idx) const
+{
+    return path_ + '.' + std::to_string(chunk_idx);
+}
+
+struct fuse_file_info* File::chunk_fi(size_t chunk_idx, size_t replica_idx, fuse_file_info& mfi, struct fuse_file_info const* fi) const
+{
+    // chunks of a file not opened are accessed by their paths
+    if (!fi || 0 == opens_)
+        return nullptr;
+
+    auto const& replica = chunks_[chunk_idx].replicas[replica_idx];
+
+    auto fh = replica.fh.load(std::memory_order_acquire);
+    if (kNoHandle == fh) {
+        fuse_file_info ofi{};
+        ofi.flags = kChunkFlags;
+        if (fs(replica)->open(chunk_path(chunk_idx), &ofi))
+            return nullptr;
+        // concurrent readers may open the replica simultaneously, the handle opened first is kept
+        if (replica.fh.compare_exchange_strong(fh, ofi.fh, std::memory_order_acq_rel))
+            fh = ofi.fh;
+        else
+            fs(replica)->release(chunk_path(chunk_idx), &ofi);
+    }
+
+    mfi.fh    = fh;
+    mfi.flags = kChunkFlags;
+    return &mfi;
+}
+
+std::vector<std::shared_ptr<Backend>> File::chunk_backends(size_t chunk_idx, bool siblings) const
+{
+    auto const backends_of = [this](Chunk const& chunk) {
+        return chunk.replicas | std::views::transform([this](Replica const& replica) { return fs(replica); });
+    };
+
+    std::vector<std::shared_ptr<Backend>> backends;
+    if (chunk_idx < chunks_.size())
+        std::ranges::copy(backends_of(chunks_[chunk_idx]), std::back_inserter(backends));
+
+    if (siblings && layout_.striped()) {
+        auto const set_first = chunk_idx / layout_.stripe_chunks() * layout_.stripe_chunks();
+        for (auto i = set_first; i < std::min(set_first + layout_.stripe_chunks(), chunks_.size()); ++i) {
+            if (i != chunk_idx)
+                std::ranges::copy(backends_of(chunks_[i]), std::back_inserter(backends));
+        }
+    }
+
+    return backends;
+}
+
+std::shared_ptr<Backend> File::place_chunk(size_t chunk_idx, Tier tier, size_t size)
+{
+    if (layout_.striped()) {
+        // the chunks of a stripe set are spread over distinct backends to be accessed in parallel and to fail independently
+        if (auto backend = placement_->place(chunk_backends(chunk_idx, true), tier, size))
+            return backend;
+        // there are not enough backends for every replica of a stripe set, so the chunks share them
+        return placement_->place(chunk_backends(chunk_idx, false), tier, size);
+    }
+
+    // the replicas of a chunk reside on distinct backends
+    auto excluded = chunk_backends(chunk_idx, false);
+    if (!layout_.fixed() && chunks_.size() == chunk_idx + 1) {
+        // an unbounded chunk grows until its backend runs out of space, there is no point in returning to the backend
+        for (auto const& chunk : chunks_)
+            std::ranges::transform(chunk.replicas, std::back_inserter(excluded), [this](Replica const& replica) { return fs(replica); });
+    }
+
+    return placement_->place(excluded, tier, size);
+}
+
+int File::create_chunk(size_t chunk_idx, size_t size)
+{
+    assert(chunk_idx < chunks_.size());
+    assert(!chunks_[chunk_idx].created());
+
+    auto const path = chunk_path(chunk_idx);
+    auto& chunk     = chunks_[chunk_idx];
+
+    // the replicas created before one fails are released and unlinked, the rest of the chunks are left alone
+    auto const discard = [&, this] {
+        for (auto const& replica : chunk.replicas) {
+            if (auto const fh = replica.fh.exchange(kNoHandle); kNoHandle != fh) {
+                fuse_file_info mfi{};
+                mfi.fh    = fh;
+                mfi.flags = kChunkFlags;
+                fs(replica)->release(path, &mfi);
+            }
+            fs(replica)->unlink(path);
         }
-        if (auto const r = chunks_[i].fs->chmod(path_.c_str(), mode, fi ? &mfi : nullptr))
+        chunk.replicas.clear();
+    };
+
+    for (size_t i = 0; i < layout_.copies; ++i) {
+        auto backend = place_chunk(chunk_idx, Tier::kFast, size);
+        if (!backend) {
+            discard();
+            return -ENOSPC;
+        }
+
+        // a chunk is always accessible for the owner, permissions of the file are checked against its descriptor
+        fuse_file_info mfi{};
+        mfi.flags = kChunkFlags | O_TRUNC;
+        if (auto const r = backend->create(path, desc_.mode | S_IRUSR | S_IWUSR, &mfi)) {
+            discard();
             return r;
+        }
+
+        auto& replica = chunk.replicas.emplace_back(placement_->slot(backend));
+        if (opens_)
+            replica.fh = mfi.fh;
+        else
+            fs(replica)->release(path, &mfi);
     }
-    desc_.mode  = S_IFREG | mode;
-    desc_.ctime = current_time();
+
+    streams_reset();
+
+    // a chunk appended to a spilled file ends the last chunk created before it, which is recorded along with the holes in between
+    auto first = chunk_idx;
+    if (!layout_.fixed()) {
+        while (0 < first && !chunks_[first - 1].created())
+            --first;
+        first -= 0 < first ? 1 : 0;
+    }
+    journal_chunks(first, chunk_idx + 1);
+
     return 0;
 }
 
-int File::chown(uid_t uid, gid_t gid, struct fuse_file_info* fi) noexcept
+int File::ensure_chunk(size_t chunk_idx, size_t size)
 {
-    for (int i = 0; i < chunks_.size(); ++i) {
-        fuse_file_info mfi{};
-        if (fi && fi->fh) {
-            auto* v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-            mfi.fh  = (*v)[i].fh;
+    assert(layout_.fixed());
+
+    if (chunk_idx < chunks_.size() && chunks_[chunk_idx].created())
+        return 0;
+
+    if (chunks_.size() <= chunk_idx)
+        chunks_.resize(chunk_idx + 1);
+
+    return create_chunk(chunk_idx, size);
+}
+
+int File::append_chunk(size_t boundary, size_t start, size_t size)
+{
+    assert(!layout_.fixed());
+    assert(chunks_.empty() || chunks_.back().offset_range.first <= boundary);
+    assert(boundary <= start);
+
+    // the last chunk ends at the boundary and the space up to the start of the new one is a hole holding no chunk,
+    // it gets a chunk of its own once written
+    auto const gap = boundary < start;
+    if (!chunks_.empty())
+        chunks_.back().offset_range.second = boundary;
+    if (gap)
+        chunks_.emplace_back(std::pair{boundary, start});
+    chunks_.emplace_back(std::pair{start, std::numeric_limits<size_t>::max()});
+
+    if (auto const r = create_chunk(chunks_.size() - 1, size)) {
+        chunks_.pop_back();
+        if (gap)
+            chunks_.pop_back();
+        if (!chunks_.empty())
+            chunks_.back().offset_range.second = std::numeric_limits<size_t>::max();
+        return r;
+    }
+
+    return 0;
+}
+
+void File::close_chunks() noexcept
+{
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        for (auto const& replica : chunks_[i].replicas) {
+            if (auto const fh = replica.fh.exchange(kNoHandle); kNoHandle != fh) {
+                fuse_file_info mfi{};
+                mfi.fh    = fh;
+                mfi.flags = kChunkFlags;
+                fs(replica)->release(chunk_path(i), &mfi);
+            }
         }
-        if (auto const r = chunks_[i].fs->chown(path_.c_str(), uid, gid, fi ? &mfi : nullptr))
-            return r;
     }
+}
+
+void File::streams_reset()
+{
+    for (auto const& backend : streams_) {
+        backend->unreserve(streams_reserved_);
+        backend->writer_detach();
+    }
+    streams_.clear();
+    streams_reserved_ = 0;
+
+    if (0 == writers_)
+        return;
+
+    // appending to a spilled file goes to its last chunk, whereas a striped one is written to the chunks of its last stripe set
+    auto streams = layout_.striped() ? layout_.stripe_chunks() : 1;
+    for (auto it = chunks_.rbegin(); chunks_.rend() != it && streams; ++it) {
+        if (!it->created())
+            continue;
+        for (auto const& replica : it->replicas) {
+            fs(replica)->writer_attach();
+            streams_.push_back(fs(replica));
+        }
+        --streams;
+    }
+}
+
+size_t File::streams_reserve(size_t growth)
+{
+    // a file written without a handle opened for writing has got no streams, it relies on the backends reporting ENOSPC
+    if (streams_.empty())
+        return growth;
+
+    if (streams_reserved_ < growth) {
+        // the space is reserved ahead of the writes, so that concurrent writers see it taken and place their chunks elsewhere
+        auto const wanted = std::max(growth, kStreamReservation) - streams_reserved_;
+
+        std::vector<size_t> reserved(streams_.size());
+        std::ranges::transform(streams_, reserved.begin(), [=](auto const& backend) { return backend->reserve(wanted); });
+
+        // every replica grows by the same number of bytes
+        auto const n = std::ranges::min(reserved);
+        for (size_t i = 0; i < streams_.size(); ++i)
+            streams_[i]->unreserve(reserved[i] - n);
+        streams_reserved_ += n;
+    }
+
+    return std::min(growth, streams_reserved_);
+}
+
+void File::streams_consume(size_t bytes) noexcept
+{
+    if (streams_.empty())
+        return;
+
+    bytes = std::min(bytes, streams_reserved_);
+    for (auto const& backend : streams_)
+        backend->consume(bytes);
+    streams_reserved_ -= bytes;
+}
+
+template <typename F>
+int File::for_each_replica(F f)
+{
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        for (size_t j = 0; j < chunks_[i].replicas.size(); ++j) {
+            if (auto const r = f(i, j))
+                return r;
+        }
+    }
+    return 0;
+}
+
+int File::unlink()
+{
+    std::lock_guard g{mtx_};
+    // the data is kept as long as the file is linked or open, the handles of a file unlinked may still be read and written by
+    if (0 != nlink_)
+        return 0;
+    if (0 != opens_) {
+        unlinked_ = true;
+        return 0;
+    }
+    // the chunks are moved out of the way at once and deleted by the backends in the background, however large they are
+    return truncate_chunks(0, nullptr);
+}
+
+int File::chmod(mode_t mode, struct fuse_file_info* /*fi*/) noexcept
+{
+    std::lock_guard g{mtx_};
+    desc_.mode  = S_IFREG | mode;
+    desc_.ctime = current_time();
+    stale_ |= kStaleMode;
+    return 0;
+}
+
+int File::chown(uid_t uid, gid_t gid, struct fuse_file_info* /*fi*/) noexcept
+{
+    std::lock_guard g{mtx_};
     desc_.owner_uid = uid;
     desc_.owner_gid = gid;
     desc_.ctime     = current_time();
+    stale_ |= kStaleOwner;
     return 0;
 }
 
-int File::truncate(size_t new_size, struct fuse_file_info* fi)
+void File::attributes_sync() noexcept
+{
+    // a change made from now on schedules a sync of its own
+    sync_scheduled_ = false;
+
+    // the descriptor is changed under the exclusive lock only, the chunks are not moved meanwhile either
+    std::shared_lock g{mtx_};
+    auto const stale = stale_.exchange(0);
+    if (0 == stale)
+        return;
+
+    uint8_t failed{0};
+    for_each_replica([&, this](size_t chunk_idx, size_t replica_idx) {
+        auto const& backend = fs(chunks_[chunk_idx].replicas[replica_idx]);
+        auto const path     = chunk_path(chunk_idx);
+        // a chunk is always accessible for the owner, as it is created
+        if ((stale & kStaleMode) && 0 != backend->chmod(path, (desc_.mode & ~S_IFMT) | S_IRUSR | S_IWUSR, nullptr))
+            failed |= kStaleMode;
+        if ((stale & kStaleOwner) && 0 != backend->chown(path, desc_.owner_uid, desc_.owner_gid, nullptr))
+            failed |= kStaleOwner;
+#ifdef HAVE_UTIMENSAT
+        if (stale & kStaleTimes) {
+            std::array const ts{desc_.atime, desc_.mtime};
+            if (0 != backend->utimens(path, ts.data(), nullptr))
+                failed |= kStaleTimes;
+        }
+#endif
+        return 0;
+    });
+
+    // the attributes failed to be brought up to date are kept stale, so they are synced again along with the next change
+    if (0 != failed) {
+        stale_ |= failed;
+        attributes_failures_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int File::truncate_chunks(size_t new_size, struct fuse_file_info* fi)
 {
-    for (int i = 0; i < chunks_.size(); ++i) {
+    // the space past the end of a file extended is a hole read as zeros, the chunks are not written to nor extended
+    if (desc_.size < new_size)
+        return 0;
+
+    struct Cut {
+        size_t chunk_idx;
+        size_t replica_idx;
+        size_t length; ///< Length the chunk is cut to, 0 if the chunk is dropped
+        int result;
+    };
+
+    // the chunk crossed by the new end is cut to the length it holds of the file, whereas the chunks wholly past the end are dropped
+    std::vector<Cut> cuts;
+    std::vector<Cut> drops;
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        if (!chunks_[i].created())
+            continue;
+
+        auto const& [first, second] = chunks_[i].offset_range;
+        auto const length           = layout_.fixed() ? layout_.chunk_length(i, new_size) : new_size - std::min(first, new_size);
+        auto const cut              = layout_.fixed() ? length < layout_.chunk_length(i, desc_.size) : new_size < second;
+        if (length && !cut)
+            continue;
+
+        for (size_t j = 0; j < chunks_[i].replicas.size(); ++j)
+            (length ? cuts : drops).push_back({i, j, length, 0});
+    }
+
+    // the replicas of all the chunks are cut in parallel, nothing is dropped unless every cut succeeded
+    for (auto const& cut : cuts)
+        chunks_[cut.chunk_idx].generation.fetch_add(1, std::memory_order_relaxed);
+    parallel_for_each(cuts, [&](Cut& cut) {
         fuse_file_info mfi{};
-        if (fi && fi->fh) {
-            auto* v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-            mfi.fh  = (*v)[i].fh;
+        cut.result = fs(chunks_[cut.chunk_idx].replicas[cut.replica_idx])->truncate(
+            chunk_path(cut.chunk_idx), static_cast<off_t>(cut.length), chunk_fi(cut.chunk_idx, cut.replica_idx, mfi, fi));
+    });
+    if (auto const it = std::ranges::find_if(cuts, [](auto const& cut) { return cut.result < 0; }); cuts.end() != it)
+        return it->result;
+
+    if (!drops.empty()) {
+        // the chunks dropped are taken off the chunk map first, which is made durable before they are moved out of the way, so that the map
+        // kept in the metadata store never refers to chunks gone
+        std::vector<std::pair<size_t, Replica>> dropped;
+        dropped.reserve(drops.size());
+        for (auto const& drop : drops)
+            dropped.emplace_back(drop.chunk_idx, std::move(chunks_[drop.chunk_idx].replicas[drop.replica_idx]));
+        for (auto const& drop : drops) {
+            chunks_[drop.chunk_idx].generation.fetch_add(1, std::memory_order_relaxed);
+            chunks_[drop.chunk_idx].replicas.clear();
         }
-        if (auto const r = chunks_[i].fs->truncate(path_.c_str(), new_size, fi ? &mfi : nullptr))
-            return r;
+
+        // the chunk map ends with the last chunk created, the last chunk of a spilled file becomes unbounded and holds the hole left past it
+        while (!chunks_.empty() && !chunks_.back().created())
+            chunks_.pop_back();
+        if (!layout_.fixed() && !chunks_.empty())
+            chunks_.back().offset_range.second = std::numeric_limits<size_t>::max();
+
+        ++shrinks_;
+        streams_reset();
+
+        auto const first = std::min(drops.front().chunk_idx, chunks_.empty() ? 0 : chunks_.size() - 1);
+        if (auto const lsn = journal_chunks(first, chunks_.size())) {
+            if (auto const r = store_->sync(lsn))
+                return r;
+        }
+
+        // the chunks dropped are deleted by the backends in the background, which may take long for large chunks
+        parallel_for_each(dropped, [&](auto& drop) {
+            auto& [chunk_idx, replica] = drop;
+            if (auto const fh = replica.fh.exchange(kNoHandle); kNoHandle != fh) {
+                fuse_file_info mfi{};
+                mfi.fh    = fh;
+                mfi.flags = kChunkFlags;
+                fs(replica)->release(chunk_path(chunk_idx), &mfi);
+            }
+            fs(replica)->discard(chunk_path(chunk_idx));
+        });
     }
+
+    if (!layout_.coded() || 0 == new_size % layout_.stripe_size() || new_size == desc_.size)
+        return 0;
+
+    // the data of the stripe cut by the end of the file is gone past the end, so its parity is recomputed out of the data left
+    auto const stripe_start              = new_size / layout_.stripe_size() * layout_.stripe_size();
+    auto const [chunk_idx, chunk_offset] = layout_.locate(stripe_start);
+    if (chunks_.size() <= chunk_idx || !chunks_[chunk_idx].created())
+        return 0;
+
+    std::vector<std::byte> data(new_size - stripe_start);
+    if (auto const r = read_fixed(data, stripe_start, fi); r < 0)
+        return static_cast<int>(r);
+
+    auto const r = write_stripe(chunk_idx, chunk_offset, 0, data, fi);
+    return r < 0 ? static_cast<int>(r) : 0;
+}
+
+int File::truncate(size_t new_size, struct fuse_file_info* fi)
+{
+    std::lock_guard g{mtx_};
+    if (auto const r = truncate_chunks(new_size, fi))
+        return r;
+    truncate(new_size);
     return 0;
 }
 
 int File::open(struct fuse_file_info* fi)
 {
-    std::vector<fuse_file_info>* v{nullptr};
-    if (fi) {
-        if (0x0 == fi->fh)
-            fi->fh = reinterpret_cast<uintptr_t>(new std::vector<fuse_file_info>{fss_.size(), *fi});
-        v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-    }
-    for (int i = 0; i < chunks_.size(); ++i) {
-        fuse_file_info mfi{};
-        if (fi)
-            mfi.flags = (*v)[i].flags;
-        if (auto const r = chunks_[i].fs->open(path_.c_str(), fi ? &mfi : nullptr))
+    if (!fi)
+        return 0;
+
+    std::lock_guard g{mtx_};
+    if ((fi->flags & O_TRUNC) && (fi->flags & (O_WRONLY | O_RDWR))) {
+        if (auto const r = truncate_chunks(0, nullptr))
             return r;
-        if (v)
-            (*v)[i].fh = mfi.fh;
-    }
-    if (fi && (fi->flags & O_TRUNC) && (fi->flags & (O_WRONLY | O_RDWR)))
         truncate(0);
+    }
+
+    ++opens_;
+    if (is_writable(fi) && 1 == ++writers_)
+        streams_reset();
     return 0;
 }
 
 int File::release(struct fuse_file_info* fi) noexcept
 {
-    for (int i = 0; i < chunks_.size(); ++i) {
-        fuse_file_info mfi{};
-        if (fi && fi->fh) {
-            auto* v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-            mfi.fh  = (*v)[i].fh;
+    if (!fi)
+        return 0;
+
+    std::lock_guard g{mtx_};
+    if (is_writable(fi) && writers_ && 0 == --writers_)
+        streams_reset();
+    if (opens_ && 0 == --opens_) {
+        close_chunks();
+        // the data of the file unlinked while open is deleted along with the last of its handles
+        if (std::exchange(unlinked_, false)) {
+            try {
+                return truncate_chunks(0, nullptr);
+            } catch (...) {
+                return -EIO;
+            }
         }
-        if (auto const r = chunks_[i].fs->release(path_.c_str(), fi ? &mfi : nullptr))
-            return r;
-    }
-    if (fi && fi->fh) {
-        delete reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-        fi->fh = 0x0;
     }
     return 0;
 }
 
 #ifdef HAVE_UTIMENSAT
-int File::utimens(const struct timespec ts[2], struct fuse_file_info* fi) noexcept
+int File::utimens(const struct timespec ts[2], struct fuse_file_info* /*fi*/) noexcept
 {
-    for (int i = 0; i < chunks_.size(); ++i) {
-        fuse_file_info mfi{};
-        if (fi && fi->fh) {
-            auto* v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
-            mfi.fh  = (*v)[i].fh;
-        }
-        chunks_[i].fs->utimens(path_.c_str(), ts, fi ? &mfi : nullptr);
-    }
-
+    std::lock_guard g{mtx_};
     auto const cur_time = current_time();
 
     if (UTIME_NOW == ts[0].tv_nsec)
@@ -156,8 +733,10 @@ int File::utimens(const struct timespec ts[2], struct fuse_file_info* fi) noexce
     else if (UTIME_OMIT != ts[1].tv_nsec)
         desc_.mtime = ts[1];
 
-    if (UTIME_OMIT != ts[0].tv_nsec || UTIME_OMIT != ts[1].tv_nsec)
+    if (UTIME_OMIT != ts[0].tv_nsec || UTIME_OMIT != ts[1].tv_nsec) {
         desc_.ctime = cur_time;
+        stale_ |= kStaleTimes;
+    }
 
     return 0;
 }
@@ -166,136 +745,1077 @@ int File::utimens(const struct timespec ts[2], struct fuse_file_info* fi) noexce
 #ifdef HAVE_POSIX_FALLOCATE
 off_t File::fallocate(int mode, off_t offset, off_t length, struct fuse_file_info* fi)
 {
-    // TODO: implement the function
-    return -EINVAL;
-}
-#endif
+    if (offset < 0 || length <= 0)
+        return -EINVAL;
 
-ssize_t File::write(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
-{
-    ssize_t wb{0};
+    // a hole is punched keeping the size of the file as the kernel requires, space is allocated and zeroed either way
+    auto const keep_size = 0 != (mode & FALLOC_FL_KEEP_SIZE);
+    switch (mode & ~FALLOC_FL_KEEP_SIZE) {
+        case 0:
+        case FALLOC_FL_ZERO_RANGE:
+            break;
+        case FALLOC_FL_PUNCH_HOLE:
+            if (keep_size)
+                break;
+            [[fallthrough]];
+        default:
+            return -EOPNOTSUPP;
+    }
 
-    std::vector<fuse_file_info>* v{nullptr};
-    if (fi && 0 != fi->fh)
-        v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
+    std::lock_guard g{mtx_};
 
-    if (buf.empty())
-        return 0;
+    auto const start = static_cast<size_t>(offset);
+    auto const n     = static_cast<size_t>(length);
 
-    for (auto chunk_it = std::ranges::upper_bound(chunks_, offset, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
-         wb < buf.size();) {
+    int r;
+    if (layout_.coded())
+        r = fallocate_coded(mode, start, n, fi);
+    else
+        r = layout_.fixed() ? fallocate_fixed(mode, start, n, fi) : fallocate_spilled(mode, start, n, fi);
+    if (r)
+        return r;
 
-        if (chunks_.end() == chunk_it) {
-            if (fss_.end() == fs_next_it_)
-                return -ENOSPC;
+    auto const size = desc_.size;
+    if (!keep_size)
+        desc_.size = std::max(desc_.size, start + n);
+    if (size != desc_.size || 0 != (mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE))) {
+        desc_.mtime = current_time();
+        desc_.ctime = desc_.mtime;
+    }
 
-            chunks_.push_back({.offset_range = {static_cast<size_t>(offset), std::numeric_limits<size_t>::max()}, .fs = *fs_next_it_++});
+    return 0;
+}
 
-            chunk_it = chunks_.end() - 1;
-            if (chunks_.begin() < chunk_it)
-                chunk_it[-1].offset_range.second = chunk_it->offset_range.first;
+int File::fallocate_segments(int mode, std::span<Segment> segments, struct fuse_file_info* fi)
+{
+    auto const chunk_idxs = segments_chunks(segments);
 
-            fuse_file_info mfi{};
-            if (v)
-                mfi.flags = (*v)[chunk_it - chunks_.begin()].flags;
+    // the replicas of a chunk are given the same ranges, the chunks are done in parallel
+    parallel_for_each(chunk_idxs, [&](size_t chunk_idx) {
+        auto& chunk = chunks_[chunk_idx];
+        if (!chunk.created())
+            return;
 
-            if (auto const r = chunk_it->fs->create(path_.c_str(), desc_.mode, fi ? &mfi : nullptr)) {
-                chunks_.erase(chunk_it);
-                return r;
-            }
+        chunk.generation.fetch_add(1, std::memory_order_relaxed);
 
-            if (v)
-                (*v)[chunk_it - chunks_.begin()].fh = mfi.fh;
+        auto const path = chunk_path(chunk_idx);
+        for (auto& segment : segments | std::views::filter([=](auto const& segment) { return chunk_idx == segment.chunk_idx; })) {
+            for (size_t replica_idx = 0; replica_idx < chunk.replicas.size() && 0 <= segment.result; ++replica_idx) {
+                fuse_file_info mfi{};
+                segment.result = fs(chunk.replicas[replica_idx])->fallocate(
+                    path, mode, segment.chunk_offset, segment.length, chunk_fi(chunk_idx, replica_idx, mfi, fi));
+            }
+            if (segment.result < 0)
+                break;
         }
+    });
 
-        for (; wb < buf.size() && chunks_.end() != chunk_it; ++chunk_it) {
-            assert(chunk_it->offset_range.first <= offset && offset < chunk_it->offset_range.second);
-
-            fuse_file_info mfi{};
-            if (v) {
-                mfi.fh    = (*v)[chunk_it - chunks_.begin()].fh;
-                mfi.flags = fi->flags;
-            }
+    auto const it = std::ranges::find_if(segments, [](auto const& segment) { return segment.result < 0; });
+    return segments.end() == it ? 0 : static_cast<int>(it->result);
+}
 
-            auto const chunk{buf.subspan(wb, std::min(buf.size() - wb, chunk_it->offset_range.second - offset))};
+int File::fallocate_fixed(int mode, size_t offset, size_t length, struct fuse_file_info* fi)
+{
+    auto segments = this->segments(length, offset);
 
-            auto const r = chunk_it->fs->write(path_.c_str(), chunk, offset - chunk_it->offset_range.first, fi ? &mfi : nullptr);
-            if (r < 0) {
-                if (-ENOSPC == r && (chunks_.end() - 1 == chunk_it))
-                    continue;
+    // holes are punched in the chunks there are, whereas the chunks missing are created up front, each on a backend having got the space
+    // it is to take. The space is accounted for right away, so that the chunks following are spread over the rest of the backends
+    if (0 == (mode & FALLOC_FL_PUNCH_HOLE)) {
+        for (auto const chunk_idx : segments_chunks(segments)) {
+            size_t size{0};
+            for (auto const& segment : segments | std::views::filter([=](auto const& segment) { return chunk_idx == segment.chunk_idx; }))
+                size += segment.length;
+            if (auto const r = ensure_chunk(chunk_idx, size))
                 return r;
-            }
-
-            wb += r;
-            offset += r;
-
-            desc_.size = std::max(desc_.size, static_cast<size_t>(offset));
-
-            if (r < chunk.size())
-                return wb;
+            for (auto const& replica : chunks_[chunk_idx].replicas)
+                fs(replica)->consume(fs(replica)->reserve(size));
         }
     }
 
-    return wb;
+    return fallocate_segments(mode, segments, fi);
 }
 
-ssize_t File::read(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const noexcept
+int File::fallocate_coded(int mode, size_t offset, size_t length, struct fuse_file_info* fi)
 {
-    ssize_t rb{0};
-
-    std::vector<fuse_file_info>* v{nullptr};
-    if (fi && 0 != fi->fh)
-        v = reinterpret_cast<std::vector<fuse_file_info>*>(fi->fh);
+    // zeroing the data changes the parity, so zeros are written rather than holes are punched, the space of a stripe written is allocated anyway
+    if (0 != (mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE))) {
+        auto const end = 0 != (mode & FALLOC_FL_KEEP_SIZE) ? std::min(offset + length, desc_.size) : offset + length;
+        std::vector<std::byte> const zeros(std::min(end - std::min(offset, end), kMoveBlockSize));
+        for (auto pos = offset; pos < end;) {
+            auto const r = write_coded(std::span{zeros}.first(std::min(zeros.size(), end - pos)), static_cast<off_t>(pos), fi);
+            if (r < 0)
+                return static_cast<int>(r);
+            pos += static_cast<size_t>(r);
+        }
+        return 0;
+    }
 
-    offset = std::min(static_cast<size_t>(offset), desc_.size);
-    buf    = buf.subspan(0, std::min(buf.size(), desc_.size - offset));
+    // the parity of the stripes allocated takes the same ranges of the parity chunks of their stripe sets as the data does of the data chunks
+    auto segments = this->segments(length, offset);
+    for (size_t i = 0, data_segments = segments.size(); i < data_segments; ++i) {
+        auto const set_first = segments[i].chunk_idx / layout_.stripe_chunks() * layout_.stripe_chunks();
+        for (size_t p = 0; p < layout_.parity; ++p) {
+            auto parity        = segments[i];
+            parity.chunk_idx   = set_first + layout_.stripe_width + p;
+            segments.push_back(parity);
+        }
+    }
 
-    if (!buf.empty()) {
-        auto chunk_it = std::ranges::upper_bound(chunks_, offset, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
-        for (; rb < buf.size(); ++chunk_it) {
-            assert(chunks_.end() != chunk_it);
-            assert(chunk_it->offset_range.first <= offset && offset < chunk_it->offset_range.second);
+    for (auto const chunk_idx : segments_chunks(segments)) {
+        if (auto const r = ensure_chunk(chunk_idx))
+            return r;
+    }
 
-            fuse_file_info mfi{};
-            if (v) {
-                mfi.fh    = (*v)[chunk_it - chunks_.begin()].fh;
-                mfi.flags = fi->flags;
+    return fallocate_segments(mode, segments, fi);
+}
+
+int File::fallocate_spilled(int mode, size_t offset, size_t length, struct fuse_file_info* fi)
+{
+    auto const end = offset + length;
+
+    std::vector<Segment> segments;
+    auto const add = [&](size_t chunk_idx, size_t from, size_t to) {
+        auto const chunk_offset = from - chunks_[chunk_idx].offset_range.first;
+        segments.push_back({.chunk_idx = chunk_idx, .chunk_offset = chunk_offset, .buf_offset = 0, .length = to - from, .result = 0});
+    };
+
+    // the range up to the end of the data goes to the chunks holding it
+    auto const tail = chunks_.empty() ? 0 : std::max(desc_.size, chunks_.back().offset_range.first);
+    auto chunk_it   = std::ranges::upper_bound(chunks_, offset, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
+    for (auto pos = offset; pos < std::min(end, tail) && chunks_.end() != chunk_it; ++chunk_it) {
+        auto const chunk_idx = static_cast<size_t>(chunk_it - chunks_.begin());
+        auto const to        = std::min({end, tail, chunk_it->offset_range.second});
+
+        // a hole is left alone unless space is to be allocated in it
+        if (!chunk_it->created() && 0 == (mode & FALLOC_FL_PUNCH_HOLE)) {
+            if (auto const r = create_chunk(chunk_idx, to - pos))
+                return r;
+        }
+        add(chunk_idx, pos, to);
+        pos = to;
+    }
+
+    // there are no holes to be punched beyond the data, whereas the space to be allocated there is planned across the backends up front:
+    // the last chunk takes as much as the space left on its backends lets it and the rest goes to new chunks placed on the backends having got it
+    if (0 == (mode & FALLOC_FL_PUNCH_HOLE) && tail < end) {
+        if (chunks_.empty()) {
+            if (auto const r = append_chunk(0, offset / placement_->block_size() * placement_->block_size(), length))
+                return r;
+        }
+
+        for (auto pos = std::max(offset, tail); pos < end;) {
+            auto const& last = chunks_.back();
+
+            size_t room{end - pos};
+            if (streams_.empty()) {
+                for (auto const& replica : last.replicas)
+                    room = std::min(room, fs(replica)->free_space());
+            } else {
+                room = streams_reserve(end - pos);
+            }
+
+            // an empty chunk takes all of it, a new chunk would not have got more space
+            auto to               = end;
+            auto const block_size = fs(last.replicas.front())->block_size();
+            if (room < end - pos && (last.offset_range.first < pos || block_size <= room))
+                to = std::max(pos, (pos + room) / block_size * block_size);
+
+            if (pos < to) {
+                add(chunks_.size() - 1, pos, to);
+                streams_consume(to - pos);
+                pos = to;
+            }
+            if (end == pos)
+                break;
+
+            if (auto const r = append_chunk(pos, pos, end - pos)) {
+                // there is no backend to continue on, so the last chunk is given the rest as long as its backends let it
+                add(chunks_.size() - 1, pos, end);
+                break;
             }
+        }
+    }
+
+    return fallocate_segments(mode, segments, fi);
+}
+#endif
+
+std::vector<File::Segment> File::segments(size_t length, off_t offset) const
+{
+    std::vector<Segment> segments;
+
+    for (size_t done = 0; done < length;) {
+        auto const [chunk_idx, chunk_offset] = layout_.locate(offset + done);
+        auto const n                         = std::min(length - done, layout_.extent(offset + done));
+        segments.push_back({.chunk_idx = chunk_idx, .chunk_offset = chunk_offset, .buf_offset = done, .length = n, .result = 0});
+        done += n;
+    }
+
+    return segments;
+}
+
+std::vector<size_t> File::segments_chunks(std::span<Segment const> segments)
+{
+    std::vector<size_t> chunk_idxs;
+    chunk_idxs.reserve(segments.size());
+    std::ranges::transform(segments, std::back_inserter(chunk_idxs), &Segment::chunk_idx);
+    std::ranges::sort(chunk_idxs);
+    chunk_idxs.erase(std::ranges::unique(chunk_idxs).begin(), chunk_idxs.end());
+    return chunk_idxs;
+}
+
+ssize_t File::segments_result(std::span<Segment const> segments) noexcept
+{
+    // only the leading segments done completely count
+    ssize_t res{0};
+    for (auto const& segment : segments) {
+        if (segment.result < 0)
+            return res ? res : segment.result;
+        res += segment.result;
+        if (static_cast<size_t>(segment.result) < segment.length)
+            break;
+    }
+    return res;
+}
+
+ssize_t File::write_chunk(size_t chunk_idx, std::span<std::byte const> buf, size_t chunk_offset, struct fuse_file_info const* fi)
+{
+    auto& chunk = chunks_[chunk_idx];
+    assert(chunk.created());
+
+    chunk.generation.fetch_add(1, std::memory_order_relaxed);
+    chunk.heat.fetch_add(1, std::memory_order_relaxed);
+
+    auto const path = chunk_path(chunk_idx);
+
+    std::vector<ssize_t> results(chunk.replicas.size());
+    parallel_for_each(std::views::iota(size_t{0}, results.size()), [&](size_t replica_idx) {
+        fuse_file_info mfi{};
+        results[replica_idx] = fs(chunk.replicas[replica_idx])->write(path, buf, chunk_offset, chunk_fi(chunk_idx, replica_idx, mfi, fi));
+    });
+
+    // the replicas are consistent up to the least of them written
+    if (auto const it = std::ranges::find_if(results, [](auto r) { return r < 0; }); results.end() != it)
+        return *it;
+    return std::ranges::min(results);
+}
+
+ssize_t File::read_chunk(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const
+{
+    auto const& chunk = chunks_[chunk_idx];
+    assert(chunk.created());
+
+    chunk.heat.fetch_add(1, std::memory_order_relaxed);
+
+    auto const path = chunk_path(chunk_idx);
+
+    // replicas are tried in the order of the time they are expected to respond in
+    std::vector<size_t> order(chunk.replicas.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::ranges::sort(order, std::less<>{}, [&](size_t replica_idx) { return expected_wait(*fs(chunk.replicas[replica_idx])); });
+
+    ssize_t r{-EIO};
+    size_t next{0};
+
+    if (1 < order.size()) {
+        // the read is hedged by another replica once it takes longer than the most of reads from the backend
+        if (auto const threshold = fs(chunk.replicas[order[0]])->read_p99(); threshold.count()) {
+            fuse_file_info mfi{};
+            r = read_hedged(path,
+                buf,
+                chunk_offset,
+                fs(chunk.replicas[order[0]]),
+                chunk_fi(chunk_idx, order[0], mfi, fi),
+                fs(chunk.replicas[order[1]]),
+                threshold);
+            if (r >= 0)
+                return r;
+            next = 1;
+        }
+    }
+
+    // a replica failing is backed by the next one
+    for (; next < order.size(); ++next) {
+        fuse_file_info mfi{};
+        r = fs(chunk.replicas[order[next]])->read(path, buf, chunk_offset, chunk_fi(chunk_idx, order[next], mfi, fi));
+        if (r >= 0)
+            break;
+    }
+
+    return r;
+}
+
+ssize_t File::read_filled(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const
+{
+    // the space of a chunk not created or beyond the end of a chunk within the file size is a hole
+    ssize_t r{0};
+    if (chunk_idx < chunks_.size() && chunks_[chunk_idx].created()) {
+        r = read_chunk(chunk_idx, buf, chunk_offset, fi);
+        if (r < 0)
+            return r;
+    }
+    std::memset(buf.data() + r, 0, buf.size() - r);
+    return static_cast<ssize_t>(buf.size());
+}
+
+ssize_t File::read_column(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const
+{
+    auto const r = read_filled(chunk_idx, buf, chunk_offset, fi);
+    if (r >= 0 || !layout_.coded())
+        return r;
+
+    // the chunk unavailable is rebuilt out of the same range of the rest of the chunks of its stripe set
+    auto const set_first = chunk_idx / layout_.stripe_chunks() * layout_.stripe_chunks();
+
+    std::vector<std::byte> scratch((layout_.stripe_chunks() - 1) * buf.size());
+    std::vector<std::byte*> columns(layout_.stripe_chunks());
+    for (size_t i = 0, j = 0; i < columns.size(); ++i)
+        columns[i] = set_first + i == chunk_idx ? buf.data() : scratch.data() + j++ * buf.size();
+
+    std::vector<ssize_t> results(columns.size(), r);
+    parallel_for_each(std::views::iota(size_t{0}, columns.size()), [&](size_t i) {
+        if (set_first + i != chunk_idx)
+            results[i] = read_filled(set_first + i, {columns[i], buf.size()}, chunk_offset, fi);
+    });
+
+    std::vector<size_t> lost;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i] < 0)
+            lost.push_back(i);
+    }
+
+    if (!ErasureCode{layout_.stripe_width, layout_.parity}.decode(columns, lost, buf.size()))
+        return r;
+
+    return static_cast<ssize_t>(buf.size());
+}
+
+ssize_t File::write_stripe(size_t chunk_idx, size_t chunk_offset, size_t stripe_offset, std::span<std::byte const> buf, struct fuse_file_info const* fi)
+{
+    auto const unit   = layout_.stripe_unit;
+    auto const width  = layout_.stripe_width;
+    auto const parity = layout_.parity;
+    auto const begin  = stripe_offset;
+    auto const end    = stripe_offset + buf.size();
+
+    // the parity is recomputed over the range of the units the stripe is changed within
+    auto const single = begin / unit == (end - 1) / unit;
+    auto const lo     = single ? begin % unit : 0;
+    auto const hi     = single ? (end - 1) % unit + 1 : unit;
+    auto const length = hi - lo;
+
+    // the part of the range of the data unit given, which is written
+    auto const written = [&](size_t i) { return std::pair{std::clamp(i * unit + lo, begin, end), std::clamp(i * unit + hi, begin, end)}; };
+
+    // the units written over the range as a whole are taken from the request as they are, the rest are read and merged with the request,
+    // so that a full stripe write does not read anything
+    std::vector<std::byte const*> data(width);
+    std::vector<size_t> merged;
+    for (size_t i = 0; i < width; ++i) {
+        if (written(i) == std::pair{i * unit + lo, i * unit + hi})
+            data[i] = buf.data() + (i * unit + lo - begin);
+        else
+            merged.push_back(i);
+    }
+
+    std::vector<std::byte> scratch((parity + merged.size()) * length);
+    std::vector<std::byte*> parities(parity);
+    for (size_t j = 0; j < parity; ++j)
+        parities[j] = scratch.data() + j * length;
+
+    std::vector<ssize_t> results(merged.size());
+    parallel_for_each(std::views::iota(size_t{0}, merged.size()), [&](size_t k) {
+        auto const i       = merged[k];
+        auto* const column = scratch.data() + (parity + k) * length;
+        results[k]         = read_column(chunk_idx + i, {column, length}, chunk_offset + lo, fi);
+        if (auto const [wb, we] = written(i); wb < we)
+            std::memcpy(column + (wb - i * unit - lo), buf.data() + (wb - begin), we - wb);
+        data[i] = column;
+    });
+    if (auto const it = std::ranges::find_if(results, [](auto r) { return r < 0; }); results.end() != it)
+        return *it;
+
+    ErasureCode{width, parity}.encode(data, parities, length);
+
+    struct Piece {
+        size_t chunk_idx;
+        std::span<std::byte const> data;
+        size_t chunk_offset;
+    };
+
+    std::vector<Piece> pieces;
+    for (size_t i = 0; i < width; ++i) {
+        if (auto const [wb, we] = written(i); wb < we)
+            pieces.push_back({.chunk_idx = chunk_idx + i, .data = buf.subspan(wb - begin, we - wb), .chunk_offset = chunk_offset + wb - i * unit});
+    }
+    for (size_t j = 0; j < parity; ++j)
+        pieces.push_back({.chunk_idx = chunk_idx + width + j, .data = {parities[j], length}, .chunk_offset = chunk_offset + lo});
+
+    results.assign(pieces.size(), 0);
+    parallel_for_each(std::views::iota(size_t{0}, pieces.size()), [&](size_t k) {
+        results[k] = write_chunk(pieces[k].chunk_idx, pieces[k].data, pieces[k].chunk_offset, fi);
+    });
+
+    // a stripe written partially is inconsistent with its parity, so it does not count
+    for (size_t k = 0; k < pieces.size(); ++k) {
+        if (results[k] < 0)
+            return results[k];
+        if (static_cast<size_t>(results[k]) < pieces[k].data.size())
+            return -EIO;
+    }
+
+    return static_cast<ssize_t>(buf.size());
+}
+
+ssize_t File::write(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    if (buf.empty())
+        return 0;
+
+    std::lock_guard g{mtx_};
+    return zero_block_ ? write_sparse(buf, offset, fi) : write_dense(buf, offset, fi);
+}
 
-            auto const chunk{buf.subspan(rb, std::min(buf.size() - rb, chunk_it->offset_range.second - offset))};
+ssize_t File::write_dense(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    if (layout_.coded())
+        return write_coded(buf, offset, fi);
+    return layout_.fixed() ? write_fixed(buf, offset, fi) : write_spilled(buf, offset, fi);
+}
 
-            auto const r = chunk_it->fs->read(path_.c_str(), chunk, offset - chunk_it->offset_range.first, fi ? &mfi : nullptr);
+int File::punch(size_t offset, size_t length, struct fuse_file_info* fi)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    // zeroing data of a coded layout changes the parity, so the zeros are to be written
+    if (!layout_.coded()) {
+        auto const mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+        return layout_.fixed() ? fallocate_fixed(mode, offset, length, fi) : fallocate_spilled(mode, offset, length, fi);
+    }
+#endif
+    return -EOPNOTSUPP;
+}
+
+ssize_t File::write_sparse(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    ZeroDetector const detector;
+
+    // the request is cut into runs of the blocks holding zeros only and of the rest, a block cut by either end of the request counts as data
+    auto const start = static_cast<size_t>(offset);
+    auto const next  = [&](size_t pos) { return std::min(buf.size(), (start + pos) / zero_block_ * zero_block_ + zero_block_ - start); };
+    auto const zero  = [&](size_t pos) {
+        auto const block = buf.subspan(pos, next(pos) - pos);
+        return zero_block_ == block.size() && detector.zero(block);
+    };
+
+    size_t done{0};
+    while (done < buf.size()) {
+        auto const zeros = zero(done);
+        auto end         = next(done);
+        while (end < buf.size() && zero(end) == zeros)
+            end = next(end);
+
+        auto const run = buf.subspan(done, end - done);
+        auto const pos = start + done;
+
+        // zeros past the end of the data are a hole already, whereas the data they overwrite is punched out unless it cannot be done
+        auto n = run.size();
+        if (zeros) {
+            n = pos < desc_.size ? std::min(run.size(), desc_.size - pos) : 0;
+            if (n && 0 == punch(pos, n, fi))
+                n = 0;
+        }
+
+        if (n) {
+            auto const r = write_dense(run.first(n), static_cast<off_t>(pos), fi);
             if (r < 0)
+                return done ? static_cast<ssize_t>(done) : r;
+            if (static_cast<size_t>(r) < n)
+                return static_cast<ssize_t>(done + r);
+        }
+
+        done       = end;
+        desc_.size = std::max(desc_.size, start + done);
+    }
+
+    return static_cast<ssize_t>(done);
+}
+
+ssize_t File::write_fixed(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    auto segments         = this->segments(buf.size(), offset);
+    auto const chunk_idxs = segments_chunks(segments);
+
+    // chunks get created up front, so that the chunk map does not change while the chunks are written in parallel
+    for (auto const chunk_idx : chunk_idxs) {
+        if (auto const r = ensure_chunk(chunk_idx)) {
+            if (chunk_idx == segments.front().chunk_idx)
+                return r;
+            // the part of the request up to the chunk not created is still written
+            std::ranges::for_each(segments | std::views::filter([=](auto const& segment) { return chunk_idx == segment.chunk_idx; }),
+                [=](auto& segment) { segment.result = r; });
+        }
+    }
+
+    parallel_for_each(chunk_idxs, [&](size_t chunk_idx) {
+        if (!chunks_[chunk_idx].created())
+            return;
+
+        for (auto& segment : segments | std::views::filter([=](auto const& segment) { return chunk_idx == segment.chunk_idx; })) {
+            segment.result = write_chunk(chunk_idx, buf.subspan(segment.buf_offset, segment.length), segment.chunk_offset, fi);
+            if (segment.result < 0 || static_cast<size_t>(segment.result) < segment.length)
+                break;
+        }
+    });
+
+    auto const wb = segments_result(segments);
+    if (wb > 0)
+        desc_.size = std::max(desc_.size, static_cast<size_t>(offset + wb));
+
+    return wb;
+}
+
+ssize_t File::write_coded(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    auto const stripe_size = layout_.stripe_size();
+
+    // a segment per stripe, which is written along with its parity, the chunk of a segment is the first one of the stripe set
+    // and the chunk offset is the one of the stripe within the chunks of the set
+    std::vector<Segment> segments;
+    for (size_t done = 0; done < buf.size();) {
+        auto const stripe_start              = (offset + done) / stripe_size * stripe_size;
+        auto const [chunk_idx, chunk_offset] = layout_.locate(stripe_start);
+        auto const n                         = std::min(buf.size() - done, stripe_start + stripe_size - (offset + done));
+        segments.push_back({.chunk_idx = chunk_idx, .chunk_offset = chunk_offset, .buf_offset = done, .length = n, .result = 0});
+        done += n;
+    }
+
+    auto const ensure_set = [this](size_t set_first) {
+        for (size_t i = 0; i < layout_.stripe_chunks(); ++i) {
+            if (auto const r = ensure_chunk(set_first + i))
+                return r;
+        }
+        return 0;
+    };
+
+    // all the chunks of the stripe sets get created up front, a stripe set lacking a chunk is not written
+    for (auto it = segments.begin(); segments.end() != it; ++it) {
+        if (auto const r = ensure_set(it->chunk_idx)) {
+            if (segments.begin() == it)
+                return r;
+            std::for_each(it, segments.end(), [=](auto& segment) { segment.result = r; });
+            break;
+        }
+    }
+
+    parallel_for_each(segments, [&](Segment& segment) {
+        if (0 == segment.result) {
+            segment.result = write_stripe(
+                segment.chunk_idx, segment.chunk_offset, (offset + segment.buf_offset) % stripe_size, buf.subspan(segment.buf_offset, segment.length), fi);
+        }
+    });
+
+    auto const wb = segments_result(segments);
+    if (wb > 0)
+        desc_.size = std::max(desc_.size, static_cast<size_t>(offset + wb));
+
+    return wb;
+}
+
+ssize_t File::write_spilled(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
+{
+    ssize_t wb{0};
+    // the last chunk is split where the space reserved on its backends runs out unless there is no other backend to continue on
+    bool planned{true};
+    bool split{false};
+
+    for (auto chunk_it = std::ranges::upper_bound(chunks_, offset, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
+         wb < buf.size();) {
+
+        if (chunks_.end() == chunk_it) {
+            // the previous chunk ends where its data does and a write beyond the end of the file starts the new chunk at the block
+            // it falls into, so that the space skipped is a hole rather than a gap in either chunk
+            auto const boundary = chunks_.empty() ? 0 : std::max(chunks_.back().offset_range.first, std::min(static_cast<size_t>(offset), desc_.size));
+            auto const start    = std::max(boundary, offset / placement_->block_size() * placement_->block_size());
+
+            if (auto const r = append_chunk(boundary, start)) {
+                // there is no backend to continue on, so the chunk split goes on growing as long as its backends let it
+                if (split && !chunks_.empty()) {
+                    planned  = false;
+                    split    = false;
+                    chunk_it = chunks_.end() - 1;
+                    continue;
+                }
+                return wb ? wb : r;
+            }
+
+            chunk_it = chunks_.end() - 1;
+            split    = false;
+        }
+
+        for (; wb < buf.size() && chunks_.end() != chunk_it; ++chunk_it) {
+            assert(chunk_it->offset_range.first <= offset && offset < chunk_it->offset_range.second);
+
+            auto const chunk_idx = static_cast<size_t>(chunk_it - chunks_.begin());
+            if (!chunk_it->created()) {
+                if (auto const r = create_chunk(chunk_idx))
+                    return wb ? wb : r;
+            }
+            auto chunk{buf.subspan(wb, std::min(buf.size() - wb, chunk_it->offset_range.second - offset))};
+
+            // the last chunk grows as far as the space reserved on its backends lets it, the chunk is split there and the rest of the request
+            // goes to a new chunk rather than the backends are run out of space in the middle of the request
+            auto const data_end = std::max(static_cast<size_t>(offset), desc_.size);
+            if (planned && chunks_.end() - 1 == chunk_it && data_end < offset + chunk.size()) {
+                auto const growth = offset + chunk.size() - data_end;
+                if (auto const fits = streams_reserve(growth); fits < growth) {
+                    auto const block_size = streams_.front()->block_size();
+                    if (auto const split_offset = (data_end + fits) / block_size * block_size; offset < split_offset) {
+                        chunk = chunk.first(split_offset - offset);
+                        split = true;
+                    } else if (chunk_it->offset_range.first < std::min(static_cast<size_t>(offset), desc_.size)) {
+                        chunk_it = chunks_.end();
+                        split    = true;
+                        break;
+                    }
+                    // an empty chunk is written until its backends run out of space, a new chunk would not have got more of it
+                }
+            }
+
+            auto const r = write_chunk(chunk_idx, chunk, offset - chunk_it->offset_range.first, fi);
+            if (r < 0) {
+                if (-ENOSPC == r && (chunks_.end() - 1 == chunk_it))
+                    continue;
                 return r;
+            }
+
+            if (chunks_.end() - 1 == chunk_it && data_end < offset + r)
+                streams_consume(offset + r - data_end);
 
-            rb += r;
+            wb += r;
             offset += r;
 
+            desc_.size = std::max(desc_.size, static_cast<size_t>(offset));
+
             if (r < chunk.size())
-                return rb;
+                return wb;
         }
     }
 
-    return rb;
+    return wb;
 }
 
-off_t File::lseek(off_t off, int whence, struct fuse_file_info* /*fi*/) const noexcept
+ssize_t File::read(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const
 {
-    switch (whence) {
-        case SEEK_DATA:
-            return off;
-        case SEEK_HOLE:
-            return desc_.size;
-        default:
+    std::shared_lock g{mtx_};
+
+    offset = std::min(static_cast<size_t>(offset), desc_.size);
+    buf    = buf.subspan(0, std::min(buf.size(), desc_.size - offset));
+
+    if (buf.empty())
+        return 0;
+
+    return layout_.fixed() ? read_fixed(buf, offset, fi) : read_spilled(buf, offset, fi);
+}
+
+ssize_t File::read_fixed(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const
+{
+    auto segments         = this->segments(buf.size(), offset);
+    auto const chunk_idxs = segments_chunks(segments);
+
+    parallel_for_each(chunk_idxs, [&](size_t chunk_idx) {
+        for (auto& segment : segments | std::views::filter([=](auto const& segment) { return chunk_idx == segment.chunk_idx; })) {
+            segment.result = read_column(chunk_idx, buf.subspan(segment.buf_offset, segment.length), segment.chunk_offset, fi);
+            if (segment.result < 0)
+                break;
+        }
+    });
+
+    return segments_result(segments);
+}
+
+ssize_t File::read_spilled(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const
+{
+    ssize_t rb{0};
+
+    // the holes, whether chunks not created or the space of a file extended by truncation with no chunk at all, are read as zeros
+    auto chunk_it = std::ranges::upper_bound(chunks_, offset, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
+    for (; rb < buf.size() && chunks_.end() != chunk_it; ++chunk_it) {
+        assert(chunk_it->offset_range.first <= offset && offset < chunk_it->offset_range.second);
+
+        auto const chunk_idx = static_cast<size_t>(chunk_it - chunks_.begin());
+        auto const chunk{buf.subspan(rb, std::min(buf.size() - rb, chunk_it->offset_range.second - offset))};
+
+        auto const r = read_filled(chunk_idx, chunk, offset - chunk_it->offset_range.first, fi);
+        if (r < 0)
+            return r;
+
+        rb += r;
+        offset += r;
+    }
+
+    std::memset(buf.data() + rb, 0, buf.size() - rb);
+    return static_cast<ssize_t>(buf.size());
+}
+
+#ifdef HAVE_SETXATTR
+int File::setxattr(std::string_view name, std::span<char const> value, int flags) noexcept
+{
+    std::lock_guard g{mtx_};
+
+    if (kStripeUnitXattr != name && kStripeWidthXattr != name && kChunkSizeXattr != name && kCopiesXattr != name && kParityXattr != name)
+        return -ENOTSUP;
+
+    // layout attributes always exist
+    if (flags & XATTR_CREATE)
+        return -EEXIST;
+
+    auto const parsed = xattr_parse(value);
+    if (!parsed)
+        return -EINVAL;
+    auto const n = *parsed;
+
+    // the layout cannot be changed once the file has got its chunks
+    if (!chunks_.empty())
+        return -EBUSY;
+
+    auto layout = layout_;
+    if (kStripeUnitXattr == name) {
+        layout.stripe_unit = n;
+        layout.kind        = n ? Layout::Kind::kStripe : Layout::Kind::kSpill;
+    } else if (kStripeWidthXattr == name) {
+        layout.stripe_width = n;
+    } else if (kChunkSizeXattr == name) {
+        layout.chunk_size = n;
+    } else if (kCopiesXattr == name) {
+        layout.copies = n;
+    } else {
+        layout.parity = n;
+    }
+
+    if (layout.striped() && 0 == layout.stripe_width && layout.parity < placement_->size())
+        layout.stripe_width = placement_->size() - layout.parity;
+
+    try {
+        if (!layout.valid(placement_->size(), placement_->block_size()))
             return -EINVAL;
+    } catch (...) {
+        return -EIO;
+    }
+
+    layout_     = layout;
+    desc_.ctime = current_time();
+
+    return 0;
+}
+
+int File::getxattr(std::string_view name, std::span<char> value) const noexcept
+{
+    size_t n{0};
+    if (kStripeUnitXattr == name)
+        n = layout_.striped() ? layout_.stripe_unit : 0;
+    else if (kStripeWidthXattr == name)
+        n = layout_.striped() ? layout_.stripe_width : 0;
+    else if (kChunkSizeXattr == name)
+        n = layout_.chunk_size;
+    else if (kCopiesXattr == name)
+        n = layout_.copies;
+    else if (kParityXattr == name)
+        n = layout_.coded() ? layout_.parity : 0;
+    else
+        return -ENODATA;
+
+    return xattr_format(n, value);
+}
+#endif
+
+off_t File::lseek(off_t off, int whence, struct fuse_file_info* fi) const noexcept
+{
+    if (SEEK_DATA != whence && SEEK_HOLE != whence)
+        return -EINVAL;
+
+    std::shared_lock g{mtx_};
+    if (off < 0 || desc_.size <= static_cast<size_t>(off))
+        return -ENXIO;
+
+    auto const found = layout_.striped() ? seek_striped(off, whence, fi) : seek_chunked(off, whence, fi);
+
+    // there is an implicit hole at the end of the file
+    if (SEEK_HOLE == whence)
+        return static_cast<off_t>(std::min(found.value_or(desc_.size), desc_.size));
+    return found && *found < desc_.size ? static_cast<off_t>(*found) : -ENXIO;
+}
+
+std::optional<size_t> File::seek_chunk(size_t chunk_idx, size_t chunk_offset, int whence, struct fuse_file_info const* fi) const
+{
+    // a chunk not created is a hole as a whole
+    if (chunks_.size() <= chunk_idx || !chunks_[chunk_idx].created())
+        return SEEK_HOLE == whence ? std::optional{chunk_offset} : std::nullopt;
+
+    // the replicas are written alike, so any of them tells where the data is
+    fuse_file_info mfi{};
+    auto const r = fs(chunks_[chunk_idx].replicas.front())->lseek(chunk_path(chunk_idx), chunk_offset, whence, chunk_fi(chunk_idx, 0, mfi, fi));
+    if (r >= 0)
+        return static_cast<size_t>(r);
+
+    // there is no data past the end of a chunk, whereas a backend not telling holes is taken as holding data throughout
+    if (-ENXIO == r)
+        return SEEK_HOLE == whence ? std::optional{chunk_offset} : std::nullopt;
+    return SEEK_DATA == whence ? std::optional{chunk_offset} : std::nullopt;
+}
+
+std::optional<size_t> File::seek_chunked(size_t offset, int whence, struct fuse_file_info const* fi) const
+{
+    // the chunks are looked up in the order of the space they hold, a chunk holding no data or hole past the offset is skipped
+    for (auto pos = offset; pos < desc_.size;) {
+        size_t chunk_idx;
+        std::pair<size_t, size_t> range;
+        if (layout_.fixed()) {
+            chunk_idx = pos / layout_.chunk_size;
+            range     = {chunk_idx * layout_.chunk_size, (chunk_idx + 1) * layout_.chunk_size};
+        } else {
+            auto const it = std::ranges::upper_bound(chunks_, pos, std::less<>{}, [](auto const& chunk) { return chunk.offset_range.second; });
+            if (chunks_.end() == it)
+                return SEEK_HOLE == whence ? std::optional{pos} : std::nullopt;
+            chunk_idx = static_cast<size_t>(it - chunks_.begin());
+            range     = it->offset_range;
+        }
+
+        if (auto const r = seek_chunk(chunk_idx, pos - range.first, whence, fi); r && *r < range.second - range.first)
+            return range.first + *r;
+        pos = range.second;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<size_t> File::seek_striped(size_t offset, int whence, struct fuse_file_info const* fi) const
+{
+    auto const unit  = layout_.stripe_unit;
+    auto const width = layout_.stripe_width;
+
+    // the data chunks of a stripe set are looked up from the column offsets following the offset, each of them tells the first unit
+    // of its own holding data or a hole, and the one coming first in the file is the answer. The parity chunks do not count
+    auto const set_size = layout_.chunk_size ? layout_.chunk_size * width : std::numeric_limits<size_t>::max();
+    for (auto pos = offset; pos < desc_.size;) {
+        auto const set_idx  = pos / set_size;
+        auto const set_base = set_idx * set_size;
+        auto const unit_idx = (pos - set_base) / unit;
+        auto const row      = unit_idx / width * unit;
+
+        std::optional<size_t> found;
+        for (size_t column_idx = 0; column_idx < width; ++column_idx) {
+            auto column_offset = row;
+            if (column_idx == unit_idx % width)
+                column_offset += (pos - set_base) % unit;
+            else if (column_idx < unit_idx % width)
+                column_offset += unit;
+
+            auto const r = seek_chunk(set_idx * layout_.stripe_chunks() + column_idx, column_offset, whence, fi);
+            if (!r || (layout_.chunk_size && layout_.chunk_size <= *r))
+                continue;
+
+            auto const file_offset = set_base + (*r / unit * width + column_idx) * unit + *r % unit;
+            found                  = std::min(found.value_or(file_offset), file_offset);
+        }
+        if (found)
+            return found;
+
+        if (!layout_.chunk_size)
+            break;
+        pos = set_base + set_size;
     }
+
+    return std::nullopt;
 }
 
 int File::fsync(int isdatasync, struct fuse_file_info* fi) noexcept
 {
-    for (auto const& chunk : chunks_) {
-        if (auto const r = chunk.fs->fsync(path_.c_str(), isdatasync, nullptr))
+    std::shared_lock g{mtx_};
+    return for_each_replica([=, this](size_t chunk_idx, size_t replica_idx) {
+        fuse_file_info mfi{};
+        return fs(chunks_[chunk_idx].replicas[replica_idx])->fsync(chunk_path(chunk_idx), isdatasync, chunk_fi(chunk_idx, replica_idx, mfi, fi));
+    });
+}
+
+std::vector<File::ChunkHeat> File::chunks_heat()
+{
+    std::shared_lock g{mtx_};
+
+    std::vector<ChunkHeat> heats;
+    heats.reserve(chunks_.size());
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        // accesses racing with the cooling may get lost, that is fine for an estimation
+        auto const heat = chunks_[i].heat.load(std::memory_order_relaxed);
+        chunks_[i].heat.store(heat / 2, std::memory_order_relaxed);
+        for (auto const& replica : chunks_[i].replicas)
+            heats.push_back({.chunk_idx = i, .fs = fs(replica), .heat = heat});
+    }
+    return heats;
+}
+
+std::vector<File::ChunkReplica> File::chunk_replicas() const
+{
+    std::shared_lock g{mtx_};
+
+    std::vector<ChunkReplica> replicas;
+    replicas.reserve(chunks_.size());
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        auto const& chunk = chunks_[i];
+        auto const size   = layout_.fixed() ? layout_.chunk_length(i, desc_.size)
+                                            : std::min(desc_.size, chunk.offset_range.second) - std::min(desc_.size, chunk.offset_range.first);
+        for (auto const& replica : chunk.replicas)
+            replicas.push_back({.chunk_idx = i, .fs = fs(replica), .size = size});
+    }
+    return replicas;
+}
+
+std::vector<std::shared_ptr<Backend>> File::move_excluded(size_t chunk_idx) const
+{
+    std::shared_lock g{mtx_};
+    return chunk_backends(chunk_idx, true);
+}
+
+std::shared_ptr<Backend> File::place_move(size_t chunk_idx, Tier tier)
+{
+    std::shared_lock g{mtx_};
+    return place_chunk(chunk_idx, tier);
+}
+
+ssize_t File::move_chunk(size_t chunk_idx, std::shared_ptr<Backend> const& source, std::shared_ptr<Backend> target, MoveOptions const& options)
+{
+    assert(source);
+    assert(target);
+    assert(options.block_size);
+
+    auto const path        = chunk_path(chunk_idx);
+    auto const source_slot = placement_->slot(source);
+    auto const target_slot = placement_->slot(target);
+
+    uint64_t generation{0};
+    uint64_t shrinks{0};
+    mode_t mode{0};
+    {
+        std::shared_lock g{mtx_};
+        if (chunks_.size() <= chunk_idx || chunks_[chunk_idx].replicas.end() == std::ranges::find(chunks_[chunk_idx].replicas, source_slot, &Replica::backend))
+            return -EAGAIN;
+        // movers working concurrently would copy to the same path if they chose the same target
+        if (chunks_[chunk_idx].moving.exchange(true, std::memory_order_acquire))
+            return -EBUSY;
+        generation = chunks_[chunk_idx].generation.load(std::memory_order_relaxed);
+        shrinks    = shrinks_;
+        mode       = desc_.mode;
+    }
+    // a truncation may drop the chunk meanwhile and have its index reused by another one, the move is given up then
+    scope_exit const moving_reset{[&] {
+        std::shared_lock g{mtx_};
+        if (chunk_idx < chunks_.size())
+            chunks_[chunk_idx].moving.store(false, std::memory_order_release);
+    }};
+
+    // the chunk is copied without holding the file, the changes made meanwhile are detected by the generation of the chunk
+    fuse_file_info sfi{};
+    sfi.flags = O_RDONLY;
+    if (auto const r = source->open(path, &sfi))
+        return r;
+    scope_exit const source_release{[&] { source->release(path, &sfi); }};
+
+    fuse_file_info tfi{};
+    tfi.flags = O_WRONLY | O_TRUNC;
+    if (auto const r = target->create(path, mode | S_IRUSR | S_IWUSR, &tfi))
+        return r;
+
+    bool moved{false};
+    scope_exit const target_release{[&] {
+        target->release(path, &tfi);
+        if (!moved)
+            target->unlink(path);
+    }};
+
+    // the data of the chunk is copied extent by extent, the holes in between are left holes on the target, and the trailing ones are
+    // kept by the target being extended to the size of the source. A backend not telling holes is taken as holding data throughout
+    auto const end = source->lseek(path, 0, SEEK_END, &sfi);
+    if (end < 0)
+        return end;
+
+    std::vector<std::byte> buf(options.block_size);
+    size_t copied{0};
+    for (off_t pos = 0; pos < end;) {
+        auto const data = source->lseek(path, pos, SEEK_DATA, &sfi);
+        if (-ENXIO == data)
+            break;
+        auto const hole = data < 0 ? end : source->lseek(path, data, SEEK_HOLE, &sfi);
+        pos             = data < 0 ? pos : data;
+        auto const stop = hole < 0 ? end : std::min(hole, end);
+        while (pos < stop) {
+            auto const block = std::span{buf}.first(std::min(buf.size(), static_cast<size_t>(stop - pos)));
+            if (options.limiter ? !options.limiter->acquire(block.size(), options.stoken) : options.stoken.stop_requested())
+                return -ECANCELED;
+            auto const rb = source->read(path, block, pos, &sfi);
+            if (rb < 0)
+                return rb;
+            // the chunk shrunk meanwhile, which makes the move fail on being committed
+            if (0 == rb)
+                return -EAGAIN;
+            for (ssize_t wb = 0; wb < rb;) {
+                auto const r = target->write(path, block.subspan(wb, rb - wb), pos + wb, &tfi);
+                if (r < 0)
+                    return r;
+                wb += r;
+            }
+            pos += rb;
+            copied += static_cast<size_t>(rb);
+        }
+    }
+
+    if (auto const r = target->truncate(path, end, &tfi))
+        return r;
+    if (auto const r = target->fsync(path, 0, &tfi))
+        return r;
+
+    uint64_t lsn{0};
+    {
+        std::lock_guard g{mtx_};
+        if (chunks_.size() <= chunk_idx || shrinks != shrinks_ || generation != chunks_[chunk_idx].generation.load(std::memory_order_relaxed))
+            return -EAGAIN;
+
+        auto& replicas = chunks_[chunk_idx].replicas;
+        auto const it  = std::ranges::find(replicas, source_slot, &Replica::backend);
+        if (replicas.end() == it)
+            return -EAGAIN;
+
+        // the target gets the attributes the chunk files keep for the metadata to be rebuilt out of them, the scanner takes them from the
+        // chunk changed last, which the target is. The ones failed to be set are left stale to be synced along with the next change
+        if (desc_.mode != mode && 0 != target->chmod(path, (desc_.mode & ~S_IFMT) | S_IRUSR | S_IWUSR, nullptr))
+            stale_ |= kStaleMode;
+        if (0 != target->chown(path, desc_.owner_uid, desc_.owner_gid, nullptr))
+            stale_ |= kStaleOwner;
+#ifdef HAVE_UTIMENSAT
+        std::array const ts{desc_.atime, desc_.mtime};
+        if (0 != target->utimens(path, ts.data(), nullptr))
+            stale_ |= kStaleTimes;
+#endif
+
+        // the handle of the replica is reopened on the target backend on demand
+        if (auto const fh = it->fh.exchange(kNoHandle); kNoHandle != fh) {
+            fuse_file_info mfi{};
+            mfi.fh    = fh;
+            mfi.flags = kChunkFlags;
+            source->release(path, &mfi);
+        }
+        it->backend = target_slot;
+        moved       = true;
+        streams_reset();
+
+        lsn = journal_chunks(chunk_idx, chunk_idx + 1);
+    }
+
+    // the source replica is deleted in the background, so that the next chunk is moved meanwhile, once the chunk map kept in the metadata
+    // store refers to the target one
+    if (lsn) {
+        if (auto const r = store_->sync(lsn))
             return r;
     }
-    return 0;
+    source->discard(path);
+
+    return static_cast<ssize_t>(copied);
 }
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
+#include <atomic>
 #include <filesystem>
-#include <list>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -14,7 +21,14 @@
 
 #include <fuse.h>
 
-#include "file_system_interface.hpp"
+#include <boost/container/small_vector.hpp>
+
+#include "backend.hpp"
+#include "layout.hpp"
+#include "metadata_record.hpp"
+#include "metadata_store.hpp"
+#include "placement.hpp"
+#include "rate_limiter.hpp"
 
 namespace multifs
 {
@@ -34,47 +48,253 @@ public:
     };
 
 private:
+    static constexpr uint64_t kNoHandle{std::numeric_limits<uint64_t>::max()};
+
+    // Attributes of the descriptor the chunk files are brought up to date with in the background
+    static constexpr uint8_t kStaleMode{0x1};
+    static constexpr uint8_t kStaleOwner{0x2};
+    static constexpr uint8_t kStaleTimes{0x4};
+
+    struct Replica {
+        Placement::Slot backend;                     ///< Slot of the backend the replica resides on in the table of the placement
+        mutable std::atomic<uint64_t> fh{kNoHandle}; ///< Handle of the replica shared by all the handles of the file, opened on demand
+
+        explicit Replica(Placement::Slot slot) noexcept
+            : backend(slot)
+        {
+        }
+        Replica(Replica&& other) noexcept
+            : backend(other.backend)
+            , fh(other.fh.exchange(kNoHandle))
+        {
+        }
+        Replica& operator=(Replica&& other) noexcept
+        {
+            backend = other.backend;
+            fh      = other.fh.exchange(kNoHandle);
+            return *this;
+        }
+    };
+
+    // Most of the chunks are not replicated and most of the files consist of a single chunk, so one of each is kept in place
+    using Replicas = boost::container::small_vector<Replica, 1>;
+
     struct Chunk {
-        std::pair<size_t, size_t> offset_range;
-        std::shared_ptr<IFileSystem> fs;
+        std::pair<size_t, size_t> offset_range; ///< Range of the file space the chunk holds, spill layout with unbounded chunks only
+        Replicas replicas;                      ///< Copies of the chunk residing on distinct backends, none if the chunk has not been created,
+                                                ///< the range of a chunk not created is a hole read as zeros
+        std::atomic<uint64_t> generation{0};    ///< Incremented on every change of the chunk contents
+        mutable std::atomic<uint32_t> heat{0};  ///< Number of accesses to the chunk, cooling down over time
+        std::atomic<bool> moving{false};        ///< Set while a replica of the chunk is being moved between backends
+
+        Chunk() = default;
+        explicit Chunk(std::pair<size_t, size_t> range)
+            : offset_range(range)
+        {
+        }
+        Chunk(Chunk&& other) noexcept
+            : offset_range(other.offset_range)
+            , replicas(std::move(other.replicas))
+            , generation(other.generation.load())
+            , heat(other.heat.load())
+            , moving(other.moving.load())
+        {
+        }
+        Chunk& operator=(Chunk&& other) noexcept
+        {
+            offset_range = other.offset_range;
+            replicas     = std::move(other.replicas);
+            generation   = other.generation.load();
+            heat         = other.heat.load();
+            moving       = other.moving.load();
+            return *this;
+        }
+
+        [[nodiscard]] bool created() const noexcept { return !replicas.empty(); }
     };
 
-    std::filesystem::path path_;
-    std::list<std::shared_ptr<IFileSystem>> fss_;
-    std::list<std::shared_ptr<IFileSystem>>::iterator fs_next_it_;
-    std::vector<Chunk> chunks_;
+    // A piece of a request falling into a single chunk
+    struct Segment {
+        size_t chunk_idx;
+        size_t chunk_offset;
+        size_t buf_offset;
+        size_t length;
+        ssize_t result;
+    };
+
+    mutable std::shared_mutex mtx_; ///< Guards the chunk map against background workers, the file system serializes requests otherwise
+    std::string path_; ///< Path the chunks are named after, kept as a string to not have its components split
+    std::shared_ptr<Placement> placement_;
+    boost::container::small_vector<Chunk, 1> chunks_;
+    Layout layout_;
     Descriptor desc_;
+    size_t opens_{0};                               ///< Number of handles the file is opened by
+    nlink_t nlink_{0};                              ///< Number of the entries of the namespace the file is linked by
+    bool unlinked_{false};                          ///< Whether the data is to be deleted once the last of the handles is released
+    size_t writers_{0};                             ///< Number of handles the file is opened for writing by
+    std::vector<std::shared_ptr<Backend>> streams_; ///< Backends the file is being written to
+    size_t streams_reserved_{0};                    ///< Bytes reserved on each of the streams for the file to grow by
+    size_t zero_block_{0};                          ///< Size of the blocks written which are left holes if they hold zeros only, 0 disables it
+    uint64_t shrinks_{0};                           ///< Number of times chunks have been dropped, the index of a chunk dropped may be reused
+    std::shared_ptr<MetadataStore> store_;          ///< Store the chunk map is kept in, none if the file is kept in memory only
+    uint64_t ino_{0};                               ///< Number the file is known by, in the store as well
+    std::atomic<uint8_t> stale_{0};                 ///< Attributes changed since the chunk files were last brought up to date with them
+    std::atomic<bool> sync_scheduled_{false};       ///< Whether bringing the chunk files up to date is scheduled
+
+    static inline std::atomic<uint64_t> attributes_failures_{0}; ///< Number of the syncs of the attributes failed by any of the files
 
-    void init_desc(mode_t mode, struct fuse_file_info* fi) noexcept;
+    void init_desc(mode_t mode, struct fuse_file_info* fi);
     void truncate(size_t new_size) noexcept;
+    int truncate_chunks(size_t new_size, struct fuse_file_info* fi);
+
+    void record_chunk(MetadataStore::Transaction& tx, size_t chunk_idx) const;
+    uint64_t journal_chunks(size_t first, size_t last);
+
+    [[nodiscard]] std::shared_ptr<Backend> const& fs(Replica const& replica) const noexcept { return placement_->backend(replica.backend); }
+    std::filesystem::path chunk_path(size_t chunk_idx) const;
+    struct fuse_file_info* chunk_fi(size_t chunk_idx, size_t replica_idx, fuse_file_info& mfi, struct fuse_file_info const* fi) const;
+    std::vector<std::shared_ptr<Backend>> chunk_backends(size_t chunk_idx, bool siblings) const;
+    std::shared_ptr<Backend> place_chunk(size_t chunk_idx, Tier tier = Tier::kFast, size_t size = 0);
+    int create_chunk(size_t chunk_idx, size_t size = 0);
+    int ensure_chunk(size_t chunk_idx, size_t size = 0);
+    int append_chunk(size_t boundary, size_t start, size_t size = 0);
+    void close_chunks() noexcept;
+    void streams_reset();
+    size_t streams_reserve(size_t growth);
+    void streams_consume(size_t bytes) noexcept;
+
+    template <typename F>
+    int for_each_replica(F f);
+
+    ssize_t write_chunk(size_t chunk_idx, std::span<std::byte const> buf, size_t chunk_offset, struct fuse_file_info const* fi);
+    ssize_t read_chunk(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const;
+    ssize_t read_filled(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const;
+    ssize_t read_column(size_t chunk_idx, std::span<std::byte> buf, size_t chunk_offset, struct fuse_file_info const* fi) const;
+    ssize_t write_stripe(size_t chunk_idx, size_t chunk_offset, size_t stripe_offset, std::span<std::byte const> buf, struct fuse_file_info const* fi);
+
+    std::vector<Segment> segments(size_t length, off_t offset) const;
+    static std::vector<size_t> segments_chunks(std::span<Segment const> segments);
+    static ssize_t segments_result(std::span<Segment const> segments) noexcept;
+    int punch(size_t offset, size_t length, struct fuse_file_info* fi);
+    ssize_t write_sparse(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
+    ssize_t write_dense(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
+    ssize_t write_spilled(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
+    ssize_t write_fixed(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
+    ssize_t write_coded(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
+    ssize_t read_spilled(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const;
+    ssize_t read_fixed(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const;
+
+    std::optional<size_t> seek_chunk(size_t chunk_idx, size_t chunk_offset, int whence, struct fuse_file_info const* fi) const;
+    std::optional<size_t> seek_chunked(size_t offset, int whence, struct fuse_file_info const* fi) const;
+    std::optional<size_t> seek_striped(size_t offset, int whence, struct fuse_file_info const* fi) const;
+
+#ifdef HAVE_POSIX_FALLOCATE
+    int fallocate_segments(int mode, std::span<Segment> segments, struct fuse_file_info* fi);
+    int fallocate_fixed(int mode, size_t offset, size_t length, struct fuse_file_info* fi);
+    int fallocate_coded(int mode, size_t offset, size_t length, struct fuse_file_info* fi);
+    int fallocate_spilled(int mode, size_t offset, size_t length, struct fuse_file_info* fi);
+#endif
 
 public:
+    // Heat of a replica of a chunk, that is how often the chunk has been accessed lately
+    struct ChunkHeat {
+        size_t chunk_idx;
+        std::shared_ptr<Backend> fs; ///< Backend the replica resides on
+        uint32_t heat;
+    };
+
+    // A replica of a chunk along with the number of bytes the chunk holds
+    struct ChunkReplica {
+        size_t chunk_idx;
+        std::shared_ptr<Backend> fs; ///< Backend the replica resides on
+        size_t size;
+    };
+
+    static constexpr size_t kMoveBlockSize{1024 * 1024};
+
+    // Controls how a chunk is copied when moved between backends
+    struct MoveOptions {
+        size_t block_size{kMoveBlockSize}; ///< Size of the I/Os the chunk is copied by
+        RateLimiter* limiter{nullptr};     ///< Paces the copying, unlimited if none
+        std::stop_token stoken;            ///< Cancels the copying
+    };
+
     File() = default;
-    template <typename InputIterator>
-    explicit File(std::filesystem::path path, mode_t mode, InputIterator begin, InputIterator end, struct fuse_file_info* fi)
+    explicit File(std::string path, mode_t mode, Layout layout, std::shared_ptr<Placement> placement, struct fuse_file_info* fi)
         : path_(std::move(path))
-        , fss_(begin, end)
-        , fs_next_it_(fss_.begin())
+        , placement_(std::move(placement))
+        , layout_(layout)
     {
         init_desc(mode, fi);
     }
-    ~File() = default;
+    // Restores the file kept in the metadata store, its chunks are restored separately
+    explicit File(InodeRecord const& record, std::shared_ptr<Placement> placement)
+        : placement_(std::move(placement))
+    {
+        restore(record);
+    }
+    ~File()
+    {
+        close_chunks();
+        for (auto const& backend : streams_) {
+            backend->unreserve(streams_reserved_);
+            backend->writer_detach();
+        }
+    }
 
-    File(File const&)            = default;
-    File& operator=(File const&) = default;
+    File(File const&)            = delete;
+    File& operator=(File const&) = delete;
 
-    File(File&&) noexcept            = default;
-    File& operator=(File&&) noexcept = default;
+    File(File&&)            = delete;
+    File& operator=(File&&) = delete;
 
     [[nodiscard]] auto const& desc() const noexcept { return desc_; }
+    [[nodiscard]] auto const& layout() const noexcept { return layout_; }
+
+    // Makes the blocks of the size given, aligned to it within the file, be checked on writing and not stored if they hold zeros only, 0 disables it
+    void zero_blocks(size_t block_size) noexcept
+    {
+        std::lock_guard g{mtx_};
+        zero_block_ = block_size;
+    }
+
+    [[nodiscard]] uint64_t ino() const noexcept { return ino_; }
+    [[nodiscard]] InodeRecord record() const noexcept;
+    [[nodiscard]] nlink_t nlink() const noexcept { return nlink_; }
+    // Counts a link of the file made within the namespace, or removed if the delta is negative
+    void count_link(int delta) noexcept { nlink_ += delta; }
+
+    // Makes the file be known by the inode number given and the changes of its chunk map be committed to the store given, if there is one
+    void attach(std::shared_ptr<MetadataStore> store, uint64_t ino) noexcept
+    {
+        std::lock_guard g{mtx_};
+        store_ = std::move(store);
+        ino_   = ino;
+    }
+    // Records the attributes of the file and its chunk map
+    void snapshot(MetadataStore::Transaction& tx) const;
+
+    // Restores the state kept in the metadata store, it is to be done before the file is accessed
+    void restore(InodeRecord const& record);
+    void restore_chunk(size_t chunk_idx, std::pair<size_t, size_t> offset_range, std::span<std::shared_ptr<Backend> const> backends);
+    void restore_chunks(size_t count);
 
     int unlink();
+    // The attributes are served out of the descriptor and the permissions are checked against it, so the changes are made to the
+    // descriptor alone and the chunk files are left to be brought up to date with them by attributes_sync()
     int chmod(mode_t mode, struct fuse_file_info* fi) noexcept;
     int chown(uid_t uid, gid_t gid, struct fuse_file_info* fi) noexcept;
+    // Marks bringing the chunk files up to date as scheduled, returns whether it has not been scheduled yet
+    [[nodiscard]] bool attributes_schedule() noexcept { return !sync_scheduled_.exchange(true); }
+    // Brings the chunk files up to date with the attributes changed since they were last, they are kept by the chunk files for the
+    // metadata to be rebuilt out of them. The attributes failed to be synced are kept stale and retried along with the next change
+    void attributes_sync() noexcept;
+    // Returns the number of the syncs of the attributes failed by any of the files
+    [[nodiscard]] static uint64_t attributes_failures() noexcept { return attributes_failures_.load(std::memory_order_relaxed); }
     int truncate(size_t new_size, struct fuse_file_info* fi);
     int open(struct fuse_file_info* fi);
     ssize_t write(std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi);
-    ssize_t read(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const noexcept;
+    ssize_t read(std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const;
     int release(struct fuse_file_info* fi) noexcept;
     int fsync(int isdatasync, struct fuse_file_info* fi) noexcept;
 
@@ -86,7 +306,29 @@ public:
     off_t fallocate(int mode, off_t offset, off_t length, struct fuse_file_info* fi);
 #endif
 
+#ifdef HAVE_SETXATTR
+    int setxattr(std::string_view name, std::span<char const> value, int flags) noexcept;
+    int getxattr(std::string_view name, std::span<char> value) const noexcept;
+#endif
+
     off_t lseek(off_t off, int whence, struct fuse_file_info* fi) const noexcept;
+
+    // Returns the heat of the replicas of the chunks, the heat cools down by half on every call
+    std::vector<ChunkHeat> chunks_heat();
+    // Returns the replicas of the chunks
+    std::vector<ChunkReplica> chunk_replicas() const;
+    // Returns the backends a replica of the chunk must not be moved to, those of the other replicas and of the rest of the chunks of its stripe set
+    std::vector<std::shared_ptr<Backend>> move_excluded(size_t chunk_idx) const;
+    // Chooses a backend of the tier given to move a replica of the chunk to, the backends the chunk must not share are excluded
+    std::shared_ptr<Backend> place_move(size_t chunk_idx, Tier tier);
+    // Moves the replica of the chunk from the source backend to the target one while the file stays accessible, returns the number of bytes
+    // of data moved, the holes are kept and not counted, -EAGAIN if the chunk has been changed meanwhile, -EBUSY if the chunk is being moved
+    // already, -ECANCELED if the move has been stopped
+    ssize_t move_chunk(size_t chunk_idx, std::shared_ptr<Backend> const& source, std::shared_ptr<Backend> target, MoveOptions const& options);
+    ssize_t move_chunk(size_t chunk_idx, std::shared_ptr<Backend> const& source, std::shared_ptr<Backend> target)
+    {
+        return move_chunk(chunk_idx, source, std::move(target), MoveOptions{});
+    }
 };
 
 } // namespace multifs
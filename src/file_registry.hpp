@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "file.hpp"
+
+namespace multifs
+{
+
+// Keeps track of the files of a file system for background workers, which have got no access to its namespace
+class FileRegistry
+{
+private:
+    std::mutex mtx_;
+    std::vector<std::weak_ptr<File>> files_;
+
+public:
+    void add(std::weak_ptr<File> file)
+    {
+        std::lock_guard g{mtx_};
+        files_.push_back(std::move(file));
+    }
+
+    // Returns the files still alive, the ones gone are forgotten
+    std::vector<std::shared_ptr<File>> files()
+    {
+        std::vector<std::shared_ptr<File>> files;
+
+        std::lock_guard g{mtx_};
+        files.reserve(files_.size());
+        std::erase_if(files_, [&files](auto const& wfile) {
+            if (auto file = wfile.lock()) {
+                files.push_back(std::move(file));
+                return false;
+            }
+            return true;
+        });
+
+        return files;
+    }
+};
+
+} // namespace multifs
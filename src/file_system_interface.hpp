@@ -5,6 +5,7 @@
 
 #include <filesystem>
 #include <span>
+#include <string_view>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,8 +36,10 @@ public:
     virtual int rename(std::filesystem::path const& from, std::filesystem::path const& to, unsigned int flags)  = 0;
     virtual int link(std::filesystem::path const& from, std::filesystem::path const& to)                        = 0;
     virtual int access(std::filesystem::path const& path, int mask) const                                       = 0;
+    virtual int opendir(std::filesystem::path const& path, struct fuse_file_info* fi)                           = 0;
     virtual int
     readdir(std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const = 0;
+    virtual int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi)                                                                   = 0;
     virtual int unlink(std::filesystem::path const& path)                                                                                                  = 0;
     virtual int chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi)                                                           = 0;
     virtual int chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi)                                                  = 0;
@@ -54,6 +57,10 @@ public:
 #ifdef HAVE_POSIX_FALLOCATE
     virtual int fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) = 0;
 #endif // HAVE_POSIX_FALLOCATE
+#ifdef HAVE_SETXATTR
+    virtual int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) = 0;
+    virtual int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const          = 0;
+#endif // HAVE_SETXATTR
     virtual off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const = 0;
 };
 
@@ -76,12 +76,22 @@ public:
         return wrap([this](auto&&... args) { return fs_->access(std::forward<decltype(args)>(args)...); }, path, mask);
     }
 
+    int opendir(std::string_view path, struct fuse_file_info* fi) noexcept override
+    {
+        return wrap([this](auto&&... args) { return fs_->opendir(std::forward<decltype(args)>(args)...); }, path, fi);
+    }
+
     int
     readdir(std::string_view path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const noexcept override
     {
         return wrap([this](auto&&... args) { return fs_->readdir(std::forward<decltype(args)>(args)...); }, path, buf, filler, offset, fi, flags);
     }
 
+    int releasedir(std::string_view path, struct fuse_file_info* fi) noexcept override
+    {
+        return wrap([this](auto&&... args) { return fs_->releasedir(std::forward<decltype(args)>(args)...); }, path, fi);
+    }
+
     int unlink(std::string_view path) noexcept override
     {
         return wrap([this](auto&&... args) { return fs_->unlink(std::forward<decltype(args)>(args)...); }, path);
@@ -151,6 +161,18 @@ public:
     }
 #endif // HAVE_POSIX_FALLOCATE
 
+#ifdef HAVE_SETXATTR
+    int setxattr(std::string_view path, std::string_view name, std::span<char const> value, int flags) noexcept override
+    {
+        return wrap([this](auto&&... args) { return fs_->setxattr(std::forward<decltype(args)>(args)...); }, path, name, value, flags);
+    }
+
+    int getxattr(std::string_view path, std::string_view name, std::span<char> value) const noexcept override
+    {
+        return wrap([this](auto&&... args) { return fs_->getxattr(std::forward<decltype(args)>(args)...); }, path, name, value);
+    }
+#endif // HAVE_SETXATTR
+
     off_t lseek(std::string_view path, off_t off, int whence, struct fuse_file_info* fi) const noexcept override
     {
         return wrap([this](auto&&... args) { return fs_->lseek(std::forward<decltype(args)>(args)...); }, path, off, whence, fi);
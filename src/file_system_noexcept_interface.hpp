@@ -35,8 +35,10 @@ public:
     virtual int rename(std::string_view from, std::string_view to, unsigned int flags) noexcept              = 0;
     virtual int link(std::string_view from, std::string_view to) noexcept                                    = 0;
     virtual int access(std::string_view path, int mask) const noexcept                                       = 0;
+    virtual int opendir(std::string_view path, struct fuse_file_info* fi) noexcept                           = 0;
     virtual int
     readdir(std::string_view path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const noexcept = 0;
+    virtual int releasedir(std::string_view path, struct fuse_file_info* fi) noexcept                                                                   = 0;
     virtual int unlink(std::string_view path) noexcept                                                                                                  = 0;
     virtual int chmod(std::string_view path, mode_t mode, struct fuse_file_info* fi) noexcept                                                           = 0;
     virtual int chown(std::string_view path, uid_t uid, gid_t gid, struct fuse_file_info* fi) noexcept                                                  = 0;
@@ -54,6 +56,10 @@ public:
 #ifdef HAVE_POSIX_FALLOCATE
     virtual int fallocate(std::string_view path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) noexcept = 0;
 #endif // HAVE_POSIX_FALLOCATE
+#ifdef HAVE_SETXATTR
+    virtual int setxattr(std::string_view path, std::string_view name, std::span<char const> value, int flags) noexcept = 0;
+    virtual int getxattr(std::string_view path, std::string_view name, std::span<char> value) const noexcept          = 0;
+#endif // HAVE_SETXATTR
     virtual off_t lseek(std::string_view path, off_t off, int whence, struct fuse_file_info* fi) const noexcept = 0;
 };
 
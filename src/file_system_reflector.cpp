@@ -11,9 +11,15 @@
 #include <fcntl.h>
 #include <filesystem>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
+#ifdef HAVE_SETXATTR
+#include <sys/xattr.h>
+#endif
 
+#include <memory>
 #include <stdexcept>
+#include <string>
 #include <utility>
 
 #include <fuse.h>
@@ -22,6 +28,39 @@
 
 using namespace multifs;
 
+namespace
+{
+
+// Directories are read in large batches, so that listing a directory of millions of chunk files takes as few calls as possible
+constexpr size_t kDirentsBufferSize{1024 * 1024};
+
+// Gets the attributes of an entry of the directory open, the path of the directory is not resolved again for every entry
+int stat_at(int dirfd, char const* name, struct stat& stbuf) noexcept
+{
+    struct statx stx;
+    if (::statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_BASIC_STATS, &stx) == -1)
+        return -errno;
+
+    std::memset(&stbuf, 0, sizeof(stbuf));
+    stbuf.st_dev     = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    stbuf.st_ino     = stx.stx_ino;
+    stbuf.st_mode    = stx.stx_mode;
+    stbuf.st_nlink   = stx.stx_nlink;
+    stbuf.st_uid     = stx.stx_uid;
+    stbuf.st_gid     = stx.stx_gid;
+    stbuf.st_rdev    = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+    stbuf.st_size    = static_cast<off_t>(stx.stx_size);
+    stbuf.st_blksize = stx.stx_blksize;
+    stbuf.st_blocks  = static_cast<blkcnt_t>(stx.stx_blocks);
+    stbuf.st_atim    = {stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec};
+    stbuf.st_mtim    = {stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec};
+    stbuf.st_ctim    = {stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec};
+
+    return 0;
+}
+
+} // anonymous namespace
+
 FileSystemReflector::FileSystemReflector(std::filesystem::path mount_point)
     : mp_(std::move(mount_point))
 {
@@ -31,11 +70,11 @@ FileSystemReflector::FileSystemReflector(std::filesystem::path mount_point)
         throw std::invalid_argument("mount point provided must be a path to a directory as a mount point");
 }
 
-int FileSystemReflector::getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* /*fi*/) const
+int FileSystemReflector::getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* fi) const
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto const res = ::lstat(to_path(path).c_str(), &stbuf);
+    auto const res = fi ? ::fstat(fi->fh, &stbuf) : ::lstat(to_path(path).c_str(), &stbuf);
 
     return res == -1 ? -errno : 0;
 }
@@ -123,26 +162,72 @@ int FileSystemReflector::access(std::filesystem::path const& path, int mask) con
     return res == -1 ? -errno : 0;
 }
 
-int FileSystemReflector::readdir(
-    std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t /*offset*/, struct fuse_file_info* /*fi*/, fuse_readdir_flags /*flags*/) const
+int FileSystemReflector::opendir(std::filesystem::path const& path, struct fuse_file_info* fi)
 {
     assert(!path.empty());
+    assert(fi);
+
+    auto const res = ::open(to_path(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (res == -1)
+        return -errno;
+
+    fi->fh = res;
+
+    return 0;
+}
+
+int FileSystemReflector::readdir(
+    std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t /*offset*/, struct fuse_file_info* fi, fuse_readdir_flags flags) const
+{
+    assert(fi || !path.empty());
     assert(buf);
 
-    auto* dp = ::opendir(to_path(path).c_str());
-    if (!dp)
+    // the directory open is listed from its start, as every listing is filled in full
+    auto const fd = fi ? static_cast<int>(fi->fh) : ::open(to_path(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1 || (fi && ::lseek(fd, 0, SEEK_SET) == -1))
         return -errno;
 
-    for (struct dirent* de; (de = ::readdir(dp));) {
-        struct stat st;
-        std::memset(&st, 0, sizeof(st));
-        st.st_ino  = de->d_ino;
-        st.st_mode = de->d_type << 12;
-        if (filler(buf, de->d_name, &st, 0, FUSE_FILL_DIR_PLUS))
+    // the attributes of the entries are got along with their names if asked for, the ones failing to be got are left to be looked up
+    auto const plus = 0 != (flags & FUSE_READDIR_PLUS);
+    auto const dents = std::make_unique_for_overwrite<char[]>(kDirentsBufferSize);
+
+    auto res = 0;
+    for (auto full = false; !full;) {
+        auto const n = ::getdents64(fd, dents.get(), kDirentsBufferSize);
+        if (n <= 0) {
+            res = n == -1 ? -errno : 0;
             break;
+        }
+
+        for (ssize_t pos = 0; pos < n && !full;) {
+            auto const* de = reinterpret_cast<struct dirent64 const*>(dents.get() + pos);
+            pos += de->d_reclen;
+
+            struct stat st;
+            auto fill_flags = FUSE_FILL_DIR_PLUS;
+            if (!plus || stat_at(fd, de->d_name, st)) {
+                std::memset(&st, 0, sizeof(st));
+                st.st_ino  = de->d_ino;
+                st.st_mode = de->d_type << 12;
+                fill_flags = plus ? static_cast<fuse_fill_dir_flags>(0) : FUSE_FILL_DIR_PLUS;
+            }
+            full = 0 != filler(buf, de->d_name, &st, 0, fill_flags);
+        }
     }
 
-    ::closedir(dp);
+    if (!fi)
+        ::close(fd);
+
+    return res;
+}
+
+int FileSystemReflector::releasedir(std::filesystem::path const& path [[maybe_unused]], struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    ::close(fi->fh);
+
+    fi->fh = 0x0;
 
     return 0;
 }
@@ -156,27 +241,27 @@ int FileSystemReflector::unlink(std::filesystem::path const& path)
     return res == -1 ? -errno : 0;
 }
 
-int FileSystemReflector::chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* /*fi*/)
+int FileSystemReflector::chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto const res = ::chmod(to_path(path).c_str(), mode);
+    auto const res = fi ? ::fchmod(fi->fh, mode) : ::chmod(to_path(path).c_str(), mode);
 
     return res == -1 ? -errno : 0;
 }
 
-int FileSystemReflector::chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* /*fi*/)
+int FileSystemReflector::chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto const res = ::lchown(to_path(path).c_str(), uid, gid);
+    auto const res = fi ? ::fchown(fi->fh, uid, gid) : ::lchown(to_path(path).c_str(), uid, gid);
 
     return res == -1 ? -errno : 0;
 }
 
 int FileSystemReflector::truncate(std::filesystem::path const& path, off_t size, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
     auto const res = fi ? ::ftruncate(fi->fh, size) : ::truncate(to_path(path).c_str(), size);
 
@@ -213,7 +298,7 @@ int FileSystemReflector::create(std::filesystem::path const& path, mode_t mode,
 
 ssize_t FileSystemReflector::read(std::filesystem::path const& path, std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
     assert(!buf.empty());
 
     auto const fd = fi ? fi->fh : ::open(to_path(path).c_str(), O_RDONLY);
@@ -241,7 +326,7 @@ ssize_t FileSystemReflector::read(std::filesystem::path const& path, std::span<s
 
 ssize_t FileSystemReflector::write(std::filesystem::path const& path, std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
     assert(!buf.empty());
 
     auto const fd = fi ? fi->fh : ::open(to_path(path).c_str(), O_WRONLY);
@@ -291,7 +376,7 @@ int FileSystemReflector::release(std::filesystem::path const& path [[maybe_unuse
 
 int FileSystemReflector::fsync(std::filesystem::path const& path, int /*isdatasync*/, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
     auto const fd = fi ? fi->fh : ::open(to_path(path).c_str(), O_WRONLY);
     if (fd == -1)
@@ -308,12 +393,12 @@ int FileSystemReflector::fsync(std::filesystem::path const& path, int /*isdatasy
 }
 
 #ifdef HAVE_UTIMENSAT
-int FileSystemReflector::utimens(std::filesystem::path const& path, const struct timespec ts[2], struct fuse_file_info* /*fi*/)
+int FileSystemReflector::utimens(std::filesystem::path const& path, const struct timespec ts[2], struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
     /* don't use utime/utimes since they follow symlinks */
-    auto const res = utimensat(0, to_path(path).c_str(), ts, AT_SYMLINK_NOFOLLOW);
+    auto const res = fi ? ::futimens(fi->fh, ts) : utimensat(0, to_path(path).c_str(), ts, AT_SYMLINK_NOFOLLOW);
 
     return res == -1 ? -errno : 0;
 }
@@ -322,16 +407,18 @@ int FileSystemReflector::utimens(std::filesystem::path const& path, const struct
 #ifdef HAVE_POSIX_FALLOCATE
 int FileSystemReflector::fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
-
-    if (mode)
-        return -EOPNOTSUPP;
+    assert(fi || !path.empty());
 
     auto const fd = fi ? fi->fh : ::open(to_path(path).c_str(), O_WRONLY);
     if (fd == -1)
         return -errno;
 
-    auto const res = -::posix_fallocate(fd, offset, length);
+    // the plain allocation is emulated by the C library where the file system does not support it, the rest of the modes are not
+    int res{0};
+    if (0 == mode)
+        res = -::posix_fallocate(fd, offset, length);
+    else if (-1 == ::fallocate(fd, mode, offset, length))
+        res = -errno;
 
     if (!fi)
         ::close(fd);
@@ -340,10 +427,30 @@ int FileSystemReflector::fallocate(std::filesystem::path const& path, int mode,
 }
 #endif // HAVE_POSIX_FALLOCATE
 
-off_t FileSystemReflector::lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const
+#ifdef HAVE_SETXATTR
+int FileSystemReflector::setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags)
 {
     assert(!path.empty());
 
+    auto const res = ::lsetxattr(to_path(path).c_str(), std::string{name}.c_str(), value.data(), value.size(), flags);
+
+    return res == -1 ? -errno : 0;
+}
+
+int FileSystemReflector::getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const
+{
+    assert(!path.empty());
+
+    auto const res = ::lgetxattr(to_path(path).c_str(), std::string{name}.c_str(), value.data(), value.size());
+
+    return res == -1 ? -errno : static_cast<int>(res);
+}
+#endif // HAVE_SETXATTR
+
+off_t FileSystemReflector::lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const
+{
+    assert(fi || !path.empty());
+
     auto const fd = fi ? fi->fh : ::open(to_path(path).c_str(), O_RDONLY);
     if (fd == -1)
         return -errno;
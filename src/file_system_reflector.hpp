@@ -33,8 +33,10 @@ public:
     int rename(std::filesystem::path const& from, std::filesystem::path const& to, unsigned int flags) override;
     int link(std::filesystem::path const& from, std::filesystem::path const& to) override;
     int access(std::filesystem::path const& path, int mask) const override;
+    int opendir(std::filesystem::path const& path, struct fuse_file_info* fi) override;
     int readdir(
         std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const override;
+    int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi) override;
     int unlink(std::filesystem::path const& path) override;
     int chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi) override;
     int chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi) override;
@@ -52,6 +54,10 @@ public:
 #ifdef HAVE_POSIX_FALLOCATE
     int fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) override;
 #endif // HAVE_POSIX_FALLOCATE
+#ifdef HAVE_SETXATTR
+    int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) override;
+    int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const override;
+#endif // HAVE_SETXATTR
     off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const override;
 };
 
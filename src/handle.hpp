@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+
+#include <fuse.h>
+
+#include "inode.hpp"
+
+namespace multifs
+{
+
+// A handle of a file or a directory open refers to its inode, so the requests on the handle get to the inode without looking its path
+// up, and the inode is kept alive until the handle is released
+using Handle = std::shared_ptr<INode>;
+
+inline Handle const* handle(struct fuse_file_info const* fi) noexcept { return fi && fi->fh ? reinterpret_cast<Handle const*>(fi->fh) : nullptr; }
+
+inline void handle_open(struct fuse_file_info* fi, std::unique_ptr<Handle> h) noexcept
+{
+    if (fi)
+        fi->fh = reinterpret_cast<uint64_t>(h.release());
+}
+
+inline void handle_close(struct fuse_file_info* fi) noexcept
+{
+    if (fi) {
+        delete handle(fi);
+        fi->fh = 0x0;
+    }
+}
+
+// Makes a request refer to the inode the way a handle does, for the frontends addressing inodes rather than paths. The inode is to be
+// kept alive by the caller for the duration of the request
+inline struct fuse_file_info handle_of(Handle const& inode) noexcept
+{
+    struct fuse_file_info fi {};
+    fi.fh = reinterpret_cast<uint64_t>(&inode);
+    return fi;
+}
+
+} // namespace multifs
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <variant>
+
+#include "directory.hpp"
+#include "file.hpp"
+#include "symlink.hpp"
+
+namespace multifs
+{
+
+// A node of the namespace. Directories hold the nodes they refer to, so the variant is wrapped into a type to be declared ahead of it
+struct INode : std::variant<File, Symlink, Directory> {
+    using variant::variant;
+};
+
+} // namespace multifs
@@ -4,6 +4,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -30,6 +31,7 @@ public:
         // you cannot change mode of the symlink, but we must return 0 in this case as if it has been successful
         return 0;
     }
+    int operator()(Directory& dir) const noexcept { return dir.chmod(mode_); }
 
     template <typename T>
     int operator()(T&&) const noexcept
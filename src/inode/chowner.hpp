@@ -4,6 +4,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -28,6 +29,7 @@ public:
 
     int operator()(File& file) const noexcept { return file.chown(uid_, gid_, fi_); }
     int operator()(Symlink& lnk) const noexcept { return lnk.chown(uid_, gid_); }
+    int operator()(Directory& dir) const noexcept { return dir.chown(uid_, gid_); }
 
     template <typename T>
     int operator()(T&&) const noexcept
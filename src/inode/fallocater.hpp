@@ -7,6 +7,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -38,6 +39,11 @@ public:
         // fallocating symlinks is impossible
         return -EINVAL;
     }
+    int operator()(Directory&) const noexcept
+    {
+        // directories hold no data
+        return -EISDIR;
+    }
 
     template <typename T>
     int operator()(T&&) const noexcept
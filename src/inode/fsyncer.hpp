@@ -4,6 +4,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -30,6 +31,11 @@ public:
         // symlinks cannot be fsync-ed
         return -EINVAL;
     }
+    int operator()(Directory&) const noexcept
+    {
+        // directories are kept in memory, there is nothing to sync
+        return 0;
+    }
 
     template <typename T>
     int operator()(T&&) const noexcept
@@ -8,6 +8,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -38,6 +39,11 @@ public:
         std::strncpy(buf_.data(), lnk.target().c_str(), buf_.size());
         return 0;
     }
+    int operator()(Directory const&) const noexcept
+    {
+        // reading directories as symlinks is impossible
+        return -EINVAL;
+    }
 
     template <typename T>
     int operator()(T const&) const noexcept
@@ -7,6 +7,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -36,6 +37,11 @@ public:
         // lseek symlinks is impossible
         return -EINVAL;
     }
+    off_t operator()(Directory const&) const noexcept
+    {
+        // directories hold no data
+        return -EISDIR;
+    }
 
     template <typename T>
     off_t operator()(T const&) const noexcept
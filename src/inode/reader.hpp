@@ -10,6 +10,7 @@
 
 #include <span>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -33,12 +34,17 @@ public:
         assert(!buf_.empty());
     }
 
-    ssize_t operator()(File const& file) const noexcept { return file.read(buf_, offset_, fi_); }
+    ssize_t operator()(File const& file) const { return file.read(buf_, offset_, fi_); }
     ssize_t operator()(Symlink const&) const noexcept
     {
         // reading symlinks is impossible, their content must be read by readlink call
         return -EINVAL;
     }
+    ssize_t operator()(Directory const&) const noexcept
+    {
+        // directories are read by readdir
+        return -EISDIR;
+    }
 
     template <typename T>
     ssize_t operator()(T const&) const noexcept
@@ -4,6 +4,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -28,6 +29,11 @@ public:
         // symlinks cannot be released
         return -EINVAL;
     }
+    int operator()(Directory&) const noexcept
+    {
+        // directories are released by releasedir
+        return -EISDIR;
+    }
 
     template <typename T>
     int operator()(T&&) const noexcept
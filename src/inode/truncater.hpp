@@ -6,6 +6,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -32,6 +33,11 @@ public:
         // symbolic links cannot be truncated
         return -EINVAL;
     }
+    int operator()(Directory&) const noexcept
+    {
+        // directories hold no data
+        return -EISDIR;
+    }
 
     template <typename T>
     int operator()(T&&) const noexcept
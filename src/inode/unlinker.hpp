@@ -1,5 +1,6 @@
 #pragma once
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -12,6 +13,7 @@ class Unlinker
 public:
     int operator()(File& file) const { return file.unlink(); }
     int operator()(Symlink&) const noexcept { return 0; }
+    int operator()(Directory&) const noexcept { return 0; }
 
     template <typename T>
     int operator()(T&&) const noexcept
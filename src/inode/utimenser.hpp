@@ -4,6 +4,7 @@
 
 #include <fuse.h>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -26,6 +27,7 @@ public:
 
     int operator()(File& file) const noexcept { return file.utimens(ts_, fi_); }
     int operator()(Symlink& lnk) const noexcept { return lnk.utimens(ts_); }
+    int operator()(Directory& dir) const noexcept { return dir.utimens(ts_); }
 
     template <typename T>
     int operator()(T&&) const noexcept
@@ -10,6 +10,7 @@
 
 #include <span>
 
+#include "directory.hpp"
 #include "file.hpp"
 #include "symlink.hpp"
 #include "utilities.hpp"
@@ -33,12 +34,17 @@ public:
         assert(!buf.empty());
     }
 
-    ssize_t operator()(File& file) const noexcept { return file.write(buf_, offset_, fi_); }
+    ssize_t operator()(File& file) const { return file.write(buf_, offset_, fi_); }
     ssize_t operator()(Symlink&) const noexcept
     {
         // writing to symlinks is impossible
         return -EINVAL;
     }
+    ssize_t operator()(Directory&) const noexcept
+    {
+        // directories hold no data
+        return -EISDIR;
+    }
 
     template <typename T>
     ssize_t operator()(T&&) const noexcept
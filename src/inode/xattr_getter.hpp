@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cerrno>
+
+#include <span>
+#include <string_view>
+
+#include "directory.hpp"
+#include "file.hpp"
+#include "symlink.hpp"
+#include "utilities.hpp"
+
+namespace multifs::inode
+{
+
+class XattrGetter
+{
+private:
+    std::string_view name_;
+    std::span<char> value_;
+
+public:
+    explicit XattrGetter(std::string_view name, std::span<char> value) noexcept
+        : name_(name)
+        , value_(value)
+    {
+    }
+
+    int operator()(File const& file) const noexcept { return file.getxattr(name_, value_); }
+    int operator()(Symlink const&) const noexcept
+    {
+        // symlinks have no extended attributes
+        return -ENODATA;
+    }
+    int operator()(Directory const&) const noexcept
+    {
+        // directories have no extended attributes
+        return -ENODATA;
+    }
+
+    template <typename T>
+    int operator()(T const&) const noexcept
+    {
+        static_assert(dependent_false_v<T>, "unhandled type T to handle 'getxattr'");
+        return 0;
+    }
+};
+
+} // namespace multifs::inode
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cerrno>
+
+#include <span>
+#include <string_view>
+
+#include "directory.hpp"
+#include "file.hpp"
+#include "symlink.hpp"
+#include "utilities.hpp"
+
+namespace multifs::inode
+{
+
+class XattrSetter
+{
+private:
+    std::string_view name_;
+    std::span<char const> value_;
+    int flags_;
+
+public:
+    explicit XattrSetter(std::string_view name, std::span<char const> value, int flags) noexcept
+        : name_(name)
+        , value_(value)
+        , flags_(flags)
+    {
+    }
+
+    int operator()(File& file) const noexcept { return file.setxattr(name_, value_, flags_); }
+    int operator()(Symlink&) const noexcept
+    {
+        // extended attributes of symlinks are not supported
+        return -ENOTSUP;
+    }
+    int operator()(Directory&) const noexcept
+    {
+        // extended attributes of directories are not supported
+        return -ENOTSUP;
+    }
+
+    template <typename T>
+    int operator()(T&&) const noexcept
+    {
+        static_assert(dependent_false_v<T>, "unhandled type T to handle 'setxattr'");
+        return 0;
+    }
+};
+
+} // namespace multifs::inode
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+namespace multifs
+{
+
+// The pool of threads issuing requests to underlying file systems in parallel
+inline boost::asio::thread_pool& io_pool()
+{
+    static boost::asio::thread_pool pool{std::max(4U, 2 * std::thread::hardware_concurrency())};
+    return pool;
+}
+
+// The pool of threads issuing requests the caller may stop waiting for, such requests never wait for others
+inline boost::asio::thread_pool& detached_io_pool()
+{
+    static boost::asio::thread_pool pool{std::max(4U, std::thread::hardware_concurrency())};
+    return pool;
+}
+
+// The pool of threads deleting files in the background, deleting a large file may take a while, so it is kept off the pools serving requests
+inline boost::asio::thread_pool& reaper_pool()
+{
+    static boost::asio::thread_pool pool{std::max(2U, std::thread::hardware_concurrency() / 2)};
+    return pool;
+}
+
+// The pool of threads bringing the chunk files up to date with the attributes of their files in the background
+inline boost::asio::thread_pool& attributes_pool()
+{
+    static boost::asio::thread_pool pool{2};
+    return pool;
+}
+
+// Invokes f for every item of the range in parallel and waits for all of them to complete, the first exception thrown by f is rethrown.
+// The items are claimed one by one by the calling thread and the pool threads, so the calling thread gets all the items done by itself
+// if the pool is busy, that keeps nested calls from deadlocking
+template <std::ranges::random_access_range Range, typename F>
+void parallel_for_each(Range&& range, F f)
+{
+    auto const n = static_cast<std::ptrdiff_t>(std::ranges::size(range));
+    if (n < 1)
+        return;
+
+    auto const first = std::ranges::begin(range);
+    if (1 == n) {
+        f(*first);
+        return;
+    }
+
+    struct State {
+        std::atomic<std::ptrdiff_t> next{0};
+        std::atomic<std::ptrdiff_t> left{0};
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::exception_ptr ex;
+    };
+    auto state  = std::make_shared<State>();
+    state->left = n;
+
+    // the pool threads coming late find nothing to claim and leave the items and f alone
+    auto const drain = [n, first](State& state, F* f) noexcept {
+        for (std::ptrdiff_t i; (i = state.next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+            try {
+                (*f)(first[i]);
+            } catch (...) {
+                std::lock_guard g{state.mtx};
+                if (!state.ex)
+                    state.ex = std::current_exception();
+            }
+            if (1 == state.left.fetch_sub(1, std::memory_order_acq_rel)) {
+                std::lock_guard g{state.mtx};
+                state.cv.notify_all();
+            }
+        }
+    };
+
+    for (std::ptrdiff_t i = 1; i < n; ++i)
+        boost::asio::post(io_pool(), [state, drain, f = &f] { drain(*state, f); });
+
+    drain(*state, &f);
+
+    std::unique_lock lk{state->mtx};
+    state->cv.wait(lk, [&] { return 0 == state->left.load(std::memory_order_acquire); });
+
+    if (state->ex)
+        std::rethrow_exception(state->ex);
+}
+
+} // namespace multifs
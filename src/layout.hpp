@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <utility>
+
+#include "erasure_code.hpp"
+
+namespace multifs
+{
+
+// Describes how the space of a file is laid out over chunks residing in underlying file systems
+struct Layout {
+    enum class Kind : uint8_t {
+        kSpill,  ///< a chunk grows until its file system runs out of space or the chunk size is reached, then the next chunk is created
+        kStripe, ///< RAID-0, the space is split into stripe units distributed round-robin among stripe_width chunks,
+                 ///< RAID-5/6 if every stripe is protected by parity units residing in parity chunks
+    };
+
+    Kind kind{Kind::kSpill};
+    size_t stripe_unit{0};  ///< Size of a stripe unit in bytes, kStripe only
+    size_t stripe_width{0}; ///< Number of chunks a stripe is spread over, kStripe only
+    size_t chunk_size{0};   ///< Maximum size of a chunk in bytes, 0 stands for unbounded
+    size_t copies{1};       ///< Number of replicas of every chunk, RAID-1 if more than one
+    size_t parity{0};       ///< Number of parity chunks following the stripe_width data chunks of a stripe set, kStripe only
+
+    [[nodiscard]] bool striped() const noexcept { return Kind::kStripe == kind; }
+
+    [[nodiscard]] bool coded() const noexcept { return striped() && 0 != parity; }
+
+    // Number of chunks a stripe set consists of, the parity ones included
+    [[nodiscard]] size_t stripe_chunks() const noexcept { return stripe_width + parity; }
+
+    // Number of bytes of a file a stripe holds
+    [[nodiscard]] size_t stripe_size() const noexcept { return stripe_unit * stripe_width; }
+
+    // Chunk boundaries are fixed, so that an offset maps to a chunk arithmetically
+    [[nodiscard]] bool fixed() const noexcept { return striped() || 0 != chunk_size; }
+
+    // Checks whether the layout is applicable to the number of backends and the block size given
+    [[nodiscard]] bool valid(size_t backends, size_t block_size) const noexcept
+    {
+        if (0 == copies || copies > backends)
+            return false;
+        if (striped() && (0 == stripe_unit || 0 == stripe_width || stripe_chunks() > backends))
+            return false;
+        if (parity && (!striped() || parity > ErasureCode::kMaxParity || stripe_width > ErasureCode::kMaxData))
+            return false;
+        if (chunk_size && (0 != chunk_size % block_size || (striped() && 0 != chunk_size % stripe_unit)))
+            return false;
+        return true;
+    }
+
+    // Maps an offset of a file to a pair of a chunk index and an offset within the chunk
+    [[nodiscard]] std::pair<size_t, size_t> locate(size_t offset) const noexcept
+    {
+        assert(fixed());
+
+        if (!striped())
+            return {offset / chunk_size, offset % chunk_size};
+
+        auto const unit_idx     = offset / stripe_unit;
+        auto const column_idx   = unit_idx % stripe_width;
+        auto const column_offset = unit_idx / stripe_width * stripe_unit + offset % stripe_unit;
+        if (!chunk_size)
+            return {column_idx, column_offset};
+
+        // the columns of a stripe are cut into chunks of chunk_size, every stripe_chunks() chunks make a stripe set
+        return {column_offset / chunk_size * stripe_chunks() + column_idx, column_offset % chunk_size};
+    }
+
+    // Tells whether the chunk holds parity units rather than data of a file
+    [[nodiscard]] bool parity_chunk(size_t chunk_idx) const noexcept { return coded() && chunk_idx % stripe_chunks() >= stripe_width; }
+
+    // Maps a chunk index and an offset within the chunk back to the offset of a file, the inverse of locate()
+    [[nodiscard]] size_t offset(size_t chunk_idx, size_t chunk_offset) const noexcept
+    {
+        assert(fixed());
+        assert(!parity_chunk(chunk_idx));
+
+        if (!striped())
+            return chunk_idx * chunk_size + chunk_offset;
+
+        auto const column_idx    = chunk_idx % stripe_chunks();
+        auto const column_offset = (chunk_size ? chunk_idx / stripe_chunks() * chunk_size : 0) + chunk_offset;
+        return (column_offset / stripe_unit * stripe_width + column_idx) * stripe_unit + column_offset % stripe_unit;
+    }
+
+    // Returns how many bytes starting at the offset of a file are mapped contiguously to a chunk
+    [[nodiscard]] size_t extent(size_t offset) const noexcept
+    {
+        assert(fixed());
+        return striped() ? stripe_unit - offset % stripe_unit : chunk_size - offset % chunk_size;
+    }
+
+    // Returns how many bytes the chunk must hold for the file to be of size file_size
+    [[nodiscard]] size_t chunk_length(size_t chunk_idx, size_t file_size) const noexcept
+    {
+        assert(fixed());
+
+        if (!striped())
+            return std::clamp(file_size, chunk_idx * chunk_size, (chunk_idx + 1) * chunk_size) - chunk_idx * chunk_size;
+
+        // a parity chunk is as long as the first data chunk of its stripe set, which is the longest one
+        auto column_idx = chunk_idx % stripe_chunks();
+        if (column_idx >= stripe_width)
+            column_idx = 0;
+
+        auto const units      = file_size / stripe_unit;
+        auto const full_units = units / stripe_width * stripe_unit;
+
+        auto column_length = full_units;
+        if (auto const tail_idx = units % stripe_width; column_idx < tail_idx)
+            column_length += stripe_unit;
+        else if (column_idx == tail_idx)
+            column_length += file_size % stripe_unit;
+
+        if (!chunk_size)
+            return column_length;
+
+        auto const chunk_start = chunk_idx / stripe_chunks() * chunk_size;
+        return std::clamp(column_length, chunk_start, chunk_start + chunk_size) - chunk_start;
+    }
+};
+
+} // namespace multifs
@@ -86,6 +86,15 @@ public:
         return fs_->access(path, mask);
     }
 
+    int opendir(std::filesystem::path const& path, struct fuse_file_info* fi) override
+    {
+        out_ << "multifs: opendir, path " << path << ", fi " << fi;
+        if (fi)
+            out_ << ", fi->flags 0" << std::oct << fi->flags << std::dec;
+        out_ << std::endl;
+        return fs_->opendir(path, fi);
+    }
+
     int readdir(
         std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const override
     {
@@ -96,6 +105,15 @@ public:
         return fs_->readdir(path, buf, filler, offset, fi, flags);
     }
 
+    int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi) override
+    {
+        out_ << "multifs: releasedir, path " << path << ", fi " << fi;
+        if (fi)
+            out_ << ", fi->flags 0" << std::oct << fi->flags << std::dec;
+        out_ << std::endl;
+        return fs_->releasedir(path, fi);
+    }
+
     int unlink(std::filesystem::path const& path) override
     {
         out_ << "multifs: unlink, path " << path << std::endl;
@@ -211,6 +229,21 @@ public:
     }
 #endif // HAVE_POSIX_FALLOCATE
 
+#ifdef HAVE_SETXATTR
+    int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) override
+    {
+        out_ << "multifs: setxattr, path " << path << ", name " << name << ", size " << value.size() << ", flags 0x" << std::hex << flags << std::dec
+             << std::endl;
+        return fs_->setxattr(path, name, value, flags);
+    }
+
+    int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const override
+    {
+        out_ << "multifs: getxattr, path " << path << ", name " << name << ", size " << value.size() << std::endl;
+        return fs_->getxattr(path, name, value);
+    }
+#endif // HAVE_SETXATTR
+
     off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const override
     {
         out_ << "multifs: lseek, path " << path << std::endl;
@@ -0,0 +1,761 @@
+#include "low_level_frontend.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fuse_lowlevel.h>
+
+#include "caller.hpp"
+#include "directory.hpp"
+#include "handle.hpp"
+#include "scope_exit.hpp"
+#include "wrap.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr double kTimeout{1.0}; ///< Seconds the kernel keeps the entries and the attributes replied for, as the high-level API does by default
+
+LowLevelFrontend& frontend(fuse_req_t req) noexcept { return *static_cast<LowLevelFrontend*>(fuse_req_userdata(req)); }
+
+// Serves the request on behalf of the process it is made by, replying with the error it fails with if any
+template <typename Request, typename... Args>
+void serve(fuse_req_t req, Request request, Args... args) noexcept
+{
+    auto const* ctx = fuse_req_ctx(req);
+    assert(ctx);
+    Caller const caller{.uid = ctx->uid, .gid = ctx->gid};
+    CallerScope const scope{caller};
+
+    if (auto const r = wrap([&] { return (frontend(req).*request)(req, args...); }); r < 0)
+        fuse_reply_err(req, -r);
+}
+
+void init(void* userdata [[maybe_unused]], struct fuse_conn_info* conn) noexcept
+{
+    // the attributes of the entries are listed along with them at no extra cost, so they are listed always
+    if (conn->capable & FUSE_CAP_READDIRPLUS) {
+        conn->want |= FUSE_CAP_READDIRPLUS;
+        conn->want &= ~FUSE_CAP_READDIRPLUS_AUTO;
+    }
+}
+
+void lookup(fuse_req_t req, fuse_ino_t parent, char const* name) noexcept { serve(req, &LowLevelFrontend::lookup, parent, name); }
+
+void forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup) noexcept
+{
+    serve(req, static_cast<int (LowLevelFrontend::*)(fuse_req_t, fuse_ino_t, uint64_t)>(&LowLevelFrontend::forget), ino, nlookup);
+}
+
+void forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data* forgets) noexcept
+{
+    serve(req, &LowLevelFrontend::forget_multi, count, forgets);
+}
+
+void getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::getattr, ino, fi); }
+
+void setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::setattr, ino, attr, to_set, fi);
+}
+
+void readlink(fuse_req_t req, fuse_ino_t ino) noexcept { serve(req, &LowLevelFrontend::readlink, ino); }
+
+void mkdir(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode) noexcept { serve(req, &LowLevelFrontend::mkdir, parent, name, mode); }
+
+void unlink(fuse_req_t req, fuse_ino_t parent, char const* name) noexcept { serve(req, &LowLevelFrontend::unlink, parent, name); }
+
+void rmdir(fuse_req_t req, fuse_ino_t parent, char const* name) noexcept { serve(req, &LowLevelFrontend::rmdir, parent, name); }
+
+void symlink(fuse_req_t req, char const* link, fuse_ino_t parent, char const* name) noexcept { serve(req, &LowLevelFrontend::symlink, link, parent, name); }
+
+void rename(fuse_req_t req, fuse_ino_t parent, char const* name, fuse_ino_t newparent, char const* newname, unsigned int flags) noexcept
+{
+    serve(req, &LowLevelFrontend::rename, parent, name, newparent, newname, flags);
+}
+
+void link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, char const* newname) noexcept { serve(req, &LowLevelFrontend::link, ino, newparent, newname); }
+
+void open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::open, ino, fi); }
+
+void read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::read, ino, size, off, fi);
+}
+
+void write(fuse_req_t req, fuse_ino_t ino, char const* buf, size_t size, off_t off, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::write, ino, buf, size, off, fi);
+}
+
+void release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::release, ino, fi); }
+
+void fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::fsync, ino, datasync, fi); }
+
+void opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::opendir, ino, fi); }
+
+void readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::readdir, ino, size, off, fi);
+}
+
+void readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::readdirplus, ino, size, off, fi);
+}
+
+void releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) noexcept { serve(req, &LowLevelFrontend::releasedir, ino, fi); }
+
+void statfs(fuse_req_t req, fuse_ino_t ino) noexcept { serve(req, &LowLevelFrontend::statfs, ino); }
+
+void create(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::create, parent, name, mode, fi);
+}
+
+#ifdef HAVE_SETXATTR
+void setxattr(fuse_req_t req, fuse_ino_t ino, char const* name, char const* value, size_t size, int flags) noexcept
+{
+    serve(req, &LowLevelFrontend::setxattr, ino, name, value, size, flags);
+}
+
+void getxattr(fuse_req_t req, fuse_ino_t ino, char const* name, size_t size) noexcept { serve(req, &LowLevelFrontend::getxattr, ino, name, size); }
+#endif // HAVE_SETXATTR
+
+#ifdef HAVE_POSIX_FALLOCATE
+void fallocate(fuse_req_t req, fuse_ino_t ino, int mode, off_t offset, off_t length, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::fallocate, ino, mode, offset, length, fi);
+}
+#endif // HAVE_POSIX_FALLOCATE
+
+void lseek(fuse_req_t req, fuse_ino_t ino, off_t off, int whence, struct fuse_file_info* fi) noexcept
+{
+    serve(req, &LowLevelFrontend::lseek, ino, off, whence, fi);
+}
+
+// Neither mknod nor access is served: multifs makes no special files, and access checks nothing but the inode existing, which is known
+// for the inodes the kernel refers to, so the kernel is left to fail the former and let the latter succeed
+fuse_lowlevel_ops const& getops() noexcept
+{
+    static fuse_lowlevel_ops const ops = {
+        .init         = init,
+        .lookup       = lookup,
+        .forget       = forget,
+        .getattr      = getattr,
+        .setattr      = setattr,
+        .readlink     = readlink,
+        .mkdir        = mkdir,
+        .unlink       = unlink,
+        .rmdir        = rmdir,
+        .symlink      = symlink,
+        .rename       = rename,
+        .link         = link,
+        .open         = open,
+        .read         = read,
+        .write        = write,
+        .release      = release,
+        .fsync        = fsync,
+        .opendir      = opendir,
+        .readdir      = readdir,
+        .releasedir   = releasedir,
+        .statfs       = statfs,
+#ifdef HAVE_SETXATTR
+        .setxattr     = setxattr,
+        .getxattr     = getxattr,
+#endif
+        .create       = create,
+        .forget_multi = forget_multi,
+#ifdef HAVE_POSIX_FALLOCATE
+        .fallocate    = fallocate,
+#endif
+        .readdirplus  = readdirplus,
+        .lseek        = lseek,
+    };
+    return ops;
+}
+
+} // anonymous namespace
+
+LowLevelFrontend::LowLevelFrontend(std::unique_ptr<MultiFileSystem> fs)
+    : fs_(std::move(fs))
+{
+    if (!fs_)
+        throw std::invalid_argument("fs provided cannot be empty");
+
+    root_ = {.inode = fs_->root(), .ino = 0, .nlookup = 1};
+}
+
+int LowLevelFrontend::run(fuse_args& args)
+{
+    struct fuse_cmdline_opts opts {};
+    if (0 != fuse_parse_cmdline(&args, &opts))
+        return EXIT_FAILURE;
+    scope_exit const free_mountpoint_sce{[&opts] { std::free(opts.mountpoint); }};
+
+    if (opts.show_version) {
+        std::cout << "FUSE library version " << fuse_pkgversion() << '\n';
+        fuse_lowlevel_version();
+        return EXIT_SUCCESS;
+    }
+    if (!opts.mountpoint) {
+        std::cerr << "there is no mount point to mount multifs at\n";
+        return EXIT_FAILURE;
+    }
+
+    auto* se = fuse_session_new(&args, &getops(), sizeof(fuse_lowlevel_ops), this);
+    if (!se)
+        return EXIT_FAILURE;
+    scope_exit const destroy_sce{[se] { fuse_session_destroy(se); }};
+
+    if (0 != fuse_set_signal_handlers(se))
+        return EXIT_FAILURE;
+    scope_exit const signal_handlers_sce{[se] { fuse_remove_signal_handlers(se); }};
+
+    if (0 != fuse_session_mount(se, opts.mountpoint))
+        return EXIT_FAILURE;
+    scope_exit const unmount_sce{[se] { fuse_session_unmount(se); }};
+
+    fuse_daemonize(opts.foreground);
+
+    if (opts.singlethread)
+        return 0 == fuse_session_loop(se) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    struct fuse_loop_config config {};
+    config.clone_fd         = opts.clone_fd;
+    config.max_idle_threads = opts.max_idle_threads;
+    return 0 == fuse_session_loop_mt(se, &config) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+LowLevelFrontend::Node& LowLevelFrontend::node(fuse_ino_t ino) noexcept { return FUSE_ROOT_ID == ino ? root_ : *reinterpret_cast<Node*>(ino); }
+
+fuse_ino_t LowLevelFrontend::nodeid(Node const& node) const noexcept { return &root_ == &node ? FUSE_ROOT_ID : reinterpret_cast<fuse_ino_t>(&node); }
+
+LowLevelFrontend::Node& LowLevelFrontend::remember(std::shared_ptr<INode> const& inode)
+{
+    assert(inode);
+
+    auto const ino = std::visit([](auto const& item) { return item.ino(); }, *inode);
+
+    std::lock_guard g{nodes_mtx_};
+    auto it = nodes_.find(ino);
+    if (nodes_.end() == it)
+        it = nodes_.emplace(ino, std::make_unique<Node>(Node{.inode = inode, .ino = ino, .nlookup = 0})).first;
+    ++it->second->nlookup;
+    return *it->second;
+}
+
+void LowLevelFrontend::forget(Node& node, uint64_t nlookup) noexcept
+{
+    if (&root_ == &node)
+        return;
+
+    std::lock_guard g{nodes_mtx_};
+    assert(nlookup <= node.nlookup);
+    if (0 == (node.nlookup -= nlookup))
+        nodes_.erase(node.ino);
+}
+
+int LowLevelFrontend::entry(Node const& dir, std::string_view name, fuse_entry_param& e)
+{
+    auto const* d = std::get_if<Directory>(dir.inode.get());
+    if (!d)
+        return -ENOTDIR;
+    auto const* inode = d->find(name);
+    if (!inode)
+        return -ENOENT;
+
+    auto fi = handle_of(*inode);
+    if (auto const r = fs_->getattr({}, e.attr, &fi))
+        return r;
+    e.ino           = nodeid(remember(*inode));
+    e.attr_timeout  = kTimeout;
+    e.entry_timeout = kTimeout;
+
+    return 0;
+}
+
+int LowLevelFrontend::reply_entry(fuse_req_t req, Node const& dir, std::string_view name)
+{
+    fuse_entry_param e{};
+    if (auto const r = entry(dir, name, e))
+        return r;
+    if (0 != fuse_reply_entry(req, &e))
+        forget(node(e.ino), 1);
+
+    return 0;
+}
+
+int LowLevelFrontend::lookup(fuse_req_t req, fuse_ino_t parent, char const* name)
+{
+    std::shared_lock g{lock_};
+    return reply_entry(req, node(parent), name);
+}
+
+int LowLevelFrontend::forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup)
+{
+    forget(node(ino), nlookup);
+    fuse_reply_none(req);
+
+    return 0;
+}
+
+int LowLevelFrontend::forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data* forgets)
+{
+    for (auto const& f : std::span{forgets, count})
+        forget(node(f.ino), f.nlookup);
+    fuse_reply_none(req);
+
+    return 0;
+}
+
+int LowLevelFrontend::getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* /*fi*/)
+{
+    std::shared_lock g{lock_};
+
+    struct stat stbuf {};
+    auto fi = handle_of(node(ino).inode);
+    if (auto const r = fs_->getattr({}, stbuf, &fi))
+        return r;
+    fuse_reply_attr(req, &stbuf, kTimeout);
+
+    return 0;
+}
+
+int LowLevelFrontend::setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set, struct fuse_file_info* /*fi*/)
+{
+    assert(attr);
+
+    std::lock_guard g{lock_};
+
+    struct stat stbuf {};
+    auto fi = handle_of(node(ino).inode);
+    if (auto const r = fs_->getattr({}, stbuf, &fi))
+        return r;
+
+    if (to_set & FUSE_SET_ATTR_MODE) {
+        if (auto const r = fs_->chmod({}, attr->st_mode, &fi))
+            return r;
+    }
+    if (to_set & (FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID)) {
+        // the owner left unchanged is given as it is, as the inodes take both of the owners
+        auto const uid = (to_set & FUSE_SET_ATTR_UID) ? attr->st_uid : stbuf.st_uid;
+        auto const gid = (to_set & FUSE_SET_ATTR_GID) ? attr->st_gid : stbuf.st_gid;
+        if (auto const r = fs_->chown({}, uid, gid, &fi))
+            return r;
+    }
+    if (to_set & FUSE_SET_ATTR_SIZE) {
+        if (auto const r = fs_->truncate({}, attr->st_size, &fi))
+            return r;
+    }
+#ifdef HAVE_UTIMENSAT
+    if (to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME)) {
+        struct timespec ts[2] = {
+            {.tv_sec = 0, .tv_nsec = UTIME_OMIT},
+            {.tv_sec = 0, .tv_nsec = UTIME_OMIT},
+        };
+        if (to_set & FUSE_SET_ATTR_ATIME_NOW)
+            ts[0].tv_nsec = UTIME_NOW;
+        else if (to_set & FUSE_SET_ATTR_ATIME)
+            ts[0] = attr->st_atim;
+        if (to_set & FUSE_SET_ATTR_MTIME_NOW)
+            ts[1].tv_nsec = UTIME_NOW;
+        else if (to_set & FUSE_SET_ATTR_MTIME)
+            ts[1] = attr->st_mtim;
+        if (auto const r = fs_->utimens({}, ts, &fi))
+            return r;
+    }
+#endif // HAVE_UTIMENSAT
+
+    if (auto const r = fs_->getattr({}, stbuf, &fi))
+        return r;
+    fuse_reply_attr(req, &stbuf, kTimeout);
+
+    return 0;
+}
+
+int LowLevelFrontend::readlink(fuse_req_t req, fuse_ino_t ino)
+{
+    std::shared_lock g{lock_};
+
+    std::vector<char> buf(PATH_MAX + 1);
+    if (auto const r = fs_->readlink(node(ino).inode, std::span{buf}.first(PATH_MAX)))
+        return r;
+    fuse_reply_readlink(req, buf.data());
+
+    return 0;
+}
+
+int LowLevelFrontend::mkdir(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode)
+{
+    std::lock_guard g{lock_};
+
+    auto const& dir = node(parent);
+    auto* d         = std::get_if<Directory>(dir.inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->mkdir(*d, name, mode))
+        return r;
+
+    return reply_entry(req, dir, name);
+}
+
+int LowLevelFrontend::unlink(fuse_req_t req, fuse_ino_t parent, char const* name)
+{
+    std::lock_guard g{lock_};
+
+    auto* d = std::get_if<Directory>(node(parent).inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->unlink(*d, name))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+
+int LowLevelFrontend::rmdir(fuse_req_t req, fuse_ino_t parent, char const* name)
+{
+    std::lock_guard g{lock_};
+
+    auto* d = std::get_if<Directory>(node(parent).inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->rmdir(*d, name))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+
+int LowLevelFrontend::symlink(fuse_req_t req, char const* link, fuse_ino_t parent, char const* name)
+{
+    std::lock_guard g{lock_};
+
+    auto const& dir = node(parent);
+    auto* d         = std::get_if<Directory>(dir.inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->symlink(link, *d, name))
+        return r;
+
+    return reply_entry(req, dir, name);
+}
+
+int LowLevelFrontend::rename(fuse_req_t req, fuse_ino_t parent, char const* name, fuse_ino_t newparent, char const* newname, unsigned int flags)
+{
+    std::lock_guard g{lock_};
+
+    auto* from = std::get_if<Directory>(node(parent).inode.get());
+    auto* to   = std::get_if<Directory>(node(newparent).inode.get());
+    if (!from || !to)
+        return -ENOTDIR;
+    if (auto const r = fs_->rename(*from, name, *to, newname, flags))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+
+int LowLevelFrontend::link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, char const* newname)
+{
+    std::lock_guard g{lock_};
+
+    auto const& dir = node(newparent);
+    auto* d         = std::get_if<Directory>(dir.inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->link(node(ino).inode, *d, newname))
+        return r;
+
+    return reply_entry(req, dir, newname);
+}
+
+int LowLevelFrontend::open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    if (auto const r = fs_->open(node(ino).inode, fi))
+        return r;
+    // the pages of the files are kept cached across opens, as the high-level frontend is configured to
+    fi->keep_cache = 1;
+    if (0 != fuse_reply_open(req, fi))
+        fs_->release({}, fi);
+
+    return 0;
+}
+
+int LowLevelFrontend::read(fuse_req_t req, fuse_ino_t /*ino*/, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::shared_lock g{lock_};
+
+    std::vector<std::byte> buf(size);
+    auto const r = fs_->read({}, buf, off, fi);
+    if (r < 0)
+        return static_cast<int>(r);
+    fuse_reply_buf(req, reinterpret_cast<char const*>(buf.data()), static_cast<size_t>(r));
+
+    return 0;
+}
+
+int LowLevelFrontend::write(fuse_req_t req, fuse_ino_t /*ino*/, char const* buf, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    auto const r = fs_->write({}, {reinterpret_cast<std::byte const*>(buf), size}, off, fi);
+    if (r < 0)
+        return static_cast<int>(r);
+    fuse_reply_write(req, static_cast<size_t>(r));
+
+    return 0;
+}
+
+int LowLevelFrontend::release(fuse_req_t req, fuse_ino_t /*ino*/, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    fuse_reply_err(req, -fs_->release({}, fi));
+
+    return 0;
+}
+
+int LowLevelFrontend::fsync(fuse_req_t req, fuse_ino_t /*ino*/, int datasync, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    if (auto const r = fs_->fsync({}, datasync, fi))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+
+int LowLevelFrontend::opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::shared_lock g{lock_};
+
+    if (auto const r = fs_->opendir(node(ino).inode, fi))
+        return r;
+    if (0 != fuse_reply_open(req, fi))
+        fs_->releasedir({}, fi);
+
+    return 0;
+}
+
+int LowLevelFrontend::list(fuse_req_t req, Node const& dir, size_t size, off_t off, struct fuse_file_info* fi, bool plus)
+{
+    struct Listing {
+        LowLevelFrontend& frontend;
+        fuse_req_t req;
+        Node const& dir;
+        bool plus;
+        std::vector<char> buf;
+        size_t used;
+        std::vector<Node*> remembered; ///< Nodes of the entries whose lookups are counted, forgotten unless the reply is delivered
+    } listing{*this, req, dir, plus, std::vector<char>(size), 0, {}};
+
+    // the entries are added to the reply as long as they fit in, the ones listed with their attributes are counted as looked up, all but
+    // "." and "..", which come with no attributes
+    auto const fill = [](void* buf, char const* name, struct stat const* stbuf, off_t off, fuse_fill_dir_flags /*flags*/) noexcept -> int {
+        auto& l         = *static_cast<Listing*>(buf);
+        auto const rest = std::span{l.buf}.subspan(l.used);
+        try {
+            if (!l.plus) {
+                struct stat st {};
+                if (stbuf)
+                    st = *stbuf;
+                else
+                    st.st_mode = S_IFDIR;
+                auto const entsize = fuse_add_direntry(l.req, rest.data(), rest.size(), name, &st, off);
+                if (entsize > rest.size())
+                    return 1;
+                l.used += entsize;
+                return 0;
+            }
+
+            auto const entsize = fuse_add_direntry_plus(l.req, nullptr, 0, name, nullptr, 0);
+            if (entsize > rest.size())
+                return 1;
+
+            fuse_entry_param e{};
+            if (stbuf) {
+                auto const* inode = std::get<Directory>(*l.dir.inode).find(name);
+                assert(inode);
+                // the room is reserved ahead, so that no lookup counted goes unrecorded
+                l.remembered.reserve(l.remembered.size() + 1);
+                auto& node = l.frontend.remember(*inode);
+                l.remembered.push_back(&node);
+                e.attr          = *stbuf;
+                e.ino           = l.frontend.nodeid(node);
+                e.attr_timeout  = kTimeout;
+                e.entry_timeout = kTimeout;
+            } else {
+                e.attr.st_mode = S_IFDIR;
+            }
+            fuse_add_direntry_plus(l.req, rest.data(), rest.size(), name, &e, off);
+            l.used += entsize;
+            return 0;
+        } catch (...) {
+            return 1;
+        }
+    };
+
+    std::shared_lock g{lock_};
+
+    if (auto const r = fs_->readdir({}, &listing, fill, off, fi, plus ? FUSE_READDIR_PLUS : static_cast<fuse_readdir_flags>(0)))
+        return r;
+    if (0 != fuse_reply_buf(req, listing.buf.data(), listing.used)) {
+        for (auto* node : listing.remembered)
+            forget(*node, 1);
+    }
+
+    return 0;
+}
+
+int LowLevelFrontend::readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    return list(req, node(ino), size, off, fi, false);
+}
+
+int LowLevelFrontend::readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    return list(req, node(ino), size, off, fi, true);
+}
+
+int LowLevelFrontend::releasedir(fuse_req_t req, fuse_ino_t /*ino*/, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::shared_lock g{lock_};
+
+    fuse_reply_err(req, -fs_->releasedir({}, fi));
+
+    return 0;
+}
+
+int LowLevelFrontend::statfs(fuse_req_t req, fuse_ino_t /*ino*/)
+{
+    std::shared_lock g{lock_};
+
+    struct statvfs stbuf {};
+    if (auto const r = fs_->statfs("/", stbuf))
+        return r;
+    fuse_reply_statfs(req, &stbuf);
+
+    return 0;
+}
+
+int LowLevelFrontend::create(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    auto const& dir = node(parent);
+    auto* d         = std::get_if<Directory>(dir.inode.get());
+    if (!d)
+        return -ENOTDIR;
+    if (auto const r = fs_->create(*d, name, mode, fi))
+        return r;
+    fi->keep_cache = 1;
+
+    fuse_entry_param e{};
+    if (auto const r = entry(dir, name, e)) {
+        fs_->release({}, fi);
+        return r;
+    }
+    if (0 != fuse_reply_create(req, &e, fi)) {
+        fs_->release({}, fi);
+        forget(node(e.ino), 1);
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_SETXATTR
+int LowLevelFrontend::setxattr(fuse_req_t req, fuse_ino_t ino, char const* name, char const* value, size_t size, int flags)
+{
+    std::lock_guard g{lock_};
+
+    if (auto const r = fs_->setxattr(node(ino).inode, name, {value, size}, flags))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+
+int LowLevelFrontend::getxattr(fuse_req_t req, fuse_ino_t ino, char const* name, size_t size)
+{
+    std::shared_lock g{lock_};
+
+    // the size of the value is asked for with no room for it
+    std::vector<char> buf(size);
+    auto const r = fs_->getxattr(node(ino).inode, name, buf);
+    if (r < 0)
+        return r;
+    if (0 == size)
+        fuse_reply_xattr(req, static_cast<size_t>(r));
+    else
+        fuse_reply_buf(req, buf.data(), static_cast<size_t>(r));
+
+    return 0;
+}
+#endif // HAVE_SETXATTR
+
+#ifdef HAVE_POSIX_FALLOCATE
+int LowLevelFrontend::fallocate(fuse_req_t req, fuse_ino_t /*ino*/, int mode, off_t offset, off_t length, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::lock_guard g{lock_};
+
+    if (auto const r = fs_->fallocate({}, mode, offset, length, fi))
+        return r;
+    fuse_reply_err(req, 0);
+
+    return 0;
+}
+#endif // HAVE_POSIX_FALLOCATE
+
+int LowLevelFrontend::lseek(fuse_req_t req, fuse_ino_t /*ino*/, off_t off, int whence, struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    std::shared_lock g{lock_};
+
+    auto const r = fs_->lseek({}, off, whence, fi);
+    if (r < 0)
+        return static_cast<int>(r);
+    fuse_reply_lseek(req, r);
+
+    return 0;
+}
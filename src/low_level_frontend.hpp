@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include <fuse_lowlevel.h>
+
+#include "inode.hpp"
+#include "multi_file_system.hpp"
+#include "thread_safe_access_file_system.hpp"
+
+namespace multifs
+{
+
+// Serves the file system over the low-level API of FUSE. The kernel addresses the inodes by the node IDs it is given for them on looking
+// them up rather than by paths, so the requests get straight to the inodes, with neither paths computed by FUSE nor looked up by multifs.
+// The inodes are reported by the numbers they are known by in the namespace, which are stable across lookups and mounts
+class LowLevelFrontend final
+{
+private:
+    // An inode the kernel has been told of, it is kept until the kernel forgets all the lookups of it
+    struct Node {
+        std::shared_ptr<INode> inode;
+        uint64_t ino;     ///< Number the inode is known by in the namespace
+        uint64_t nlookup; ///< Number of the lookups of the node the kernel has not forgotten yet
+    };
+
+    std::unique_ptr<MultiFileSystem> fs_;
+    mutable RWLock lock_; ///< Shared by the requests reading the file system, exclusive to the ones changing it as ThreadSafeAccessFileSystem
+    std::mutex nodes_mtx_;
+    std::unordered_map<uint64_t, std::unique_ptr<Node>> nodes_; ///< Nodes the kernel has been told of, by the numbers of their inodes
+    Node root_;                                                 ///< Node of the root directory, known by FUSE_ROOT_ID and never forgotten
+
+    Node& node(fuse_ino_t ino) noexcept;
+    fuse_ino_t nodeid(Node const& node) const noexcept;
+    // Counts a lookup of the inode, making a node for it if the kernel has not been told of it yet
+    Node& remember(std::shared_ptr<INode> const& inode);
+    void forget(Node& node, uint64_t nlookup) noexcept;
+    // Fills the entry of the name within the directory in, counting its lookup
+    int entry(Node const& dir, std::string_view name, fuse_entry_param& e);
+    // Replies with the entry of the name within the directory, the lookup is not counted unless the reply is delivered
+    int reply_entry(fuse_req_t req, Node const& dir, std::string_view name);
+    // Lists the entries of the directory past the offset given, along with their attributes and lookups counted if plus is set
+    int list(fuse_req_t req, Node const& dir, size_t size, off_t off, struct fuse_file_info* fi, bool plus);
+
+public:
+    explicit LowLevelFrontend(std::unique_ptr<MultiFileSystem> fs);
+    ~LowLevelFrontend() = default;
+
+    LowLevelFrontend(LowLevelFrontend const&)            = delete;
+    LowLevelFrontend& operator=(LowLevelFrontend const&) = delete;
+
+    LowLevelFrontend(LowLevelFrontend&&)            = delete;
+    LowLevelFrontend& operator=(LowLevelFrontend&&) = delete;
+
+    // Mounts the file system at the mount point given on the command line and serves it until it is unmounted, returns the exit code
+    int run(fuse_args& args);
+
+    // The requests reply on success only, the errors returned are replied by the caller
+    int lookup(fuse_req_t req, fuse_ino_t parent, char const* name);
+    int forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup);
+    int forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data* forgets);
+    int getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+    int setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set, struct fuse_file_info* fi);
+    int readlink(fuse_req_t req, fuse_ino_t ino);
+    int mkdir(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode);
+    int unlink(fuse_req_t req, fuse_ino_t parent, char const* name);
+    int rmdir(fuse_req_t req, fuse_ino_t parent, char const* name);
+    int symlink(fuse_req_t req, char const* link, fuse_ino_t parent, char const* name);
+    int rename(fuse_req_t req, fuse_ino_t parent, char const* name, fuse_ino_t newparent, char const* newname, unsigned int flags);
+    int link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, char const* newname);
+    int open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+    int read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi);
+    int write(fuse_req_t req, fuse_ino_t ino, char const* buf, size_t size, off_t off, struct fuse_file_info* fi);
+    int release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+    int fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info* fi);
+    int opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+    int readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi);
+    int readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi);
+    int releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi);
+    int statfs(fuse_req_t req, fuse_ino_t ino);
+    int create(fuse_req_t req, fuse_ino_t parent, char const* name, mode_t mode, struct fuse_file_info* fi);
+#ifdef HAVE_SETXATTR
+    int setxattr(fuse_req_t req, fuse_ino_t ino, char const* name, char const* value, size_t size, int flags);
+    int getxattr(fuse_req_t req, fuse_ino_t ino, char const* name, size_t size);
+#endif // HAVE_SETXATTR
+#ifdef HAVE_POSIX_FALLOCATE
+    int fallocate(fuse_req_t req, fuse_ino_t ino, int mode, off_t offset, off_t length, struct fuse_file_info* fi);
+#endif // HAVE_POSIX_FALLOCATE
+    int lseek(fuse_req_t req, fuse_ino_t ino, off_t off, int whence, struct fuse_file_info* fi);
+};
+
+} // namespace multifs
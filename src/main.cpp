@@ -1,12 +1,17 @@
+#include <cstddef>
 #include <cstdlib>
 
 #include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <iostream>
 #include <iterator>
 #include <list>
 #include <ranges>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <system_error>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/constants.hpp>
@@ -15,6 +20,7 @@
 #include <fuse.h>
 
 #include "app_params.hpp"
+#include "mount_point.hpp"
 #include "multifs.hpp"
 #include "scope_exit.hpp"
 
@@ -26,9 +32,21 @@ namespace
 enum {
     /* Valueless keys */
     KEY_HELP,
+    KEY_LOW_LEVEL,
     KEY_VALUELESS_QTY,
     /* Valueful keys */
     KEY_FSS = KEY_VALUELESS_QTY,
+    KEY_STRIPE_UNIT,
+    KEY_STRIPE_WIDTH,
+    KEY_CHUNK_SIZE,
+    KEY_COPIES,
+    KEY_PARITY,
+    KEY_PLACEMENT,
+    KEY_REBALANCE_RATE,
+    KEY_CHUNK_POOL,
+    KEY_CHUNK_PREALLOC,
+    KEY_ZERO_BLOCKS,
+    KEY_METADATA,
 #ifndef NDEBUG
     KEY_LOG,
 #endif
@@ -38,13 +56,67 @@ enum {
 const struct fuse_opt multifs_option_desc[] = {
     FUSE_OPT_KEY("--help", KEY_HELP),
     FUSE_OPT_KEY("-h", KEY_HELP),
+    FUSE_OPT_KEY("--low-level", KEY_LOW_LEVEL),
     FUSE_OPT_KEY("--fss=", KEY_FSS),
+    FUSE_OPT_KEY("--stripe-unit=", KEY_STRIPE_UNIT),
+    FUSE_OPT_KEY("--stripe-width=", KEY_STRIPE_WIDTH),
+    FUSE_OPT_KEY("--chunk-size=", KEY_CHUNK_SIZE),
+    FUSE_OPT_KEY("--copies=", KEY_COPIES),
+    FUSE_OPT_KEY("--parity=", KEY_PARITY),
+    FUSE_OPT_KEY("--placement=", KEY_PLACEMENT),
+    FUSE_OPT_KEY("--rebalance-rate=", KEY_REBALANCE_RATE),
+    FUSE_OPT_KEY("--chunk-pool=", KEY_CHUNK_POOL),
+    FUSE_OPT_KEY("--chunk-prealloc=", KEY_CHUNK_PREALLOC),
+    FUSE_OPT_KEY("--zero-blocks=", KEY_ZERO_BLOCKS),
+    FUSE_OPT_KEY("--metadata=", KEY_METADATA),
 #ifndef NDEBUG
     FUSE_OPT_KEY("--log=", KEY_LOG),
 #endif
     FUSE_OPT_END,
 };
 
+size_t parse_size(std::string_view svsize)
+{
+    size_t size{0};
+    auto const [ptr, ec] = std::from_chars(svsize.data(), svsize.data() + svsize.size(), size);
+    if (std::errc{} != ec)
+        throw std::invalid_argument("invalid size '" + std::string{svsize} + "' provided");
+
+    switch (std::string_view suffix{ptr, svsize.data() + svsize.size()}; suffix.empty() ? '\0' : suffix.front()) {
+        case 'G':
+        case 'g':
+            size *= 1024;
+            [[fallthrough]];
+        case 'M':
+        case 'm':
+            size *= 1024;
+            [[fallthrough]];
+        case 'K':
+        case 'k':
+            size *= 1024;
+            [[fallthrough]];
+        case '\0':
+            break;
+        default:
+            throw std::invalid_argument("invalid size suffix '" + std::string{suffix} + "' provided");
+    }
+
+    return size;
+}
+
+PlacementPolicyKind parse_placement(std::string_view svplacement)
+{
+    if ("most-free-space" == svplacement)
+        return PlacementPolicyKind::kMostFreeSpace;
+    if ("round-robin" == svplacement)
+        return PlacementPolicyKind::kWeightedRoundRobin;
+    if ("least-latency" == svplacement)
+        return PlacementPolicyKind::kLeastLatency;
+    if ("spread-writers" == svplacement)
+        return PlacementPolicyKind::kSpreadWriters;
+    throw std::invalid_argument("unknown placement policy '" + std::string{svplacement} + "'");
+}
+
 int arg_processor(void* data, char const* arg, int key, struct fuse_args* outargs) noexcept
 try {
     if (auto it = std::ranges::find_if(multifs_option_desc, [=](auto const& opt) { return key == opt.value; }); it != std::end(multifs_option_desc)) {
@@ -55,6 +127,9 @@ try {
                 case KEY_HELP:
                     params.show_help = true;
                     return 0;
+                case KEY_LOW_LEVEL:
+                    params.low_level = true;
+                    return 0;
                 default:
                     break;
             }
@@ -63,11 +138,45 @@ try {
             svarg.remove_prefix(std::string_view{it->templ}.length());
             switch (it->value) {
                 case KEY_FSS: {
-                    std::list<std::filesystem::path> mpts;
+                    std::list<std::string> mpts;
                     boost::split(mpts, svarg, boost::is_any_of(":"), boost::token_compress_on);
-                    std::ranges::move(mpts, std::back_inserter(params.mpts));
+                    std::ranges::transform(mpts, std::back_inserter(params.mpts), parse_mount_point);
                     return 0;
                 }
+                case KEY_STRIPE_UNIT:
+                    params.layout.stripe_unit = parse_size(svarg);
+                    params.layout.kind        = params.layout.stripe_unit ? Layout::Kind::kStripe : Layout::Kind::kSpill;
+                    return 0;
+                case KEY_STRIPE_WIDTH:
+                    params.layout.stripe_width = std::stoul(std::string{svarg});
+                    return 0;
+                case KEY_CHUNK_SIZE:
+                    params.layout.chunk_size = parse_size(svarg);
+                    return 0;
+                case KEY_COPIES:
+                    params.layout.copies = std::stoul(std::string{svarg});
+                    return 0;
+                case KEY_PARITY:
+                    params.layout.parity = std::stoul(std::string{svarg});
+                    return 0;
+                case KEY_PLACEMENT:
+                    params.placement = parse_placement(svarg);
+                    return 0;
+                case KEY_REBALANCE_RATE:
+                    params.rebalance_rate = parse_size(svarg);
+                    return 0;
+                case KEY_CHUNK_POOL:
+                    params.chunk_pool = std::stoul(std::string{svarg});
+                    return 0;
+                case KEY_CHUNK_PREALLOC:
+                    params.chunk_prealloc = parse_size(svarg);
+                    return 0;
+                case KEY_ZERO_BLOCKS:
+                    params.zero_block = parse_size(svarg);
+                    return 0;
+                case KEY_METADATA:
+                    params.metadata = svarg;
+                    return 0;
 #ifndef NDEBUG
                 case KEY_LOG:
                     params.logp = svarg;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include <sys/types.h>
+
+#include "layout.hpp"
+
+namespace multifs
+{
+
+// Attributes of an inode as kept by the metadata store, the views refer to the memory of the record source and are valid while it is handled
+struct InodeRecord {
+    enum class Kind : uint8_t {
+        kFile,
+        kSymlink,
+        kDirectory,
+    };
+
+    uint64_t ino;
+    Kind kind;
+    mode_t mode;
+    uid_t owner_uid;
+    gid_t owner_gid;
+    int flags;
+    size_t size;
+    timespec atime;
+    timespec mtime;
+    timespec ctime;
+    Layout layout;         ///< Layout of the chunks of a file, kFile only
+    size_t zero_block;     ///< Size of the blocks of zeros left holes in a file, kFile only
+    std::string_view data; ///< Path the chunks of a file are named after, the target of a symlink, empty for a directory
+};
+
+// A chunk of a file as kept by the metadata store, a chunk having got no backends has not been created
+struct ChunkRecord {
+    uint64_t ino;
+    size_t chunk_idx;
+    std::pair<size_t, size_t> offset_range;
+    std::span<std::string_view const> backends; ///< Names of the backends the replicas of the chunk reside on
+};
+
+} // namespace multifs
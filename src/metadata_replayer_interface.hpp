@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string_view>
+
+#include "metadata_record.hpp"
+
+namespace multifs
+{
+
+// Rebuilds the state of a file system out of the records the metadata store replays in the order they have been committed in,
+// every record carries the whole state of what it describes, so a record replayed over the same state is harmless
+class IMetadataReplayer
+{
+public:
+    IMetadataReplayer()          = default;
+    virtual ~IMetadataReplayer() = default;
+
+    IMetadataReplayer(IMetadataReplayer const&)            = default;
+    IMetadataReplayer& operator=(IMetadataReplayer const&) = default;
+
+    IMetadataReplayer(IMetadataReplayer&&) noexcept            = default;
+    IMetadataReplayer& operator=(IMetadataReplayer&&) noexcept = default;
+
+    // Creates the inode or updates its attributes
+    virtual void inode(InodeRecord const& record) = 0;
+    // Sets the chunk of a file, the chunk map grows to hold it
+    virtual void chunk(ChunkRecord const& record) = 0;
+    // Cuts or extends the chunk map of a file to the number of chunks given
+    virtual void chunks(uint64_t ino, size_t count) = 0;
+    // Makes the name refer to the inode, the inode the name referred to before loses the link
+    virtual void link(std::string_view name, uint64_t ino) = 0;
+    virtual void unlink(std::string_view name) = 0;
+};
+
+} // namespace multifs
@@ -0,0 +1,316 @@
+#include "metadata_scanner.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <fuse.h>
+
+#include "chunk_name.hpp"
+#include "io_pool.hpp"
+#include "metadata_record.hpp"
+#include "utilities.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr std::string_view kLostFound{"/lost+found"}; ///< Directory the files named by their IDs are recovered in, their names are not known
+constexpr std::string_view kReservedPrefix{".multifs."}; ///< Prefix of the names the backends keep their own directories at the root by
+
+// A chunk file found on a backend
+struct Entry {
+    std::string path; ///< Path the chunks of the file are named after
+    size_t chunk_idx;
+    size_t size;
+    uint32_t backend_idx;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    timespec atime;
+    timespec mtime;
+    timespec ctime;
+};
+
+// A directory found on a backend
+struct Dir {
+    std::string path;
+    uid_t uid;
+    gid_t gid;
+    timespec atime;
+    timespec mtime;
+    timespec ctime;
+};
+
+// Chunk files and directories found on a backend while it is being listed
+struct Listing {
+    std::vector<Entry>& entries;
+    std::vector<Dir>& dirs;
+    std::vector<std::string> fanout; ///< Directories of the fan-out tree the chunks named by the IDs of their files reside in
+    std::string_view dir;            ///< Path of the directory being listed, empty for the root
+    bool in_fanout;                  ///< Whether the directory being listed belongs to the fan-out tree rather than to the namespace
+    uint32_t backend_idx;
+};
+
+// Splits the name of a chunk file into the name of the path the chunks of its file are named after and the index of the chunk
+std::optional<std::pair<std::string_view, size_t>> parse(std::string_view name) noexcept
+{
+    auto const dot = name.rfind('.');
+    if (std::string_view::npos == dot)
+        return std::nullopt;
+
+    size_t chunk_idx{0};
+    auto const digits = name.substr(dot + 1);
+    if (auto const [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), chunk_idx);
+        std::errc{} != ec || digits.empty() || digits.data() + digits.size() != ptr)
+        return std::nullopt;
+
+    auto const prefix = name.substr(0, dot);
+    if (!prefix.ends_with(kChunkSuffix) || prefix.size() == kChunkSuffix.size())
+        return std::nullopt;
+
+    return std::pair{prefix, chunk_idx};
+}
+
+int fill(void* buf, char const* name, struct stat const* stbuf, off_t /*off*/, fuse_fill_dir_flags flags)
+{
+    auto& listing = *static_cast<Listing*>(buf);
+    std::string_view const entry_name{name};
+
+    // the directories of the namespace are mirrored by the backends the chunks were named by the paths of their files on, the fan-out
+    // tree, the pool of files to create chunks out of and the trash are not
+    if (stbuf && S_ISDIR(stbuf->st_mode)) {
+        if ("." == entry_name || ".." == entry_name)
+            return 0;
+        if (listing.in_fanout)
+            listing.fanout.push_back(std::string{listing.dir} + '/' + std::string{entry_name});
+        else if (!(listing.dir.empty() && entry_name.starts_with(kReservedPrefix))) {
+            listing.dirs.push_back({
+                .path  = std::string{listing.dir} + '/' + std::string{entry_name},
+                .uid   = stbuf->st_uid,
+                .gid   = stbuf->st_gid,
+                .atime = stbuf->st_atim,
+                .mtime = stbuf->st_mtim,
+                .ctime = stbuf->st_ctim,
+            });
+        }
+        return 0;
+    }
+
+    if (0 == (flags & FUSE_FILL_DIR_PLUS) || !S_ISREG(stbuf->st_mode))
+        return 0;
+
+    auto const chunk = parse(entry_name);
+    if (!chunk)
+        return 0;
+
+    listing.entries.push_back({
+        .path        = std::string{listing.dir} + '/' + std::string{chunk->first},
+        .chunk_idx   = chunk->second,
+        .size        = static_cast<size_t>(stbuf->st_size),
+        .backend_idx = listing.backend_idx,
+        .mode        = stbuf->st_mode,
+        .uid         = stbuf->st_uid,
+        .gid         = stbuf->st_gid,
+        .atime       = stbuf->st_atim,
+        .mtime       = stbuf->st_mtim,
+        .ctime       = stbuf->st_ctim,
+    });
+
+    return 0;
+}
+
+timespec later(timespec const& a, timespec const& b) noexcept { return std::tie(a.tv_sec, a.tv_nsec) < std::tie(b.tv_sec, b.tv_nsec) ? b : a; }
+
+} // anonymous namespace
+
+uint64_t MetadataScanner::scan(std::span<std::shared_ptr<Backend> const> backends, IMetadataReplayer& replayer, uint64_t first_ino) const
+{
+    // every backend is listed by a thread of its own, the listing of a backend is bound by the latency of its file system
+    std::vector<std::vector<Entry>> listings(backends.size());
+    std::vector<std::vector<Dir>> dir_listings(backends.size());
+    parallel_for_each(std::views::iota(size_t{0}, backends.size()), [&](size_t backend_idx) {
+        Listing listing{listings[backend_idx], dir_listings[backend_idx], {}, {}, false, static_cast<uint32_t>(backend_idx)};
+        auto const scan_dir = [&](std::filesystem::path const& path) {
+            auto const r = backends[backend_idx]->readdir(path, &listing, fill, 0, nullptr, FUSE_READDIR_PLUS);
+            // the fan-out tree is made along with the first chunk named by the ID of its file
+            if (r && !(-ENOENT == r && kChunkDir == path.native()))
+                throw std::system_error(-r, std::generic_category(), "failed to scan " + path.string() + " of backend " + backends[backend_idx]->name());
+        };
+
+        // the directories found are listed in turn, the ones found meanwhile are appended to be listed later on
+        for (size_t dir_idx = 0; dir_idx <= listing.dirs.size(); ++dir_idx) {
+            // the path is copied out as the directories found are appended meanwhile
+            std::string const dir = 0 == dir_idx ? std::string{} : listing.dirs[dir_idx - 1].path;
+            listing.dir           = dir;
+            scan_dir(dir.empty() ? "/" : dir.c_str());
+        }
+
+        listing.in_fanout = true;
+        listing.fanout.emplace_back(kChunkDir);
+        for (size_t dir_idx = 0; dir_idx < listing.fanout.size(); ++dir_idx) {
+            std::string const dir = listing.fanout[dir_idx];
+            listing.dir           = dir;
+            scan_dir(dir.c_str());
+        }
+    });
+
+    // a directory is made on the backends holding chunks of the files in it, so the directories found on all of them make up the tree
+    std::vector<Dir> dirs;
+    for (auto& listing : dir_listings)
+        std::ranges::move(listing, std::back_inserter(dirs));
+    std::ranges::sort(dirs, {}, &Dir::path);
+    auto const [first_dup, last_dup] = std::ranges::unique(dirs, {}, &Dir::path);
+    dirs.erase(first_dup, last_dup);
+
+    std::vector<Entry> entries;
+    entries.reserve(std::accumulate(listings.cbegin(), listings.cend(), size_t{0}, [](size_t n, auto const& listing) { return n + listing.size(); }));
+    for (auto& listing : listings) {
+        std::ranges::move(listing, std::back_inserter(entries));
+        std::vector<Entry>{}.swap(listing);
+    }
+
+    // the files named by their IDs are recovered in a directory of their own, which is made unless the namespace has one already
+    auto const lost = [](Entry const& entry) { return entry.path.starts_with(kChunkDir); };
+    if (std::ranges::any_of(entries, lost) && !std::ranges::binary_search(dirs, kLostFound, {}, &Dir::path)) {
+        auto const now = current_time();
+        dirs.insert(std::ranges::upper_bound(dirs, kLostFound, {}, &Dir::path), {
+            .path  = std::string{kLostFound},
+            .uid   = 0,
+            .gid   = 0,
+            .atime = now,
+            .mtime = now,
+            .ctime = now,
+        });
+    }
+
+    auto ino = first_ino;
+
+    // every directory is linked ahead of its entries, its path sorts ahead of theirs
+    for (auto const& dir : dirs) {
+        replayer.inode({
+            .ino        = ino,
+            .kind       = InodeRecord::Kind::kDirectory,
+            .mode       = S_IFDIR | 0755,
+            .owner_uid  = dir.uid,
+            .owner_gid  = dir.gid,
+            .flags      = 0,
+            .size       = 0,
+            .atime      = dir.atime,
+            .mtime      = dir.mtime,
+            .ctime      = dir.ctime,
+            .layout     = {},
+            .zero_block = 0,
+            .data       = {},
+        });
+        replayer.link(dir.path, ino++);
+    }
+
+    // the chunks of a file come one after another in their order, the replicas of a chunk come together
+    std::ranges::sort(entries, {}, [](Entry const& entry) { return std::tie(entry.path, entry.chunk_idx, entry.backend_idx); });
+
+    struct Chunk {
+        size_t chunk_idx;
+        size_t size; ///< Number of bytes the longest replica holds
+        std::span<Entry const> replicas;
+    };
+    std::vector<Chunk> chunks;
+    std::vector<std::string_view> names;
+
+    for (auto file_it = entries.cbegin(); entries.cend() != file_it; ++ino) {
+        auto const file_end = std::find_if(file_it, entries.cend(), [&](Entry const& entry) { return entry.path != file_it->path; });
+
+        chunks.clear();
+        for (auto chunk_it = file_it; file_end != chunk_it;) {
+            auto const chunk_end = std::find_if(chunk_it, file_end, [&](Entry const& entry) { return entry.chunk_idx != chunk_it->chunk_idx; });
+            auto const size      = std::ranges::max_element(chunk_it, chunk_end, {}, &Entry::size)->size;
+            chunks.push_back({chunk_it->chunk_idx, size, {chunk_it, chunk_end}});
+            chunk_it = chunk_end;
+        }
+
+        // the attributes of a file are the ones of its chunk changed last, the chunks get changed altogether
+        auto const& latest =
+            *std::ranges::max_element(file_it, file_end, {}, [](Entry const& entry) { return std::tie(entry.ctime.tv_sec, entry.ctime.tv_nsec); });
+
+        InodeRecord record{
+            .ino        = ino,
+            .kind       = InodeRecord::Kind::kFile,
+            .mode       = S_IFREG | (latest.mode & ~S_IFMT),
+            .owner_uid  = latest.uid,
+            .owner_gid  = latest.gid,
+            .flags      = 0,
+            .size       = 0,
+            .atime      = {},
+            .mtime      = {},
+            .ctime      = latest.ctime,
+            .layout     = layout_,
+            .zero_block = zero_block_,
+            .data       = file_it->path,
+        };
+        for (auto const& entry : std::ranges::subrange(file_it, file_end)) {
+            record.atime = later(record.atime, entry.atime);
+            record.mtime = later(record.mtime, entry.mtime);
+        }
+
+        // a fixed layout tells where the data of every chunk goes, spilled chunks follow each other closely
+        if (layout_.fixed()) {
+            for (auto const& chunk : chunks) {
+                if (0 != chunk.size && !layout_.parity_chunk(chunk.chunk_idx))
+                    record.size = std::max(record.size, layout_.offset(chunk.chunk_idx, chunk.size - 1) + 1);
+            }
+        } else {
+            for (auto const& chunk : chunks)
+                record.size += chunk.size;
+        }
+        replayer.inode(record);
+
+        size_t start{0};
+        size_t chunk_idx{0};
+        for (auto const& chunk : chunks) {
+            std::pair<size_t, size_t> range{};
+            if (!layout_.fixed()) {
+                // the space of the holes in between spilled chunks is not known, so the holes are closed up
+                for (; chunk_idx < chunk.chunk_idx; ++chunk_idx)
+                    replayer.chunk({.ino = ino, .chunk_idx = chunk_idx, .offset_range = {start, start}, .backends = {}});
+                range = {start, &chunk == &chunks.back() ? std::numeric_limits<size_t>::max() : start + chunk.size};
+                start += chunk.size;
+                ++chunk_idx;
+            }
+
+            names.clear();
+            std::ranges::transform(
+                chunk.replicas, std::back_inserter(names), [&](Entry const& entry) -> std::string_view { return backends[entry.backend_idx]->name(); });
+            replayer.chunk({.ino = ino, .chunk_idx = chunk.chunk_idx, .offset_range = range, .backends = names});
+        }
+        replayer.chunks(ino, chunks.back().chunk_idx + 1);
+
+        auto const base = std::string_view{file_it->path}.substr(0, file_it->path.size() - kChunkSuffix.size());
+        if (lost(*file_it))
+            replayer.link(std::string{kLostFound} + std::string{base.substr(base.rfind('/'))}, ino);
+        else
+            replayer.link(base, ino);
+
+        file_it = file_end;
+    }
+
+    return ino;
+}
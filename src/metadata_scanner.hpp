@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <span>
+
+#include "backend.hpp"
+#include "layout.hpp"
+#include "metadata_replayer_interface.hpp"
+
+namespace multifs
+{
+
+// Rebuilds the namespace and the chunk maps out of the chunk files residing on the backends, the way to recover a file system whose
+// metadata is missing or damaged. The backends are listed in parallel and the attributes of the chunk files are read along with their
+// names, the fan-out tree the chunk files reside in is descended into, as are the directories mirroring the namespace on the backends the
+// chunk files were named by the paths of their files on. What the chunk files do not tell is lost: a file is named after its ID in
+// /lost+found, or after the name it was created by if its chunks were named by it, symlinks and extra hard links are gone, directories
+// get the default mode, every file is laid out the way given and the holes in between spilled chunks are closed up
+class MetadataScanner final
+{
+private:
+    Layout layout_;
+    size_t zero_block_;
+
+public:
+    MetadataScanner(Layout layout, size_t zero_block) noexcept
+        : layout_(layout)
+        , zero_block_(zero_block)
+    {
+    }
+
+    // Replays the directories and the files found on the backends as records numbered from the inode number given on, returns the number following the largest
+    // one replayed. Throws if a backend fails to be listed, as the files residing on it would be lost otherwise
+    uint64_t scan(std::span<std::shared_ptr<Backend> const> backends, IMetadataReplayer& replayer, uint64_t first_ino = 1) const;
+};
+
+} // namespace multifs
@@ -0,0 +1,625 @@
+#include "metadata_store.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+#include <boost/crc.hpp>
+
+#include "io_pool.hpp"
+#include "scope_exit.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+constexpr std::string_view kCheckpointName{"checkpoint"};
+constexpr std::string_view kCheckpointTmpName{"checkpoint.tmp"};
+constexpr std::string_view kLogPrefix{"log."};
+constexpr std::string_view kDamagedSuffix{".damaged"};
+
+constexpr std::array<char, 8> kCheckpointMagic{'M', 'F', 'S', 'C', 'K', 'P', 'T', '1'};
+constexpr uint32_t kCheckpointVersion{1};
+
+enum class Op : uint8_t {
+    kBackend = 1, ///< Gives a backend name an index the chunk records of the same transaction refer to it by
+    kInode,
+    kChunk,
+    kChunks,
+    kLink,
+    kUnlink,
+};
+
+// Precedes every transaction in the log, a transaction torn by a crash fails the checksum and ends the segment
+struct FrameHeader {
+    uint32_t size; ///< Size of the records following
+    uint32_t crc;  ///< CRC-32 of the records following
+};
+
+// Precedes the state in a checkpoint, the state is encoded as the records of a single transaction
+struct CheckpointHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t next_ino; ///< Inode number to be given to the next inode created
+    uint64_t log_seq;  ///< First segment of the log written past the checkpoint
+    uint64_t size;     ///< Size of the state following the header
+};
+
+uint32_t crc32(std::string_view data) noexcept
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(), data.size());
+    return crc.checksum();
+}
+
+int write_all(int fd, std::string_view data) noexcept
+{
+    while (!data.empty()) {
+        auto const r = ::write(fd, data.data(), data.size());
+        if (r < 0) {
+            if (EINTR == errno)
+                continue;
+            return -errno;
+        }
+        data.remove_prefix(static_cast<size_t>(r));
+    }
+    return 0;
+}
+
+// Makes the entries of the directory created, renamed and deleted durable
+int sync_dir(std::filesystem::path const& dir) noexcept
+{
+    auto const fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return -errno;
+    auto const r = ::fsync(fd) ? -errno : 0;
+    ::close(fd);
+    return r;
+}
+
+// Returns the sequence number of the log segment the file name is of, if it is one
+std::optional<uint64_t> segment_seq(std::string_view name) noexcept
+{
+    if (!name.starts_with(kLogPrefix))
+        return std::nullopt;
+    name.remove_prefix(kLogPrefix.size());
+
+    uint64_t seq{0};
+    if (auto const [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), seq); std::errc{} != ec || name.data() + name.size() != ptr)
+        return std::nullopt;
+    return seq;
+}
+
+std::string segment_name(uint64_t seq) { return std::string{kLogPrefix} + std::to_string(seq); }
+
+// A read-only mapping of a file, a file empty is mapped as an empty span
+class FileMapping
+{
+private:
+    void* addr_{MAP_FAILED};
+    size_t size_{0};
+
+public:
+    explicit FileMapping(std::filesystem::path const& path)
+    {
+        auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "failed to open " + path.string());
+        scope_exit const fd_close{[fd] { ::close(fd); }};
+
+        // clang-format off
+        struct stat st{};
+        // clang-format on
+        if (::fstat(fd, &st))
+            throw std::system_error(errno, std::generic_category(), "failed to stat " + path.string());
+        if (0 == st.st_size)
+            return;
+
+        size_ = static_cast<size_t>(st.st_size);
+        addr_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (MAP_FAILED == addr_)
+            throw std::system_error(errno, std::generic_category(), "failed to map " + path.string());
+    }
+    ~FileMapping()
+    {
+        if (MAP_FAILED != addr_)
+            ::munmap(addr_, size_);
+    }
+
+    FileMapping(FileMapping const&)            = delete;
+    FileMapping& operator=(FileMapping const&) = delete;
+
+    FileMapping(FileMapping&&)            = delete;
+    FileMapping& operator=(FileMapping&&) = delete;
+
+    [[nodiscard]] std::span<char const> data() const noexcept
+    {
+        return MAP_FAILED == addr_ ? std::span<char const>{} : std::span{static_cast<char const*>(addr_), size_};
+    }
+};
+
+// Decodes the records in place, the strings decoded refer to the memory decoded
+class Decoder
+{
+private:
+    std::span<char const> buf_;
+    size_t pos_{0};
+
+public:
+    explicit Decoder(std::span<char const> buf) noexcept
+        : buf_(buf)
+    {
+    }
+
+    [[nodiscard]] bool done() const noexcept { return buf_.size() == pos_; }
+
+    template <typename T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (buf_.size() - pos_ < sizeof(T))
+            throw std::runtime_error("metadata record is truncated");
+        T value;
+        std::memcpy(&value, buf_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    std::string_view str()
+    {
+        auto const size = get<uint32_t>();
+        if (buf_.size() - pos_ < size)
+            throw std::runtime_error("metadata record is truncated");
+        std::string_view const str{buf_.data() + pos_, size};
+        pos_ += size;
+        return str;
+    }
+};
+
+} // anonymous namespace
+
+template <typename T>
+void MetadataStore::Transaction::put(T const& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    buf_.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+void MetadataStore::Transaction::put(std::string_view str)
+{
+    put(static_cast<uint32_t>(str.size()));
+    buf_.append(str);
+}
+
+uint32_t MetadataStore::Transaction::backend(std::string_view name)
+{
+    // there are a few backends, so the names are looked up linearly
+    if (auto const it = std::ranges::find(backends_, name); backends_.end() != it)
+        return static_cast<uint32_t>(it - backends_.begin());
+
+    auto const idx = static_cast<uint32_t>(backends_.size());
+    backends_.emplace_back(name);
+    put(Op::kBackend);
+    put(idx);
+    put(name);
+    return idx;
+}
+
+void MetadataStore::Transaction::inode(InodeRecord const& record)
+{
+    put(Op::kInode);
+    put(record.ino);
+    put(record.kind);
+    put(record.mode);
+    put(record.owner_uid);
+    put(record.owner_gid);
+    put(record.flags);
+    put(static_cast<uint64_t>(record.size));
+    for (auto const& ts : {record.atime, record.mtime, record.ctime}) {
+        put(static_cast<int64_t>(ts.tv_sec));
+        put(static_cast<int64_t>(ts.tv_nsec));
+    }
+    put(record.layout.kind);
+    for (auto const n : {record.layout.stripe_unit, record.layout.stripe_width, record.layout.chunk_size, record.layout.copies, record.layout.parity})
+        put(static_cast<uint64_t>(n));
+    put(static_cast<uint64_t>(record.zero_block));
+    put(record.data);
+}
+
+void MetadataStore::Transaction::chunk(ChunkRecord const& record)
+{
+    // the backend names are put ahead of the chunk record referring to them
+    for (auto const name : record.backends)
+        backend(name);
+
+    put(Op::kChunk);
+    put(record.ino);
+    put(static_cast<uint64_t>(record.chunk_idx));
+    put(static_cast<uint64_t>(record.offset_range.first));
+    put(static_cast<uint64_t>(record.offset_range.second));
+    put(static_cast<uint32_t>(record.backends.size()));
+    for (auto const name : record.backends)
+        put(backend(name));
+}
+
+void MetadataStore::Transaction::chunks(uint64_t ino, size_t count)
+{
+    put(Op::kChunks);
+    put(ino);
+    put(static_cast<uint64_t>(count));
+}
+
+void MetadataStore::Transaction::link(std::string_view name, uint64_t ino)
+{
+    put(Op::kLink);
+    put(name);
+    put(ino);
+}
+
+void MetadataStore::Transaction::unlink(std::string_view name)
+{
+    put(Op::kUnlink);
+    put(name);
+}
+
+MetadataStore::MetadataStore(std::filesystem::path dir)
+    : dir_(std::move(dir))
+{
+    if (dir_.empty())
+        throw std::invalid_argument("metadata directory cannot be empty");
+}
+
+MetadataStore::~MetadataStore()
+{
+    // the transactions committed are written before the log is closed
+    flusher_.request_stop();
+    if (flusher_.joinable())
+        flusher_.join();
+    if (0 <= log_fd_)
+        ::close(log_fd_);
+}
+
+void MetadataStore::replay(std::span<char const> payload, IMetadataReplayer& replayer)
+{
+    std::vector<std::string_view> backends;
+    std::vector<std::string_view> replicas;
+
+    for (Decoder d{payload}; !d.done();) {
+        switch (d.get<Op>()) {
+            case Op::kBackend: {
+                auto const idx = d.get<uint32_t>();
+                if (backends.size() <= idx)
+                    backends.resize(idx + 1);
+                backends[idx] = d.str();
+                break;
+            }
+            case Op::kInode: {
+                InodeRecord record{};
+                record.ino       = d.get<uint64_t>();
+                record.kind      = d.get<InodeRecord::Kind>();
+                record.mode      = d.get<mode_t>();
+                record.owner_uid = d.get<uid_t>();
+                record.owner_gid = d.get<gid_t>();
+                record.flags     = d.get<int>();
+                record.size      = d.get<uint64_t>();
+                for (auto* ts : {&record.atime, &record.mtime, &record.ctime}) {
+                    ts->tv_sec  = static_cast<time_t>(d.get<int64_t>());
+                    ts->tv_nsec = static_cast<long>(d.get<int64_t>());
+                }
+                auto& layout = record.layout;
+                layout.kind  = d.get<Layout::Kind>();
+                for (auto* n : {&layout.stripe_unit, &layout.stripe_width, &layout.chunk_size, &layout.copies, &layout.parity})
+                    *n = d.get<uint64_t>();
+                record.zero_block = d.get<uint64_t>();
+                record.data       = d.str();
+                next_ino_         = std::max(next_ino_, record.ino + 1);
+                replayer.inode(record);
+                break;
+            }
+            case Op::kChunk: {
+                ChunkRecord record{};
+                record.ino                 = d.get<uint64_t>();
+                record.chunk_idx           = d.get<uint64_t>();
+                record.offset_range.first  = d.get<uint64_t>();
+                record.offset_range.second = d.get<uint64_t>();
+                replicas.resize(d.get<uint32_t>());
+                for (auto& replica : replicas) {
+                    auto const idx = d.get<uint32_t>();
+                    if (backends.size() <= idx || backends[idx].empty())
+                        throw std::runtime_error("metadata chunk record refers to an unknown backend");
+                    replica = backends[idx];
+                }
+                record.backends = replicas;
+                replayer.chunk(record);
+                break;
+            }
+            case Op::kChunks: {
+                auto const ino = d.get<uint64_t>();
+                replayer.chunks(ino, d.get<uint64_t>());
+                break;
+            }
+            case Op::kLink: {
+                auto const name = d.str();
+                replayer.link(name, d.get<uint64_t>());
+                break;
+            }
+            case Op::kUnlink:
+                replayer.unlink(d.str());
+                break;
+            default:
+                throw std::runtime_error("metadata record is of an unknown kind");
+        }
+    }
+}
+
+bool MetadataStore::empty() const
+{
+    if (!std::filesystem::exists(dir_))
+        return true;
+    if (std::filesystem::exists(dir_ / kCheckpointName))
+        return false;
+
+    return std::ranges::none_of(
+        std::filesystem::directory_iterator{dir_}, [](auto const& entry) { return segment_seq(entry.path().filename().native()).has_value(); });
+}
+
+void MetadataStore::discard()
+{
+    assert(0 > log_fd_);
+
+    std::vector<std::string> names;
+    for (auto const& entry : std::filesystem::directory_iterator{dir_}) {
+        if (auto name = entry.path().filename().native(); kCheckpointName == name || segment_seq(name))
+            names.push_back(std::move(name));
+    }
+
+    // the files are kept for the damage to be looked into, the ones kept by the previous discard are replaced
+    for (auto const& name : names)
+        std::filesystem::rename(dir_ / name, dir_ / (name + std::string{kDamagedSuffix}));
+    if (auto const r = sync_dir(dir_))
+        throw std::system_error(-r, std::generic_category(), "failed to sync metadata directory " + dir_.string());
+
+    next_ino_ = 1;
+}
+
+uint64_t MetadataStore::load(IMetadataReplayer& replayer)
+{
+    assert(0 > log_fd_);
+
+    std::filesystem::create_directories(dir_);
+
+    // the checkpoint is decoded right off the mapping, the records are handed to the replayer without being copied
+    uint64_t first_seq{0};
+    if (std::filesystem::exists(dir_ / kCheckpointName)) {
+        FileMapping const checkpoint{dir_ / kCheckpointName};
+        auto const data = checkpoint.data();
+
+        CheckpointHeader header;
+        if (data.size() < sizeof(header))
+            throw std::runtime_error("metadata checkpoint is truncated");
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (kCheckpointMagic != header.magic || kCheckpointVersion != header.version)
+            throw std::runtime_error("metadata checkpoint is of an unknown format");
+        if (data.size() - sizeof(header) != header.size)
+            throw std::runtime_error("metadata checkpoint is truncated");
+
+        ::madvise(const_cast<char*>(data.data()), data.size(), MADV_SEQUENTIAL);
+        replay(data.subspan(sizeof(header)), replayer);
+        next_ino_ = std::max(next_ino_, header.next_ino);
+        first_seq = header.log_seq;
+    }
+
+    std::vector<uint64_t> seqs;
+    for (auto const& entry : std::filesystem::directory_iterator{dir_}) {
+        if (auto const seq = segment_seq(entry.path().filename().native()); seq && first_seq <= *seq)
+            seqs.push_back(*seq);
+    }
+    std::ranges::sort(seqs);
+
+    // every mount appends to a segment of its own, so a segment torn by a crash is followed by the segments of the next mounts
+    for (auto const seq : seqs) {
+        FileMapping const segment{dir_ / segment_name(seq)};
+        auto data = segment.data();
+        for (FrameHeader header; sizeof(header) <= data.size();) {
+            std::memcpy(&header, data.data(), sizeof(header));
+            data = data.subspan(sizeof(header));
+            if (data.size() < header.size || header.crc != crc32({data.data(), header.size}))
+                break;
+            replay(data.first(header.size), replayer);
+            data = data.subspan(header.size);
+        }
+    }
+
+    log_seq_ = std::max(seqs.empty() ? 0 : seqs.back() + 1, std::max<uint64_t>(first_seq, 1));
+    log_fd_  = ::open((dir_ / segment_name(log_seq_)).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0600);
+    if (log_fd_ < 0)
+        throw std::system_error(errno, std::generic_category(), "failed to create metadata log in " + dir_.string());
+    if (auto const r = sync_dir(dir_))
+        throw std::system_error(-r, std::generic_category(), "failed to sync metadata directory " + dir_.string());
+
+    return next_ino_;
+}
+
+void MetadataStore::flush(std::stop_token stoken)
+{
+    std::string batch;
+
+    std::unique_lock lk{mtx_};
+    for (;;) {
+        pending_cv_.wait(lk, stoken, [this] { return !pending_.empty(); });
+        if (pending_.empty())
+            return;
+
+        // the transactions committed while the previous batch was being synced make up the next one and get synced at once
+        batch.clear();
+        std::swap(batch, pending_);
+        auto const upto = committed_;
+        auto const fd   = log_fd_;
+        lk.unlock();
+
+        auto r = write_all(fd, batch);
+        if (!r && ::fdatasync(fd))
+            r = -errno;
+
+        lk.lock();
+        if (r && !error_)
+            error_ = r;
+        durable_ = upto;
+        durable_cv_.notify_all();
+    }
+}
+
+uint64_t MetadataStore::commit(Transaction&& tx)
+{
+    assert(0 <= log_fd_);
+
+    std::call_once(started_, [this] { flusher_ = std::jthread{[this](std::stop_token stoken) { flush(std::move(stoken)); }}; });
+
+    assert(tx.buf_.size() <= std::numeric_limits<uint32_t>::max());
+    FrameHeader const header{.size = static_cast<uint32_t>(tx.buf_.size()), .crc = crc32(tx.buf_)};
+
+    std::lock_guard g{mtx_};
+    if (tx.empty())
+        return committed_;
+
+    pending_.append(reinterpret_cast<char const*>(&header), sizeof(header));
+    pending_.append(tx.buf_);
+    log_size_ += sizeof(header) + tx.buf_.size();
+    pending_cv_.notify_one();
+
+    return ++committed_;
+}
+
+int MetadataStore::sync(uint64_t lsn)
+{
+    std::unique_lock lk{mtx_};
+    assert(lsn <= committed_);
+    durable_cv_.wait(lk, [=, this] { return lsn <= durable_; });
+    return error_;
+}
+
+int MetadataStore::sync()
+{
+    std::unique_lock lk{mtx_};
+    auto const lsn = committed_;
+    lk.unlock();
+    return sync(lsn);
+}
+
+bool MetadataStore::checkpoint_due()
+{
+    std::lock_guard g{mtx_};
+    return !checkpointing_ && kCheckpointLogSize <= log_size_;
+}
+
+int MetadataStore::rotate(std::unique_lock<std::mutex>& lk)
+{
+    // the segment is closed once the flusher has written everything committed to it, the flusher is idle then
+    durable_cv_.wait(lk, [this] { return committed_ == durable_; });
+
+    auto const seq = log_seq_ + 1;
+    auto const fd  = ::open((dir_ / segment_name(seq)).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -errno;
+    if (auto const r = sync_dir(dir_)) {
+        ::close(fd);
+        return r;
+    }
+
+    ::close(log_fd_);
+    log_fd_   = fd;
+    log_seq_  = seq;
+    log_size_ = 0;
+
+    return 0;
+}
+
+int MetadataStore::write_checkpoint(uint64_t log_seq, uint64_t next_ino, std::string const& state)
+{
+    auto const tmp = dir_ / kCheckpointTmpName;
+
+    auto const fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -errno;
+
+    CheckpointHeader const header{
+        .magic = kCheckpointMagic, .version = kCheckpointVersion, .reserved = 0, .next_ino = next_ino, .log_seq = log_seq, .size = state.size()};
+    auto r = write_all(fd, {reinterpret_cast<char const*>(&header), sizeof(header)});
+    if (!r)
+        r = write_all(fd, state);
+    if (!r && ::fsync(fd))
+        r = -errno;
+    ::close(fd);
+
+    // the checkpoint replaces the previous one at once, so that there is always a complete one to load
+    if (!r && ::rename(tmp.c_str(), (dir_ / kCheckpointName).c_str()))
+        r = -errno;
+    if (!r)
+        r = sync_dir(dir_);
+    if (r) {
+        ::unlink(tmp.c_str());
+        return r;
+    }
+
+    // the segments covered by the checkpoint are not needed anymore
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator{dir_, ec}) {
+        if (auto const seq = segment_seq(entry.path().filename().native()); seq && *seq < log_seq)
+            std::filesystem::remove(entry.path(), ec);
+    }
+
+    return 0;
+}
+
+int MetadataStore::checkpoint(uint64_t next_ino, std::function<void(Transaction&)> const& snapshot, bool wait)
+{
+    uint64_t seq{0};
+    {
+        // a checkpoint being written is waited for if this one is to be, otherwise this one is left to the next time it is due
+        std::unique_lock lk{mtx_};
+        if (checkpointing_ && !wait)
+            return 0;
+        durable_cv_.wait(lk, [this] { return !checkpointing_; });
+
+        // the transactions committed from now on go to the new segment, the ones the snapshot may miss are replayed over it
+        if (auto const r = rotate(lk))
+            return r;
+        checkpointing_ = true;
+        seq            = log_seq_;
+    }
+
+    Transaction tx;
+    snapshot(tx);
+
+    auto write = [self = shared_from_this(), seq, next_ino, state = std::move(tx.buf_)] {
+        auto const r = self->write_checkpoint(seq, next_ino, state);
+        std::lock_guard g{self->mtx_};
+        self->checkpointing_ = false;
+        self->durable_cv_.notify_all();
+        return r;
+    };
+
+    if (wait)
+        return write();
+
+    boost::asio::post(detached_io_pool(), std::move(write));
+    return 0;
+}
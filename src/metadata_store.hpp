@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "metadata_record.hpp"
+#include "metadata_replayer_interface.hpp"
+
+namespace multifs
+{
+
+// Keeps the namespace and the chunk maps of a file system in a directory of its own, so that they survive remounting without scanning
+// the backends. Changes are committed as transactions appended to a log, the transactions committed meanwhile are written and synced
+// at once by a flusher thread. The log is compacted into a checkpoint every now and then, a checkpoint is a flat image of the whole state
+// mapped into memory and decoded in place on loading, only the log written past it is replayed then
+class MetadataStore final : public std::enable_shared_from_this<MetadataStore>
+{
+public:
+    static constexpr size_t kCheckpointLogSize{64 * 1024 * 1024}; ///< Size of the log a checkpoint is due at
+
+    // Records committed at once, either all of them survive a crash or none of them does
+    class Transaction
+    {
+    private:
+        friend class MetadataStore;
+
+        std::string buf_;                   ///< Records encoded
+        std::vector<std::string> backends_; ///< Names of the backends the chunk records refer to by their indices
+
+        template <typename T>
+        void put(T const& value);
+        void put(std::string_view str);
+        uint32_t backend(std::string_view name);
+
+    public:
+        void inode(InodeRecord const& record);
+        void chunk(ChunkRecord const& record);
+        void chunks(uint64_t ino, size_t count);
+        void link(std::string_view name, uint64_t ino);
+        void unlink(std::string_view name);
+
+        [[nodiscard]] bool empty() const noexcept { return buf_.empty(); }
+    };
+
+private:
+    std::filesystem::path dir_;
+    int log_fd_{-1};         ///< Segment of the log the transactions are appended to
+    uint64_t log_seq_{0};    ///< Sequence number of the segment appended to, the segments are replayed in their order
+    size_t log_size_{0};     ///< Number of bytes appended to the segment
+    uint64_t next_ino_{1};   ///< Number following the largest inode number loaded
+    std::once_flag started_; ///< Makes the flusher be started on the first commit, threads do not survive the process being forked
+
+    std::mutex mtx_;
+    std::condition_variable_any pending_cv_; ///< Wakes the flusher up once transactions are committed
+    std::condition_variable durable_cv_;     ///< Wakes the waiters up once transactions are synced or a checkpoint is written
+    std::string pending_;                    ///< Transactions committed and not written yet
+    uint64_t committed_{0};                  ///< Number of transactions committed
+    uint64_t durable_{0};                    ///< Number of transactions written and synced
+    int error_{0};                           ///< Error the log has failed to be written with, it sticks
+    bool checkpointing_{false};              ///< Set while a checkpoint is being written
+    std::jthread flusher_;                   ///< Declared last to be stopped before the rest is destroyed
+
+    void flush(std::stop_token stoken);
+    int rotate(std::unique_lock<std::mutex>& lk);
+    int write_checkpoint(uint64_t log_seq, uint64_t next_ino, std::string const& state);
+    void replay(std::span<char const> payload, IMetadataReplayer& replayer);
+
+public:
+    explicit MetadataStore(std::filesystem::path dir);
+    ~MetadataStore();
+
+    MetadataStore(MetadataStore const&)            = delete;
+    MetadataStore& operator=(MetadataStore const&) = delete;
+
+    MetadataStore(MetadataStore&&)            = delete;
+    MetadataStore& operator=(MetadataStore&&) = delete;
+
+    // Tells whether nothing has been kept in the directory yet
+    [[nodiscard]] bool empty() const;
+    // Moves the checkpoint and the log aside, so that the store starts out empty, the way out once they are found damaged by loading
+    void discard();
+
+    // Replays the checkpoint and the log written past it and opens a new segment of the log to append to, it is to be done once
+    // before anything is committed. Returns the inode number to be given to the next inode created
+    uint64_t load(IMetadataReplayer& replayer);
+
+    // Queues the transaction to be written to the log, returns its sequence number, the one to wait for it to get durable by
+    uint64_t commit(Transaction&& tx);
+    // Waits for the transaction of the sequence number given and all the ones committed before it to get durable
+    int sync(uint64_t lsn);
+    // Waits for all the transactions committed to get durable
+    int sync();
+
+    // Tells whether the log has grown enough to be compacted into a checkpoint
+    [[nodiscard]] bool checkpoint_due();
+    // Compacts the log into a checkpoint of the state the snapshot function records, the caller keeps the state from changing but by
+    // transactions committed concurrently, which are replayed over the checkpoint anyway. The checkpoint is written in the background
+    // unless waited for, the segments of the log it covers are deleted then
+    int checkpoint(uint64_t next_ino, std::function<void(Transaction&)> const& snapshot, bool wait = false);
+};
+
+} // namespace multifs
@@ -0,0 +1,36 @@
+#include "mount_point.hpp"
+
+#include <list>
+#include <stdexcept>
+#include <string>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/constants.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+namespace multifs
+{
+
+mount_point parse_mount_point(std::string_view svmp)
+{
+    std::list<std::string> tokens;
+    boost::split(tokens, svmp, boost::is_any_of(","), boost::token_compress_on);
+
+    mount_point mp{.path = tokens.front()};
+    tokens.pop_front();
+
+    for (std::string_view token : tokens) {
+        if (token.starts_with("bw="))
+            mp.bandwidth = std::stoul(std::string{token.substr(3)});
+        else if ("tier=fast" == token)
+            mp.tier = Tier::kFast;
+        else if ("tier=slow" == token)
+            mp.tier = Tier::kSlow;
+        else
+            throw std::invalid_argument("unknown option '" + std::string{token} + "' of mount point " + mp.path.string());
+    }
+
+    return mp;
+}
+
+} // namespace multifs
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+#include <filesystem>
+#include <string_view>
+
+#include "backend.hpp"
+
+namespace multifs
+{
+
+struct mount_point {
+    std::filesystem::path path;
+    size_t bandwidth{1};     ///< Relative bandwidth, the weighted round-robin placement relies on
+    Tier tier{Tier::kFast}; ///< Storage tier
+};
+
+// Parses a mount point given as '<path>[,bw=<n>][,tier=fast|slow]', throws std::invalid_argument if it is malformed
+mount_point parse_mount_point(std::string_view svmp);
+
+} // namespace multifs
@@ -9,15 +9,32 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef HAVE_SETXATTR
+#include <sys/xattr.h>
+#endif
 
 #include <algorithm>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <ranges>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "caller.hpp"
+#include "erasure_code.hpp"
+#include "file_system_reflector.hpp"
+#include "handle.hpp"
+#include "io_pool.hpp"
 #include "inode/chmodder.hpp"
 #include "inode/chowner.hpp"
 #include "inode/fsyncer.hpp"
@@ -29,12 +46,20 @@
 #include "inode/truncater.hpp"
 #include "inode/unlinker.hpp"
 #include "inode/writer.hpp"
+#include "metadata_replayer_interface.hpp"
+#include "metadata_scanner.hpp"
 #ifdef HAVE_UTIMENSAT
 #include "inode/utimenser.hpp"
 #endif
 #ifdef HAVE_POSIX_FALLOCATE
 #include "inode/fallocater.hpp"
 #endif
+#ifdef HAVE_SETXATTR
+#include "inode/xattr_getter.hpp"
+#include "inode/xattr_setter.hpp"
+#endif
+#include "mount_point.hpp"
+#include "scope_exit.hpp"
 #include "utilities.hpp"
 
 using namespace multifs;
@@ -46,13 +71,186 @@ inode::Unlinker __unlinker__;
 
 // constexpr unsigned long kFUSESuperMagic = 0x65735546;
 constexpr decltype(statvfs::f_bsize) kBlockSize = 4 * 1024UL;
-constexpr decltype(statvfs::f_namemax) kMaxName = 255;
+constexpr decltype(statvfs::f_namemax) kMaxName = NameArena::kMaxSize;
 // constexpr unsigned long kMaxBlocks      = 1024 * 1024UL;
 // constexpr unsigned long kMaxInode       = 1024 * 1024UL;
 constexpr decltype(statvfs::f_fsid) kFSID = 0x0123456789098765;
 
+constexpr uint64_t kRootIno{0}; ///< Number the root directory is known by in the metadata store
+// Inode numbers reported are the numbers the inodes are known by shifted, so that the root directory is reported as inode 1, the one
+// FUSE knows it by, and none of the inodes is reported as inode 0
+constexpr ino_t kInoOffset{1};
+
+// Returns the name of the entry the path refers to within its directory
+std::string_view leaf(std::string_view path) noexcept { return path.substr(path.rfind('/') + 1); }
+
+// Tells whether the directory is the one given or resides anywhere beneath it
+bool within(Directory const& dir, Directory const& ancestor) noexcept
+{
+    for (auto const* d = &dir; d; d = d->parent())
+        if (&ancestor == d)
+            return true;
+    return false;
+}
+
+// Fills the attributes of the inode in, the way both getattr and readdir report them
+void attributes(std::shared_ptr<INode> const& inode, struct stat& stbuf) noexcept
+{
+    std::memset(&stbuf, 0, sizeof(struct stat));
+
+    std::visit(
+        [&stbuf](auto const& item) {
+            using T = std::decay_t<decltype(item)>;
+
+            stbuf.st_ino = item.ino() + kInoOffset;
+            if constexpr (std::is_same_v<T, File>) {
+                auto const& fdesc = item.desc();
+                stbuf.st_nlink    = item.nlink();
+                stbuf.st_size     = fdesc.size;
+                stbuf.st_mode     = fdesc.mode;
+                stbuf.st_uid      = fdesc.owner_uid;
+                stbuf.st_gid      = fdesc.owner_gid;
+                stbuf.st_atim     = fdesc.atime;
+                stbuf.st_mtim     = fdesc.mtime;
+                stbuf.st_ctim     = fdesc.ctime;
+            } else if constexpr (std::is_same_v<T, Symlink>) {
+                stbuf.st_size     = item.target().string().size();
+                stbuf.st_nlink    = item.nlink();
+                auto const& ldesc = item.desc();
+                stbuf.st_mode     = ldesc.mode;
+                stbuf.st_uid      = ldesc.owner_uid;
+                stbuf.st_gid      = ldesc.owner_gid;
+                stbuf.st_atim     = ldesc.atime;
+                stbuf.st_mtim     = ldesc.mtime;
+                stbuf.st_ctim     = ldesc.ctime;
+            } else if constexpr (std::is_same_v<T, Directory>) {
+                auto const& ddesc = item.desc();
+                stbuf.st_nlink    = item.nlink();
+                stbuf.st_mode     = ddesc.mode;
+                stbuf.st_uid      = ddesc.owner_uid;
+                stbuf.st_gid      = ddesc.owner_gid;
+                stbuf.st_atim     = ddesc.atime;
+                stbuf.st_mtim     = ddesc.mtime;
+                stbuf.st_ctim     = ddesc.ctime;
+            } else {
+                static_assert(dependent_false_v<T>, "unhandled type");
+            }
+        },
+        *inode);
+}
+
 } // anonymous namespace
 
+// Rebuilds the namespace out of the records replayed by the metadata store, the inodes left without links by the end are dropped
+class MultiFileSystem::Loader final : public IMetadataReplayer
+{
+private:
+    MultiFileSystem& mfs_;
+    std::unordered_map<uint64_t, std::shared_ptr<INode>> inodes_;
+    std::unordered_map<std::string_view, std::shared_ptr<Backend>> backends_; ///< Backends by their names, the names are owned by the backends
+    std::vector<std::shared_ptr<Backend>> replicas_;
+    std::unordered_map<uint64_t, InodeRecord> dirs_; ///< Last records of the directories, their entries get linked past them
+
+    File* file(uint64_t ino) const
+    {
+        auto const it = inodes_.find(ino);
+        return inodes_.end() == it ? nullptr : std::get_if<File>(it->second.get());
+    }
+
+public:
+    explicit Loader(MultiFileSystem& mfs)
+        : mfs_(mfs)
+    {
+        inodes_.emplace(kRootIno, mfs_.root_);
+
+        // the chunks refer to the backends by their names
+        for (auto const& backend : mfs_.placement_->backends()) {
+            if (!backends_.emplace(backend->name(), backend).second)
+                throw std::invalid_argument("backends must be of distinct names to keep metadata");
+        }
+    }
+
+    void inode(InodeRecord const& record) override
+    {
+        auto& inode = inodes_[record.ino];
+        if (InodeRecord::Kind::kSymlink == record.kind) {
+            inode = std::make_shared<INode>(std::in_place_type<Symlink>, record);
+        } else if (InodeRecord::Kind::kDirectory == record.kind) {
+            // the entries of a directory are kept as its attributes get updated
+            if (auto* dir = inode ? std::get_if<Directory>(inode.get()) : nullptr)
+                dir->restore(record);
+            else
+                inode = std::make_shared<INode>(std::in_place_type<Directory>, record, mfs_.names_);
+            dirs_.insert_or_assign(record.ino, record);
+        } else if (auto* file = inode ? std::get_if<File>(inode.get()) : nullptr) {
+            file->restore(record);
+        } else {
+            inode = std::make_shared<INode>(std::in_place_type<File>, record, mfs_.placement_);
+        }
+    }
+
+    void chunk(ChunkRecord const& record) override
+    {
+        auto* file = this->file(record.ino);
+        if (!file)
+            return;
+
+        replicas_.clear();
+        for (auto const name : record.backends) {
+            auto const it = backends_.find(name);
+            if (backends_.end() == it)
+                throw std::invalid_argument("metadata refers to backend '" + std::string{name} + "', which is not given");
+            replicas_.push_back(it->second);
+        }
+        file->restore_chunk(record.chunk_idx, record.offset_range, replicas_);
+    }
+
+    void chunks(uint64_t ino, size_t count) override
+    {
+        if (auto* file = this->file(ino))
+            file->restore_chunks(count);
+    }
+
+    void link(std::string_view name, uint64_t ino) override
+    {
+        auto const it = inodes_.find(ino);
+        if (inodes_.end() == it)
+            return;
+        if (auto* dir = mfs_.parent(name))
+            dir->assign(leaf(name), it->second);
+    }
+
+    void unlink(std::string_view name) override
+    {
+        if (auto* dir = mfs_.parent(name))
+            dir->erase(leaf(name));
+    }
+
+    // Hands the files linked over to the file system, the chunks of the rest are discarded, as those were unlinked while still open
+    void finish()
+    {
+        // linking the entries touches the directories, the times they are restored with are the ones recorded
+        for (auto const& [ino, record] : dirs_) {
+            if (auto* dir = std::get_if<Directory>(inodes_[ino].get()))
+                dir->restore(record);
+        }
+        dirs_.clear();
+
+        for (auto& [_, inode] : inodes_) {
+            auto* file = std::get_if<File>(inode.get());
+            if (!file)
+                continue;
+            if (1 == inode.use_count()) {
+                file->unlink();
+                continue;
+            }
+            file->attach(mfs_.store_, file->ino());
+            mfs_.files_->add(std::shared_ptr<File>{inode, file});
+        }
+        inodes_.clear();
+    }
+};
+
 void MultiFileSystem::statvs_init() noexcept
 {
     statvfs_ = {
@@ -72,50 +270,289 @@ void MultiFileSystem::statvs_init() noexcept
     };
 }
 
-int MultiFileSystem::getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* /*fi*/) const
+void MultiFileSystem::layout_init()
 {
-    assert(!path.empty());
+    if (0 == layout_.copies || layout_.copies > placement_->size())
+        throw std::invalid_argument("number of copies must be in between one and the number of file systems");
 
-    std::memset(&stbuf, 0, sizeof(struct stat));
+    if (layout_.chunk_size && 0 != layout_.chunk_size % placement_->block_size())
+        throw std::invalid_argument("chunk size must be a multiple of the block size of file systems");
+
+    if (!layout_.striped()) {
+        if (layout_.parity)
+            throw std::invalid_argument("parity requires files to be striped");
+        return;
+    }
+
+    if (0 == layout_.stripe_unit)
+        throw std::invalid_argument("stripe unit must not be zero");
+
+    if (layout_.parity > ErasureCode::kMaxParity)
+        throw std::invalid_argument("number of parity chunks must not exceed " + std::to_string(ErasureCode::kMaxParity));
+
+    if (layout_.parity >= placement_->size())
+        throw std::invalid_argument("number of parity chunks must be less than the number of file systems");
+
+    if (0 == layout_.stripe_width)
+        layout_.stripe_width = placement_->size() - layout_.parity;
+    else if (layout_.stripe_chunks() > placement_->size())
+        throw std::invalid_argument("stripe width along with parity must not exceed the number of file systems");
+
+    if (layout_.chunk_size && 0 != layout_.chunk_size % layout_.stripe_unit)
+        throw std::invalid_argument("chunk size must be a multiple of the stripe unit");
+}
+
+void MultiFileSystem::tiering_init()
+{
+    if (TierMigrator::applicable(*placement_))
+        tier_migrator_ = std::make_unique<TierMigrator>(placement_, files_, TierMigrator::Config{});
+}
+
+void MultiFileSystem::rebalancing_init() { rebalancer_ = std::make_unique<Rebalancer>(placement_, files_, Rebalancer::Config{}); }
+
+void MultiFileSystem::reaping_start() const
+{
+    for (auto const& backend : placement_->backends())
+        backend->reclaim();
+}
+
+MultiFileSystem::~MultiFileSystem()
+{
+    // the log is compacted on unmounting, so that the next mount loads the checkpoint alone
+    if (store_)
+        checkpoint(true);
+}
+
+std::shared_ptr<INode> const* MultiFileSystem::lookup(std::string_view path) const noexcept
+{
+    auto const* inode = &root_;
+    for (auto rest = path; !rest.empty();) {
+        auto const slash = rest.find('/');
+        auto const name  = rest.substr(0, slash);
+        rest             = std::string_view::npos == slash ? std::string_view{} : rest.substr(slash + 1);
+        if (name.empty() || "." == name)
+            continue;
+
+        auto const* dir = std::get_if<Directory>(inode->get());
+        if (!dir || !(inode = dir->find(name)))
+            return nullptr;
+    }
+    return inode;
+}
+
+std::shared_ptr<INode> const* MultiFileSystem::lookup(std::string_view path, struct fuse_file_info const* fi) const noexcept
+{
+    auto const* h = handle(fi);
+    return h ? h : lookup(path);
+}
+
+Directory* MultiFileSystem::parent(std::string_view path) const noexcept
+{
+    auto const* inode = lookup(path.substr(0, path.rfind('/') + 1));
+    return inode ? std::get_if<Directory>(inode->get()) : nullptr;
+}
+
+bool MultiFileSystem::linked(Directory const& dir) const noexcept { return dir.parent() || std::get_if<Directory>(root_.get()) == &dir; }
+
+std::string MultiFileSystem::path_of(Directory const& dir, std::string_view name) const
+{
+    std::vector<std::string_view> names{name};
+    for (auto const* d = &dir; d->parent(); d = d->parent())
+        names.push_back(d->name());
+
+    std::string path;
+    for (auto const n : names | std::views::reverse) {
+        path += '/';
+        path += n;
+    }
+    return path;
+}
+
+uint64_t MultiFileSystem::ino(INode const& inode) noexcept
+{
+    return std::visit([](auto const& item) { return item.ino(); }, inode);
+}
+
+void MultiFileSystem::journal(MetadataStore::Transaction&& tx)
+{
+    if (!store_)
+        return;
+
+    store_->commit(std::move(tx));
+    if (store_->checkpoint_due())
+        checkpoint(false);
+}
+
+void MultiFileSystem::journal(INode const& inode)
+{
+    if (!store_)
+        return;
 
-    if (path == "/") {
-        stbuf.st_uid   = owner_uid_;
-        stbuf.st_gid   = owner_gid_;
-        stbuf.st_mode  = S_IFDIR | 0755;
-        stbuf.st_nlink = 2;
-        stbuf.st_ctime = stbuf.st_atime = stbuf.st_mtime = std::time(NULL);
-    } else if (auto const it = inodes_.find(path); inodes_.end() != it) {
-        stbuf.st_nlink = it->second.use_count();
-        std::visit(
-            [&stbuf](auto const& item) {
-                using T = std::decay_t<decltype(item)>;
-                if constexpr (std::is_same_v<T, File>) {
-                    auto const& fdesc = item.desc();
-                    stbuf.st_size     = fdesc.size;
-                    stbuf.st_mode     = fdesc.mode;
-                    stbuf.st_uid      = fdesc.owner_uid;
-                    stbuf.st_gid      = fdesc.owner_gid;
-                    stbuf.st_atim     = fdesc.atime;
-                    stbuf.st_mtim     = fdesc.mtime;
-                    stbuf.st_ctim     = fdesc.ctime;
-                } else if constexpr (std::is_same_v<T, Symlink>) {
-                    stbuf.st_size     = item.target().string().size();
-                    auto const& ldesc = item.desc();
-                    stbuf.st_mode     = ldesc.mode;
-                    stbuf.st_uid      = ldesc.owner_uid;
-                    stbuf.st_gid      = ldesc.owner_gid;
-                    stbuf.st_atim     = ldesc.atime;
-                    stbuf.st_mtim     = ldesc.mtime;
-                    stbuf.st_ctim     = ldesc.ctime;
-                } else {
-                    static_assert(dependent_false_v<T>, "unhandled type");
+    MetadataStore::Transaction tx;
+    tx.inode(std::visit([](auto const& item) { return item.record(); }, inode));
+    journal(std::move(tx));
+}
+
+void MultiFileSystem::attributes_propagate(std::shared_ptr<INode> const& inode)
+{
+    auto* file = std::get_if<File>(inode.get());
+    if (!file || !file->attributes_schedule())
+        return;
+
+    // the changes made meanwhile are brought along, the file removed meanwhile is left alone
+    boost::asio::post(attributes_pool(), [file = std::weak_ptr<File>{std::shared_ptr<File>{inode, file}}] {
+        if (auto const f = file.lock())
+            f->attributes_sync();
+    });
+}
+
+int MultiFileSystem::checkpoint(bool wait)
+{
+    // the namespace is held by the caller while it is recorded, the chunk maps may be changed by the background workers meanwhile,
+    // the changes are committed to the log past the checkpoint then
+    return store_->checkpoint(
+        next_ino_,
+        [this](MetadataStore::Transaction& tx) {
+            auto const& root = std::get<Directory>(*root_);
+            tx.inode(root.record());
+
+            // every directory is linked ahead of its entries
+            std::unordered_set<INode const*> recorded;
+            std::vector<std::pair<std::string, Directory const*>> dirs{{std::string{}, &root}};
+            while (!dirs.empty()) {
+                auto const [dir_path, dir] = std::move(dirs.back());
+                dirs.pop_back();
+                for (auto const& [name, inode, _] : dir->entries()) {
+                    // an inode of several links is recorded ahead of the first of them
+                    if (1 == inode.use_count() || recorded.insert(inode.get()).second) {
+                        std::visit(
+                            [&tx](auto const& item) {
+                                if constexpr (std::is_same_v<std::decay_t<decltype(item)>, File>)
+                                    item.snapshot(tx);
+                                else
+                                    tx.inode(item.record());
+                            },
+                            *inode);
+                    }
+                    auto path = dir_path + '/' + name.c_str();
+                    tx.link(path, ino(*inode));
+                    if (auto const* subdir = std::get_if<Directory>(inode.get()))
+                        dirs.emplace_back(std::move(path), subdir);
                 }
-            },
-            *it->second);
-    } else {
-        return -ENOENT;
+            }
+        },
+        wait);
+}
+
+void MultiFileSystem::metadata(std::shared_ptr<MetadataStore> store)
+{
+    if (!store)
+        throw std::invalid_argument("metadata store cannot be empty");
+
+    store_ = std::move(store);
+
+    // a file system kept in no metadata so far or in metadata found damaged is rebuilt out of the chunk files residing on the backends,
+    // the state rebuilt is checkpointed right away to not be rebuilt again by the next mount
+    auto rebuild = store_->empty();
+    std::optional<Loader> loader{std::in_place, *this};
+    try {
+        next_ino_ = store_->load(*loader);
+    } catch (std::system_error const&) {
+        throw;
+    } catch (std::runtime_error const&) {
+        root_ = std::make_shared<INode>(std::in_place_type<Directory>, names_, S_IFDIR | 0755, owner_uid_, owner_gid_);
+        store_->discard();
+        loader.emplace(*this);
+        next_ino_ = store_->load(*loader);
+        rebuild   = true;
     }
 
+    if (rebuild)
+        next_ino_ = MetadataScanner{layout_, zero_block_}.scan(placement_->backends(), *loader, next_ino_);
+    loader->finish();
+
+    if (rebuild) {
+        if (auto const r = checkpoint(true))
+            throw std::system_error(-r, std::generic_category(), "failed to checkpoint metadata rebuilt");
+    }
+}
+
+void MultiFileSystem::chunk_pool(ChunkPool::Config const& config)
+{
+    pool_config_ = config;
+    for (auto const& backend : placement_->backends())
+        backend->pool_enable(config);
+}
+
+int MultiFileSystem::backend_add(std::string_view svmp)
+{
+    mount_point mp;
+    try {
+        mp = parse_mount_point(svmp);
+    } catch (std::exception const&) {
+        return -EINVAL;
+    }
+
+    // the daemon runs in the root directory, so a relative path would be ambiguous
+    if (!mp.path.is_absolute())
+        return -EINVAL;
+    mp.path = mp.path.lexically_normal();
+
+    if (std::error_code ec; !std::filesystem::is_directory(mp.path, ec))
+        return ec ? -ec.value() : -ENOTDIR;
+
+    auto backend = std::make_shared<Backend>(std::make_shared<FileSystemReflector>(mp.path), mp.bandwidth, mp.tier, mp.path.string());
+    if (layout_.chunk_size && 0 != layout_.chunk_size % backend->block_size())
+        return -EINVAL;
+    backend->pool_enable(pool_config_);
+
+    if (!placement_->add(std::move(backend)))
+        return -EEXIST;
+
+    if (!tier_migrator_)
+        tiering_init();
+    if (tier_migrator_)
+        tier_migrator_->start();
+
+    // the backend gets its share of chunks moved in rather than waiting for the next pass
+    rebalancer_->start();
+    rebalancer_->wake();
+
+    return 0;
+}
+
+int MultiFileSystem::backend_drain(std::string_view name)
+{
+    auto const backend = placement_->find(name);
+    if (!backend)
+        return -ENOENT;
+    if (backend->draining())
+        return 0;
+
+    // there have to be enough backends left to hold the copies and the stripes of the chunks
+    auto const left = std::ranges::count_if(placement_->backends(), [](auto const& b) { return !b->draining(); }) - 1;
+    if (static_cast<size_t>(left) < std::max(layout_.copies, layout_.striped() ? layout_.stripe_chunks() : size_t{1}))
+        return -ENOSPC;
+
+    backend->drain();
+
+    // the backend is removed once the rebalancer has moved all the chunks off it
+    rebalancer_->start();
+    rebalancer_->wake();
+
+    return 0;
+}
+
+int MultiFileSystem::getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* fi) const
+{
+    assert(fi || !path.empty());
+
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
+        return -ENOENT;
+
+    attributes(*inode, stbuf);
+
     return 0;
 }
 
@@ -123,36 +560,123 @@ int MultiFileSystem::readlink(std::filesystem::path const& path, std::span<char>
 {
     assert(!path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native());
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::LinkReader{buf}, *it->second);
+    return readlink(*inode, buf);
 }
 
+int MultiFileSystem::readlink(std::shared_ptr<INode> const& inode, std::span<char> buf) const { return std::visit(inode::LinkReader{buf}, *inode); }
+
 int MultiFileSystem::mknod(std::filesystem::path const& path [[maybe_unused]], mode_t mode [[maybe_unused]], dev_t rdev [[maybe_unused]])
 {
     // TODO(Denis Pronin <dannftk@yandex.ru>): implement the function
     return -EINVAL;
 }
 
-int MultiFileSystem::mkdir(std::filesystem::path const& path [[maybe_unused]], mode_t mode [[maybe_unused]])
+int MultiFileSystem::mkdir(std::filesystem::path const& path, mode_t mode)
 {
-    // TODO(Denis Pronin <dannftk@yandex.ru>): implement the function
-    return -EINVAL;
+    assert(!path.empty());
+
+    auto* dir = parent(path.native());
+    if (!dir)
+        return -ENOENT;
+
+    return mkdir(*dir, leaf(path.native()), mode);
 }
 
-int MultiFileSystem::rmdir(std::filesystem::path const& path [[maybe_unused]])
+int MultiFileSystem::mkdir(Directory& dir, std::string_view name, mode_t mode)
 {
-    // TODO(Denis Pronin <dannftk@yandex.ru>): implement the function
-    return -EINVAL;
+    if (!linked(dir))
+        return -ENOENT;
+    if (name.size() > kMaxName)
+        return -ENAMETOOLONG;
+
+    auto const [uid, gid] = caller();
+    auto const inode      = std::make_shared<INode>(std::in_place_type<Directory>, names_, mode, uid, gid, next_ino_);
+    if (!dir.insert(name, inode))
+        return -EEXIST;
+    ++next_ino_;
+
+    if (store_) {
+        MetadataStore::Transaction tx;
+        tx.inode(std::get<Directory>(*inode).record());
+        tx.link(path_of(dir, name), ino(*inode));
+        tx.inode(dir.record());
+        journal(std::move(tx));
+    }
+
+    return 0;
+}
+
+int MultiFileSystem::rmdir(std::filesystem::path const& path)
+{
+    assert(!path.empty());
+
+    auto* dir = parent(path.native());
+    if (!dir)
+        return -ENOENT;
+
+    return rmdir(*dir, leaf(path.native()));
+}
+
+int MultiFileSystem::rmdir(Directory& dir, std::string_view name)
+{
+    if (name.empty())
+        return -EBUSY;
+
+    auto const* inode = dir.find(name);
+    if (!inode)
+        return -ENOENT;
+    auto const* target = std::get_if<Directory>(inode->get());
+    if (!target)
+        return -ENOTDIR;
+    if (!target->empty())
+        return -ENOTEMPTY;
+
+    MetadataStore::Transaction tx;
+    if (store_)
+        tx.unlink(path_of(dir, name));
+    dir.erase(name);
+    tx.inode(dir.record());
+    journal(std::move(tx));
+
+    return 0;
 }
 
 int MultiFileSystem::symlink(std::filesystem::path const& from, std::filesystem::path const& to)
 {
     assert(!to.empty());
 
-    return inodes_.emplace(to, std::make_shared<INode>(Symlink{from})).second ? 0 : -EEXIST;
+    auto* dir = parent(to.native());
+    if (!dir)
+        return -ENOENT;
+
+    return symlink(from, *dir, leaf(to.native()));
+}
+
+int MultiFileSystem::symlink(std::filesystem::path const& from, Directory& dir, std::string_view name)
+{
+    if (!linked(dir))
+        return -ENOENT;
+    if (name.size() > kMaxName)
+        return -ENAMETOOLONG;
+
+    auto const inode = std::make_shared<INode>(Symlink{from, next_ino_});
+    if (!dir.insert(name, inode))
+        return -EEXIST;
+    ++next_ino_;
+
+    if (store_) {
+        MetadataStore::Transaction tx;
+        tx.inode(std::get<Symlink>(*inode).record());
+        tx.link(path_of(dir, name), ino(*inode));
+        tx.inode(dir.record());
+        journal(std::move(tx));
+    }
+
+    return 0;
 }
 
 int MultiFileSystem::rename(std::filesystem::path const& from, std::filesystem::path const& to, unsigned int flags)
@@ -160,29 +684,81 @@ int MultiFileSystem::rename(std::filesystem::path const& from, std::filesystem::
     assert(!from.empty());
     assert(!to.empty());
 
-    auto from_it = inodes_.find(from);
-    if (inodes_.end() == from_it)
+    auto* from_dir = parent(from.native());
+    auto* to_dir   = parent(to.native());
+    if (!from_dir || !to_dir)
         return -ENOENT;
 
-    if (auto to_it = inodes_.find(to); flags & RENAME_NOREPLACE) {
-        if (inodes_.end() != to_it)
-            return -EEXIST;
-        auto node  = inodes_.extract(from_it);
-        node.key() = to;
-        inodes_.insert(std::move(node));
-    } else if (flags & RENAME_EXCHANGE) {
-        if (inodes_.end() == to_it)
+    return rename(*from_dir, leaf(from.native()), *to_dir, leaf(to.native()), flags);
+}
+
+int MultiFileSystem::rename(Directory& from_dir, std::string_view from_name, Directory& to_dir, std::string_view to_name, unsigned int flags)
+{
+    if (from_name.empty() || to_name.empty())
+        return -EBUSY;
+    if (!linked(to_dir))
+        return -ENOENT;
+    if (to_name.size() > kMaxName)
+        return -ENAMETOOLONG;
+
+    auto const* from_entry = from_dir.find(from_name);
+    if (!from_entry)
+        return -ENOENT;
+    auto const* to_entry = to_dir.find(to_name);
+
+    auto const source = *from_entry;
+    auto const target = to_entry ? *to_entry : nullptr;
+
+    // a directory cannot be moved beneath itself, a directory moved takes its entries along by being moved as a single entry
+    if (auto const* dir = std::get_if<Directory>(source.get()); source != target && dir && within(to_dir, *dir))
+        return -EINVAL;
+
+    // the paths are journaled as they were before the entries are moved
+    std::string from_path;
+    std::string to_path;
+    if (store_) {
+        from_path = path_of(from_dir, from_name);
+        to_path   = path_of(to_dir, to_name);
+    }
+
+    MetadataStore::Transaction tx;
+    std::shared_ptr<INode> replaced;
+    if (flags & RENAME_EXCHANGE) {
+        if (!target)
             return -ENOENT;
-        using std::swap;
-        swap(from_it->second, to_it->second);
-    } else if (inodes_.end() != to_it) {
-        to_it->second = std::move(from_it->second);
-        inodes_.erase(from_it);
+        if (source == target)
+            return 0;
+        if (auto const* dir = std::get_if<Directory>(target.get()); dir && within(from_dir, *dir))
+            return -EINVAL;
+        from_dir.assign(from_name, target);
+        to_dir.assign(to_name, source);
+        tx.link(from_path, ino(*target));
+        tx.link(to_path, ino(*source));
     } else {
-        inodes_.emplace_hint(to_it, to, std::move(from_it->second));
+        if (target) {
+            if (flags & RENAME_NOREPLACE)
+                return -EEXIST;
+            // links of the same file are left as they are, whereas the inode replaced is unlinked the way it would be on its own
+            if (source == target)
+                return 0;
+            auto const* target_dir = std::get_if<Directory>(target.get());
+            if (std::holds_alternative<Directory>(*source) != (nullptr != target_dir))
+                return target_dir ? -EISDIR : -ENOTDIR;
+            if (target_dir && !target_dir->empty())
+                return -ENOTEMPTY;
+        }
+        from_dir.erase(from_name);
+        replaced = to_dir.assign(to_name, source);
+        tx.link(to_path, ino(*source));
+        tx.unlink(from_path);
     }
 
-    return 0;
+    tx.inode(from_dir.record());
+    if (&to_dir != &from_dir)
+        tx.inode(to_dir.record());
+    journal(std::move(tx));
+
+    return replaced ? std::visit(__unlinker__, *replaced) : 0;
 }
 
 int MultiFileSystem::link(std::filesystem::path const& from, std::filesystem::path const& to)
@@ -190,134 +766,294 @@ int MultiFileSystem::link(std::filesystem::path const& from, std::filesystem::pa
     assert(!from.empty());
     assert(!to.empty());
 
-    auto from_it = inodes_.find(from);
-    if (inodes_.end() == from_it)
+    auto const* source = lookup(from.native());
+    if (!source)
         return -ENOENT;
 
-    return inodes_.emplace(to, from_it->second).second ? 0 : -EEXIST;
+    // the inode is held on its own, as linking it may move the entries of the directory it is looked up in
+    auto const inode = *source;
+    return link(inode, to);
+}
+
+int MultiFileSystem::link(std::shared_ptr<INode> const& inode, std::filesystem::path const& to)
+{
+    assert(inode);
+    assert(!to.empty());
+
+    auto* dir = parent(to.native());
+    if (!dir)
+        return std::holds_alternative<Directory>(*inode) ? -EPERM : -ENOENT;
+
+    return link(inode, *dir, leaf(to.native()));
 }
 
-int MultiFileSystem::access(std::filesystem::path const& path, int mask) const
+int MultiFileSystem::link(std::shared_ptr<INode> const& inode, Directory& dir, std::string_view name)
+{
+    assert(inode);
+
+    if (std::holds_alternative<Directory>(*inode))
+        return -EPERM;
+    if (!linked(dir))
+        return -ENOENT;
+    if (name.size() > kMaxName)
+        return -ENAMETOOLONG;
+
+    if (!dir.insert(name, inode))
+        return -EEXIST;
+
+    if (store_) {
+        MetadataStore::Transaction tx;
+        tx.link(path_of(dir, name), ino(*inode));
+        tx.inode(dir.record());
+        journal(std::move(tx));
+    }
+
+    return 0;
+}
+
+int MultiFileSystem::access(std::filesystem::path const& path, int /*mask*/) const
 {
     assert(!path.empty());
 
-    if (path == "/" || path == "/." || path == "/.." || inodes_.count(path))
-        return 0;
+    return lookup(path.native()) ? 0 : -ENOENT;
+}
+
+int MultiFileSystem::opendir(std::filesystem::path const& path, struct fuse_file_info* fi)
+{
+    assert(!path.empty());
+    assert(fi);
+
+    auto const* inode = lookup(path.native());
+    if (!inode)
+        return -ENOENT;
 
-    return -ENOENT;
+    return opendir(*inode, fi);
+}
+
+int MultiFileSystem::opendir(std::shared_ptr<INode> const& inode, struct fuse_file_info* fi)
+{
+    assert(inode);
+    assert(fi);
+
+    if (!std::holds_alternative<Directory>(*inode))
+        return -ENOTDIR;
+
+    handle_open(fi, std::make_unique<Handle>(inode));
+
+    return 0;
 }
 
 int MultiFileSystem::readdir(
-    std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t /*offset*/, struct fuse_file_info* /*fi*/, fuse_readdir_flags /*flags*/) const
+    std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
     assert(buf);
 
-    if (path != "/")
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
+    auto const* dir = std::get_if<Directory>(inode->get());
+    if (!dir)
+        return -ENOTDIR;
 
-    filler(buf, ".", NULL, 0, static_cast<fuse_fill_dir_flags>(0));
-    filler(buf, "..", NULL, 0, static_cast<fuse_fill_dir_flags>(0));
+    // every entry is filled along with its offset, so a listing interrupted by a full buffer is resumed past the entry filled last
+    // rather than restarted, and along with its attributes, so the listing is not followed by a lookup of every entry
+    if (offset < 1 && filler(buf, ".", NULL, 1, static_cast<fuse_fill_dir_flags>(0)))
+        return 0;
+    if (offset < 2 && filler(buf, "..", NULL, 2, static_cast<fuse_fill_dir_flags>(0)))
+        return 0;
 
-    for (auto const& [path, _] : inodes_) {
-        auto name = std::string_view{path};
-        name.remove_prefix(1);
-        filler(buf, name.data(), NULL, 0, static_cast<fuse_fill_dir_flags>(0));
+    auto const fill_flags = (flags & FUSE_READDIR_PLUS) ? FUSE_FILL_DIR_PLUS : static_cast<fuse_fill_dir_flags>(0);
+    struct stat stbuf;
+    for (auto const& entry : dir->entries(offset)) {
+        attributes(entry.inode, stbuf);
+        if (filler(buf, entry.name.c_str(), &stbuf, entry.cookie, fill_flags))
+            break;
     }
 
     return 0;
 }
 
+int MultiFileSystem::releasedir(std::filesystem::path const& path [[maybe_unused]], struct fuse_file_info* fi)
+{
+    assert(fi);
+
+    handle_close(fi);
+
+    return 0;
+}
+
 int MultiFileSystem::unlink(std::filesystem::path const& path)
 {
     assert(!path.empty());
 
-    if (path == "/" || path == "/." || path == "/..")
+    auto* dir = parent(path.native());
+    if (!dir)
+        return -ENOENT;
+
+    return unlink(*dir, leaf(path.native()));
+}
+
+int MultiFileSystem::unlink(Directory& dir, std::string_view name)
+{
+    if (name.empty())
         return -EBUSY;
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = dir.find(name);
+    if (!inode)
         return -ENOENT;
+    if (std::holds_alternative<Directory>(**inode))
+        return -EISDIR;
 
-    auto const inode = std::move(it->second);
-    inodes_.erase(it);
+    MetadataStore::Transaction tx;
+    if (store_)
+        tx.unlink(path_of(dir, name));
+    auto const unlinked = dir.erase(name);
+    tx.inode(dir.record());
+    journal(std::move(tx));
 
-    return std::visit(__unlinker__, *inode);
+    return std::visit(__unlinker__, *unlinked);
 }
 
 int MultiFileSystem::chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Chmodder{mode, fi}, *it->second);
+    if (auto const r = std::visit(inode::Chmodder{mode, fi}, **inode))
+        return r;
+    journal(**inode);
+    attributes_propagate(*inode);
+
+    return 0;
 }
 
 int MultiFileSystem::chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Chowner{uid, gid, fi}, *it->second);
+    if (auto const r = std::visit(inode::Chowner{uid, gid, fi}, **inode))
+        return r;
+    journal(**inode);
+    attributes_propagate(*inode);
+
+    return 0;
 }
 
 int MultiFileSystem::truncate(std::filesystem::path const& path, off_t size, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Truncater{size, fi}, *it->second);
+    if (auto const r = std::visit(inode::Truncater{size, fi}, **inode))
+        return r;
+    journal(**inode);
+
+    return 0;
 }
 
 int MultiFileSystem::open(std::filesystem::path const& path, struct fuse_file_info* fi)
 {
     assert(!path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native());
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Opener{fi}, *it->second);
+    return open(*inode, fi);
+}
+
+int MultiFileSystem::open(std::shared_ptr<INode> const& inode, struct fuse_file_info* fi)
+{
+    assert(inode);
+
+    auto h = std::make_unique<Handle>(inode);
+    if (auto const r = std::visit(inode::Opener{fi}, *inode))
+        return r;
+    handle_open(fi, std::move(h));
+
+    return 0;
 }
 
 int MultiFileSystem::create(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi)
 {
     assert(!path.empty());
 
-    return inodes_.emplace(path, std::make_shared<INode>(File{std::string{path} + ".chunk", mode, fss_.begin(), fss_.end(), fi})).second ? 0 : -EEXIST;
+    auto* dir = parent(path.native());
+    if (!dir)
+        return -ENOENT;
+
+    return create(*dir, leaf(path.native()), mode, fi);
+}
+
+int MultiFileSystem::create(Directory& dir, std::string_view name, mode_t mode, struct fuse_file_info* fi)
+{
+    if (!linked(dir))
+        return -ENOENT;
+    if (name.size() > kMaxName)
+        return -ENAMETOOLONG;
+
+    auto h         = std::make_unique<Handle>();
+    auto const ino = next_ino_;
+    auto inode     = std::make_shared<INode>(std::in_place_type<File>, chunk_base(salt_, ino), mode, layout_, placement_, fi);
+    if (!dir.insert(name, inode))
+        return -EEXIST;
+    ++next_ino_;
+    *h = inode;
+    handle_open(fi, std::move(h));
+
+    auto& file = std::get<File>(*inode);
+    file.zero_blocks(zero_block_);
+    file.attach(store_, ino);
+    if (store_) {
+        MetadataStore::Transaction tx;
+        file.snapshot(tx);
+        tx.link(path_of(dir, name), file.ino());
+        tx.inode(dir.record());
+        journal(std::move(tx));
+    }
+
+    files_->add(std::shared_ptr<File>{inode, &std::get<File>(*inode)});
+    if (tier_migrator_)
+        tier_migrator_->start();
+    rebalancer_->start();
+    reaping_start();
+
+    return 0;
 }
 
 ssize_t MultiFileSystem::read(std::filesystem::path const& path, std::span<std::byte> buf, off_t offset, struct fuse_file_info* fi) const
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
     assert(!buf.empty());
 
-    auto const it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Reader{std::as_writable_bytes(buf), offset, fi}, *it->second);
+    return std::visit(inode::Reader{std::as_writable_bytes(buf), offset, fi}, **inode);
 }
 
 ssize_t MultiFileSystem::write(std::filesystem::path const& path, std::span<std::byte const> buf, off_t offset, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
     assert(!buf.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Writer{std::as_bytes(buf), offset, fi}, *it->second);
+    return std::visit(inode::Writer{std::as_bytes(buf), offset, fi}, **inode);
 }
 
 int MultiFileSystem::statfs(std::filesystem::path const& path, struct statvfs& stbuf) const
@@ -326,13 +1062,19 @@ int MultiFileSystem::statfs(std::filesystem::path const& path, struct statvfs& s
 
     stbuf = statvfs_;
 
-    for (auto const& fs : fss_) {
+    // the space of the files deleted by the previous run shows up as the backends get them unlinked
+    reaping_start();
+
+    for (auto const& fs : placement_->backends()) {
         // clang-format off
         struct statvfs stbuf_leaf {};
         // clang-format on
         if (auto const res = fs->statfs(path, stbuf_leaf))
             return res;
         stbuf.f_blocks += stbuf_leaf.f_blocks * stbuf_leaf.f_bsize / stbuf.f_bsize;
+        // the space of draining backends is not going to take new chunks
+        if (fs->draining())
+            continue;
         stbuf.f_bfree += stbuf_leaf.f_bfree * stbuf_leaf.f_bsize / stbuf.f_bsize;
         stbuf.f_bavail += stbuf_leaf.f_bavail * stbuf_leaf.f_bsize / stbuf.f_bsize;
         stbuf.f_files += stbuf_leaf.f_files;
@@ -345,59 +1087,190 @@ int MultiFileSystem::statfs(std::filesystem::path const& path, struct statvfs& s
 
 int MultiFileSystem::release(std::filesystem::path const& path, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
+    scope_exit const closing{[fi] { handle_close(fi); }};
+
+    if (auto const r = std::visit(inode::Releaser{fi}, **inode))
+        return r;
+    // the size a file has grown to by writing is committed once the handle writing it is closed
+    if (fi && O_RDONLY != (fi->flags & O_ACCMODE))
+        journal(**inode);
 
-    return std::visit(inode::Releaser{fi}, *it->second);
+    return 0;
 }
 
 int MultiFileSystem::fsync(std::filesystem::path const& path, int isdatasync, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Fsyncer{isdatasync, fi}, *it->second);
+    if (auto const r = std::visit(inode::Fsyncer{isdatasync, fi}, **inode))
+        return r;
+    journal(**inode);
+
+    // the size the file has grown to by writing is made durable along with the data
+    return store_ ? store_->sync() : 0;
 }
 
 #ifdef HAVE_UTIMENSAT
 int MultiFileSystem::utimens(std::filesystem::path const& path, const struct timespec ts[2], struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(INodeUtimenser{ts, fi}, *it->second);
+    if (auto const r = std::visit(inode::Utimenser{ts, fi}, **inode))
+        return r;
+    journal(**inode);
+    attributes_propagate(*inode);
+
+    return 0;
 }
 #endif // HAVE_UTIMENSAT
 
 #ifdef HAVE_POSIX_FALLOCATE
 int MultiFileSystem::fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi)
 {
-    assert(!path.empty());
+    assert(fi || !path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(INodeFallocater{mode, offset, length, fi}, *it->second);
+    if (auto const r = std::visit(inode::Fallocater{mode, offset, length, fi}, **inode))
+        return r;
+    journal(**inode);
+
+    return 0;
 }
 #endif // HAVE_POSIX_FALLOCATE
 
-off_t MultiFileSystem::lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const
+#ifdef HAVE_SETXATTR
+int MultiFileSystem::control_setxattr(std::string_view name, std::span<char const> value, int flags)
+{
+    if (flags & XATTR_CREATE)
+        return -EEXIST;
+
+    if ("user.multifs.backends.add" == name)
+        return backend_add({value.data(), value.size()});
+    if ("user.multifs.backends.drain" == name)
+        return backend_drain({value.data(), value.size()});
+
+    if ("user.multifs.rebalance.rate" == name) {
+        auto const rate = xattr_parse(value);
+        if (!rate)
+            return -EINVAL;
+        rebalancer_->rate(*rate);
+        return 0;
+    }
+
+    if ("user.multifs.backends" == name || name.starts_with("user.multifs.rebalance."))
+        return -EPERM;
+
+    return -ENOTSUP;
+}
+
+int MultiFileSystem::control_getxattr(std::string_view name, std::span<char> value) const
+{
+    // every backend is listed on a line in the format of the mount points given on the command line
+    if ("user.multifs.backends" == name) {
+        std::string backends;
+        for (auto const& backend : placement_->backends()) {
+            backends += backend->name() + ",bw=" + std::to_string(backend->bandwidth());
+            backends += Tier::kSlow == backend->tier() ? ",tier=slow" : ",tier=fast";
+            backends += backend->draining() ? ",draining\n" : "\n";
+        }
+        return xattr_format(backends, value);
+    }
+
+    auto const progress = rebalancer_->progress();
+
+    if ("user.multifs.rebalance.rate" == name)
+        return xattr_format(rebalancer_->rate(), value);
+    if ("user.multifs.rebalance.passes" == name)
+        return xattr_format(progress.passes, value);
+    if ("user.multifs.rebalance.moved_chunks" == name)
+        return xattr_format(progress.moved_chunks, value);
+    if ("user.multifs.rebalance.moved_bytes" == name)
+        return xattr_format(progress.moved_bytes, value);
+    if ("user.multifs.rebalance.pending_bytes" == name)
+        return xattr_format(progress.pending_bytes, value);
+
+    // the chunk files left out of date with the attributes of their files, the attributes are kept by the metadata regardless
+    if ("user.multifs.attributes.failed_syncs" == name)
+        return xattr_format(File::attributes_failures(), value);
+
+    // the files deleted whose space is yet to be freed by the backends
+    if ("user.multifs.reclaim.pending_files" == name) {
+        size_t pending{0};
+        for (auto const& backend : placement_->backends())
+            pending += backend->reclaim_pending();
+        return xattr_format(pending, value);
+    }
+
+    return -ENODATA;
+}
+
+int MultiFileSystem::setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags)
+{
+    assert(!path.empty());
+
+    auto const* inode = lookup(path.native());
+    if (!inode)
+        return -ENOENT;
+
+    return setxattr(*inode, name, value, flags);
+}
+
+int MultiFileSystem::setxattr(std::shared_ptr<INode> const& inode, std::string_view name, std::span<char const> value, int flags)
+{
+    assert(inode);
+
+    if (inode == root_)
+        return control_setxattr(name, value, flags);
+
+    if (auto const r = std::visit(inode::XattrSetter{name, value, flags}, *inode))
+        return r;
+    journal(*inode);
+
+    return 0;
+}
+
+int MultiFileSystem::getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const
 {
     assert(!path.empty());
 
-    auto it = inodes_.find(path);
-    if (inodes_.end() == it)
+    auto const* inode = lookup(path.native());
+    if (!inode)
+        return -ENOENT;
+
+    return getxattr(*inode, name, value);
+}
+
+int MultiFileSystem::getxattr(std::shared_ptr<INode> const& inode, std::string_view name, std::span<char> value) const
+{
+    assert(inode);
+
+    return inode == root_ ? control_getxattr(name, value) : std::visit(inode::XattrGetter{name, value}, *inode);
+}
+#endif // HAVE_SETXATTR
+
+off_t MultiFileSystem::lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const
+{
+    assert(fi || !path.empty());
+
+    auto const* inode = lookup(path.native(), fi);
+    if (!inode)
         return -ENOENT;
 
-    return std::visit(inode::Lseeker{off, whence, fi}, *it->second);
+    return std::visit(inode::Lseeker{off, whence, fi}, **inode);
 }
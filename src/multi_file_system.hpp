@@ -5,14 +5,29 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-#include <list>
+#include <filesystem>
 #include <memory>
-#include <unordered_map>
+#include <span>
+#include <string>
+#include <string_view>
 #include <utility>
-#include <variant>
+#include <vector>
 
+#include "backend.hpp"
+#include "chunk_name.hpp"
+#include "chunk_pool.hpp"
+#include "directory.hpp"
 #include "file.hpp"
+#include "file_registry.hpp"
+#include "inode.hpp"
+#include "layout.hpp"
+#include "metadata_store.hpp"
+#include "name_arena.hpp"
+#include "placement.hpp"
+#include "placement_policy_interface.hpp"
+#include "rebalancer.hpp"
 #include "symlink.hpp"
+#include "tier_migrator.hpp"
 
 namespace multifs
 {
@@ -22,32 +37,86 @@ class MultiFileSystem final : public IFileSystem
 private:
     uid_t owner_uid_;
     gid_t owner_gid_;
-    std::list<std::shared_ptr<IFileSystem>> fss_;
-
-    using INode = std::variant<File, Symlink>;
-    std::unordered_map<std::string, std::shared_ptr<INode>> inodes_;
+    std::shared_ptr<Placement> placement_;
+    Layout layout_;
+
+    std::shared_ptr<NameArena> names_; ///< Names of the entries of all the directories
+    std::shared_ptr<INode> root_;      ///< Root directory of the namespace
+    std::shared_ptr<FileRegistry> files_{std::make_shared<FileRegistry>()};
+    std::unique_ptr<TierMigrator> tier_migrator_;
+    std::unique_ptr<Rebalancer> rebalancer_;
+    ChunkPool::Config pool_config_;        ///< Pool of chunk files of the backends added later on
+    size_t zero_block_{0};                 ///< Size of the blocks of zeros left holes in files created, 0 disables it
+    std::shared_ptr<MetadataStore> store_; ///< Store the namespace is kept in, none if it is kept in memory only
+    uint64_t next_ino_{1};                 ///< Number given to the next inode created
+    uint64_t salt_{chunk_salt()};          ///< Salt of the IDs of the files created, the chunks of a file are named by its ID
 
     struct statvfs statvfs_;
 
+    class Loader;
+
     void statvs_init() noexcept;
+    void layout_init();
+    void tiering_init();
+    void rebalancing_init();
+    // Makes the backends delete the files left to be deleted by the previous run, it is deferred until the file system is in use,
+    // as the process is forked on daemonizing and threads do not survive it
+    void reaping_start() const;
+
+    // Looks the inode up by its path, null if there is none. The pointer is valid until the directory holding the inode is changed
+    std::shared_ptr<INode> const* lookup(std::string_view path) const noexcept;
+    // Looks the inode up by the handle it is open by if there is one, the path is not looked up then and may be empty
+    std::shared_ptr<INode> const* lookup(std::string_view path, struct fuse_file_info const* fi) const noexcept;
+    // Looks the directory up the path resides in, null if there is none
+    Directory* parent(std::string_view path) const noexcept;
+    // Tells whether the directory is linked in the namespace, the directories removed are not to be changed anymore
+    bool linked(Directory const& dir) const noexcept;
+    // Returns the path of the entry of the name in the directory, the changes of the namespace are journaled by the paths
+    std::string path_of(Directory const& dir, std::string_view name) const;
+
+    static uint64_t ino(INode const& inode) noexcept;
+    // Commits the changes of the namespace to the metadata store if there is one, the log is compacted into a checkpoint once it is due
+    void journal(MetadataStore::Transaction&& tx);
+    void journal(INode const& inode);
+    // Brings the chunk files of a file up to date with the attributes changed in the background, the metadata is authoritative for them
+    static void attributes_propagate(std::shared_ptr<INode> const& inode);
+    int checkpoint(bool wait);
+
+    // Adds a backend given as a mount point on the command line to the live file system
+    int backend_add(std::string_view svmp);
+    // Makes the chunks be moved off the backend, which is removed once it holds none
+    int backend_drain(std::string_view name);
+
+#ifdef HAVE_SETXATTR
+    // Extended attributes of the root directory make up the control interface of the file system
+    int control_setxattr(std::string_view name, std::span<char const> value, int flags);
+    int control_getxattr(std::string_view name, std::span<char> value) const;
+#endif // HAVE_SETXATTR
 
 public:
     template <typename InputIt>
-    explicit MultiFileSystem(uid_t owner_uid, gid_t owner_gid, InputIt begin, InputIt end)
+    explicit MultiFileSystem(uid_t owner_uid, gid_t owner_gid, Layout layout, std::unique_ptr<IPlacementPolicy> policy, InputIt begin, InputIt end)
         : owner_uid_(owner_uid)
         , owner_gid_(owner_gid)
-        , fss_(begin, end)
+        , placement_(std::make_shared<Placement>(std::vector<std::shared_ptr<Backend>>(begin, end), std::move(policy)))
+        , layout_(layout)
+        , names_(std::make_shared<NameArena>())
+        , root_(std::make_shared<INode>(std::in_place_type<Directory>, names_, S_IFDIR | 0755, owner_uid, owner_gid))
     {
         statvs_init();
+        layout_init();
+        tiering_init();
+        rebalancing_init();
     }
 
     template <typename Range>
-    explicit MultiFileSystem(uid_t owner_uid, gid_t owner_gid, Range&& range)
-        : MultiFileSystem(owner_uid, owner_gid, std::begin(std::forward<Range>(range)), std::end(std::forward<Range>(range)))
+    explicit MultiFileSystem(uid_t owner_uid, gid_t owner_gid, Layout layout, std::unique_ptr<IPlacementPolicy> policy, Range&& range)
+        : MultiFileSystem(
+              owner_uid, owner_gid, layout, std::move(policy), std::begin(std::forward<Range>(range)), std::end(std::forward<Range>(range)))
     {
     }
 
-    ~MultiFileSystem() override = default;
+    ~MultiFileSystem() override;
 
     MultiFileSystem(MultiFileSystem const&)            = delete;
     MultiFileSystem& operator=(MultiFileSystem const&) = delete;
@@ -55,6 +124,40 @@ public:
     MultiFileSystem(MultiFileSystem&&) noexcept            = default;
     MultiFileSystem& operator=(MultiFileSystem&&) noexcept = default;
 
+    [[nodiscard]] Rebalancer& rebalancer() noexcept { return *rebalancer_; }
+
+    // Makes every backend keep a pool of chunk files created ahead, it is to be done before the file system is used
+    void chunk_pool(ChunkPool::Config const& config);
+
+    // Makes the namespace be kept in the metadata store given, the namespace kept in it is loaded, the backends its chunks reside on are
+    // to be known by the same names as they were. The namespace is rebuilt by scanning the backends if the store is empty or damaged.
+    // It is to be done before the file system is used
+    void metadata(std::shared_ptr<MetadataStore> store);
+
+    // Makes the files created leave the blocks of the size given written with zeros only holes, 0 disables it
+    void zero_blocks(size_t block_size) noexcept { zero_block_ = block_size; }
+
+    // The requests addressing inodes rather than paths, for the frontends keeping the inodes they refer to. The rest of the requests
+    // take the inodes as handles, see handle_of()
+    [[nodiscard]] std::shared_ptr<INode> const& root() const noexcept { return root_; }
+    int readlink(std::shared_ptr<INode> const& inode, std::span<char> buf) const;
+    int link(std::shared_ptr<INode> const& inode, std::filesystem::path const& to);
+    int link(std::shared_ptr<INode> const& inode, Directory& dir, std::string_view name);
+    int open(std::shared_ptr<INode> const& inode, struct fuse_file_info* fi);
+    int opendir(std::shared_ptr<INode> const& inode, struct fuse_file_info* fi);
+#ifdef HAVE_SETXATTR
+    int setxattr(std::shared_ptr<INode> const& inode, std::string_view name, std::span<char const> value, int flags);
+    int getxattr(std::shared_ptr<INode> const& inode, std::string_view name, std::span<char> value) const;
+#endif // HAVE_SETXATTR
+    // The changes of the namespace addressing the entries by the directories they reside in and their names, so that the paths are
+    // not looked up. The directory is to be linked in the namespace, the directories removed meanwhile are reported as missing
+    int mkdir(Directory& dir, std::string_view name, mode_t mode);
+    int rmdir(Directory& dir, std::string_view name);
+    int symlink(std::filesystem::path const& from, Directory& dir, std::string_view name);
+    int rename(Directory& from_dir, std::string_view from_name, Directory& to_dir, std::string_view to_name, unsigned int flags);
+    int unlink(Directory& dir, std::string_view name);
+    int create(Directory& dir, std::string_view name, mode_t mode, struct fuse_file_info* fi);
+
     int getattr(std::filesystem::path const& path, struct stat& stbuf, struct fuse_file_info* fi) const override;
     int readlink(std::filesystem::path const& path, std::span<char>) const override;
     int mknod(std::filesystem::path const& path, mode_t mode, dev_t rdev) override;
@@ -64,8 +167,10 @@ public:
     int rename(std::filesystem::path const& from, std::filesystem::path const& to, unsigned int flags) override;
     int link(std::filesystem::path const& from, std::filesystem::path const& to) override;
     int access(std::filesystem::path const& path, int mask) const override;
+    int opendir(std::filesystem::path const& path, struct fuse_file_info* fi) override;
     int readdir(
         std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const override;
+    int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi) override;
     int unlink(std::filesystem::path const& path) override;
     int chmod(std::filesystem::path const& path, mode_t mode, struct fuse_file_info* fi) override;
     int chown(std::filesystem::path const& path, uid_t uid, gid_t gid, struct fuse_file_info* fi) override;
@@ -83,6 +188,10 @@ public:
 #ifdef HAVE_POSIX_FALLOCATE
     int fallocate(std::filesystem::path const& path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) override;
 #endif // HAVE_POSIX_FALLOCATE
+#ifdef HAVE_SETXATTR
+    int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) override;
+    int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const override;
+#endif // HAVE_SETXATTR
     off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const override;
 };
 
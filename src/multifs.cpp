@@ -7,7 +7,10 @@
 #include <iostream>
 #include <memory>
 #include <ranges>
+#include <stdexcept>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include <unistd.h>
 
@@ -15,11 +18,18 @@
 
 #include "boost/lockfree/detail/prefix.hpp"
 
+#include "backend.hpp"
 #include "file_system_interface.hpp"
 #include "file_system_noexcept.hpp"
 #include "file_system_reflector.hpp"
 #include "logged_file_system.hpp"
+#include "low_level_frontend.hpp"
+#include "metadata_store.hpp"
 #include "multi_file_system.hpp"
+#include "placement/least_latency.hpp"
+#include "placement/most_free_space.hpp"
+#include "placement/spread_writers.hpp"
+#include "placement/weighted_round_robin.hpp"
 #include "thread_safe_access_file_system.hpp"
 
 namespace multifs
@@ -36,6 +46,34 @@ void show_help(std::string_view progname)
     std::cout << "Multi File-system specific options:\n"
               << "    --fss=<path1>:<path2>:<path3>:...    paths to mount points to "
                  "combine them within the multifs\n"
+              << "                                         a path may be followed by "
+                 "',bw=<n>', the relative bandwidth of the mount point\n"
+              << "                                         and by ',tier=fast' (default) or "
+                 "',tier=slow', cold chunks are moved to the slow tier\n"
+              << "    --stripe-unit=<size>                 stripe files over mount points "
+                 "by units of the size given (K, M, G suffixes are allowed)\n"
+              << "    --stripe-width=<n>                   number of mount points a file "
+                 "is striped over, all of them but parity ones by default\n"
+              << "    --chunk-size=<size>                  maximum size of a chunk, a multiple "
+                 "of the block size of mount points, unbounded by default\n"
+              << "    --copies=<n>                         number of copies of every chunk "
+                 "kept on distinct mount points, 1 by default\n"
+              << "    --parity=<n>                         number of parity chunks protecting "
+                 "every stripe, 1 (RAID-5) or 2 (RAID-6), none by default\n"
+              << "    --placement=<policy>                 policy of placing new chunks: "
+                 "most-free-space (default), round-robin, least-latency, spread-writers\n"
+              << "    --rebalance-rate=<size>              bytes per second chunks are moved "
+                 "at to balance mount points, 64M by default, 0 disables it\n"
+              << "    --chunk-pool=<n>                     number of chunk files created ahead "
+                 "on every mount point, 4 by default, 0 disables it\n"
+              << "    --chunk-prealloc=<size>              space allocated ahead for every chunk "
+                 "file created ahead, none by default\n"
+              << "    --zero-blocks=<size>                 blocks of the size given written with "
+                 "zeros only are left holes, disabled by default\n"
+              << "    --metadata=<path>                    directory the namespace is kept in "
+                 "across mounts, it is kept in memory only by default\n"
+              << "    --low-level                          serve the requests over the low-level "
+                 "API of FUSE, by inodes rather than by paths\n"
 #ifndef NDEBUG
               << "    --log=<path>                         path to a file where multifs "
                  "will log operations\n"
@@ -46,21 +84,48 @@ void show_help(std::string_view progname)
 
 auto make_absolute_normal(std::filesystem::path const& path) { return std::filesystem::absolute(path).lexically_normal(); }
 
+std::unique_ptr<IPlacementPolicy> make_placement_policy(PlacementPolicyKind kind)
+{
+    switch (kind) {
+        case PlacementPolicyKind::kMostFreeSpace:
+            return std::make_unique<placement::MostFreeSpace>();
+        case PlacementPolicyKind::kWeightedRoundRobin:
+            return std::make_unique<placement::WeightedRoundRobin>();
+        case PlacementPolicyKind::kLeastLatency:
+            return std::make_unique<placement::LeastLatency>();
+        case PlacementPolicyKind::kSpreadWriters:
+            return std::make_unique<placement::SpreadWriters>();
+    }
+    throw std::invalid_argument("unknown placement policy");
+}
+
+std::unique_ptr<MultiFileSystem> make_mfs(app_params const& params)
+{
+    std::vector<std::shared_ptr<Backend>> backends;
+    std::ranges::transform(params.mpts, std::back_inserter(backends), [](auto const& mp) {
+        auto const path = make_absolute_normal(mp.path);
+        return std::make_shared<Backend>(std::make_unique<FileSystemReflector>(path), mp.bandwidth, mp.tier, path.string());
+    });
+    auto mfs = std::make_unique<MultiFileSystem>(getuid(), getgid(), params.layout, make_placement_policy(params.placement), backends);
+    mfs->rebalancer().rate(params.rebalance_rate);
+    mfs->chunk_pool({.depth = params.chunk_pool, .prealloc = params.chunk_prealloc});
+    mfs->zero_blocks(params.zero_block);
+    if (!params.metadata.empty())
+        mfs->metadata(std::make_shared<MetadataStore>(make_absolute_normal(params.metadata)));
+    return mfs;
+}
+
 std::unique_ptr<IFileSystem> make_bfs(app_params const& params)
 {
     std::unique_ptr<IFileSystem> fs;
-    std::list<std::unique_ptr<IFileSystem>> fss;
-    std::ranges::transform(params.mpts, std::back_inserter(fss), [](auto const& mp) {
-        return std::make_unique<FileSystemReflector>(make_absolute_normal(mp));
-    });
 
     bool log_enabled{false};
     bool need_thread_safety{false};
 
     if (1 == params.mpts.size()) {
-        fs = std::move(fss.front());
+        fs = std::make_unique<FileSystemReflector>(make_absolute_normal(params.mpts.front().path));
     } else {
-        fs                 = std::make_unique<MultiFileSystem>(getuid(), getgid(), std::make_move_iterator(fss.begin()), std::make_move_iterator(fss.end()));
+        fs                 = make_mfs(params);
         need_thread_safety = true;
     }
 
@@ -104,11 +169,14 @@ auto* fs_noexcept_ptr() noexcept { return to_fs_noexcept_ptr(fuse_private_data_p
 
 auto& fs_noexcept_ref() noexcept { return *fs_noexcept_ptr(); }
 
+// The requests on handles come with no path, as it is not computed for them
+std::string_view nullable(char const* path) noexcept { return path ? std::string_view{path} : std::string_view{}; }
+
 int getattr(char const* path, struct stat* stbuf, struct fuse_file_info* fi) noexcept
 {
     assert(stbuf);
 
-    return fs_noexcept_ref().getattr(path, *stbuf, fi);
+    return fs_noexcept_ref().getattr(nullable(path), *stbuf, fi);
 }
 
 int readlink(char const* path, char* buf, size_t size) noexcept { return fs_noexcept_ref().readlink(path, {buf, size}); }
@@ -127,22 +195,22 @@ int rename(char const* from, char const* to, unsigned int flags) noexcept { retu
 
 int link(char const* from, char const* to) noexcept { return fs_noexcept_ref().link(from, to); }
 
-int chmod(char const* path, mode_t mode, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().chmod(path, mode, fi); }
+int chmod(char const* path, mode_t mode, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().chmod(nullable(path), mode, fi); }
 
-int chown(char const* path, uid_t uid, gid_t gid, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().chown(path, uid, gid, fi); }
+int chown(char const* path, uid_t uid, gid_t gid, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().chown(nullable(path), uid, gid, fi); }
 
-int truncate(char const* path, off_t size, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().truncate(path, size, fi); }
+int truncate(char const* path, off_t size, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().truncate(nullable(path), size, fi); }
 
 int open(char const* path, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().open(path, fi); }
 
 int read(char const* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi) noexcept
 {
-    return static_cast<int>(fs_noexcept_ref().read(path, {reinterpret_cast<std::byte*>(buf), size}, offset, fi));
+    return static_cast<int>(fs_noexcept_ref().read(nullable(path), {reinterpret_cast<std::byte*>(buf), size}, offset, fi));
 }
 
 int write(char const* path, char const* buf, size_t size, off_t offset, struct fuse_file_info* fi) noexcept
 {
-    return static_cast<int>(fs_noexcept_ref().write(path, {reinterpret_cast<std::byte const*>(buf), size}, offset, fi));
+    return static_cast<int>(fs_noexcept_ref().write(nullable(path), {reinterpret_cast<std::byte const*>(buf), size}, offset, fi));
 }
 
 int statfs(char const* path, struct statvfs* stbuf) noexcept
@@ -152,18 +220,32 @@ int statfs(char const* path, struct statvfs* stbuf) noexcept
     return fs_noexcept_ref().statfs(path, *stbuf);
 }
 
-int release(char const* path, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().release(path, fi); }
+int release(char const* path, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().release(nullable(path), fi); }
 
-int fsync(char const* path, int isdatasync, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().fsync(path, isdatasync, fi); }
+int fsync(char const* path, int isdatasync, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().fsync(nullable(path), isdatasync, fi); }
+
+int opendir(char const* path, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().opendir(path, fi); }
 
 int readdir(char const* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) noexcept
 {
-    return fs_noexcept_ref().readdir(path, buf, filler, offset, fi, flags);
+    return fs_noexcept_ref().readdir(nullable(path), buf, filler, offset, fi, flags);
 }
 
+int releasedir(char const* path, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().releasedir(nullable(path), fi); }
+
 void* init(struct fuse_conn_info* conn, struct fuse_config* cfg) noexcept
 {
     cfg->kernel_cache = 1;
+    // the requests on handles get to the files by the handles, so FUSE is spared computing their paths
+    cfg->nullpath_ok = 1;
+    // the inodes are reported by the numbers multifs knows them by rather than the ones FUSE makes up, as the low-level frontend does
+    cfg->use_ino = 1;
+
+    // the attributes of the entries are listed along with them at no extra cost, so they are listed always
+    if (conn->capable & FUSE_CAP_READDIRPLUS) {
+        conn->want |= FUSE_CAP_READDIRPLUS;
+        conn->want &= ~FUSE_CAP_READDIRPLUS_AUTO;
+    }
 
     return fs_noexcept_ptr();
 }
@@ -175,56 +257,65 @@ int access(char const* path, int mask) noexcept { return fs_noexcept_ref().acces
 int create(char const* path, mode_t mode, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().create(path, mode, fi); }
 
 #ifdef HAVE_UTIMENSAT
-int utimens(char const* path, const struct timespec tv[2], struct fuse_file_info* fi) noexcept { return get_fs().utimens(path, tv, fi); }
+int utimens(char const* path, const struct timespec tv[2], struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().utimens(nullable(path), tv, fi); }
 #endif // HAVE_UTIMENSAT
 
 #ifdef HAVE_POSIX_FALLOCATE
 int fallocate(char const* path, int mode, off_t offset, off_t length, struct fuse_file_info* fi) noexcept
 {
-    return get_fs().fallocate(path, mode, offset, length, fi);
+    return fs_noexcept_ref().fallocate(nullable(path), mode, offset, length, fi);
 }
 #endif // HAVE_POSIX_FALLOCATE
 
-off_t lseek(char const* path, off_t off, int whence, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().lseek(path, off, whence, fi); }
+#ifdef HAVE_SETXATTR
+int setxattr(char const* path, char const* name, char const* value, size_t size, int flags) noexcept
+{
+    return fs_noexcept_ref().setxattr(path, name, {value, size}, flags);
+}
+
+int getxattr(char const* path, char const* name, char* value, size_t size) noexcept { return fs_noexcept_ref().getxattr(path, name, {value, size}); }
+#endif // HAVE_SETXATTR
+
+off_t lseek(char const* path, off_t off, int whence, struct fuse_file_info* fi) noexcept { return fs_noexcept_ref().lseek(nullable(path), off, whence, fi); }
 
 fuse_operations const& getops() noexcept
 {
     static fuse_operations const ops = {
-        .getattr  = getattr,
-        .readlink = readlink,
-        .mknod    = mknod,
-        .mkdir    = mkdir,
-        .unlink   = unlink,
-        .rmdir    = rmdir,
-        .symlink  = symlink,
-        .rename   = rename,
-        .link     = link,
-        .chmod    = chmod,
-        .chown    = chown,
-        .truncate = truncate,
-        .open     = open,
-        .read     = read,
-        .write    = write,
-        .statfs   = statfs,
-        .release  = release,
-        .fsync    = fsync,
-        .readdir  = readdir,
-        .init     = init,
-        .destroy  = destroy,
-        .access   = access,
-        .create   = create,
+        .getattr    = getattr,
+        .readlink   = readlink,
+        .mknod      = mknod,
+        .mkdir      = mkdir,
+        .unlink     = unlink,
+        .rmdir      = rmdir,
+        .symlink    = symlink,
+        .rename     = rename,
+        .link       = link,
+        .chmod      = chmod,
+        .chown      = chown,
+        .truncate   = truncate,
+        .open       = open,
+        .read       = read,
+        .write      = write,
+        .statfs     = statfs,
+        .release    = release,
+        .fsync      = fsync,
+#ifdef HAVE_SETXATTR
+        .setxattr   = setxattr,
+        .getxattr   = getxattr,
+#endif
+        .opendir    = opendir,
+        .readdir    = readdir,
+        .releasedir = releasedir,
+        .init       = init,
+        .destroy    = destroy,
+        .access     = access,
+        .create     = create,
 #ifdef HAVE_UTIMENSAT
         .utimens = utimens,
 #endif
 #ifdef HAVE_POSIX_FALLOCATE
         .fallocate = fallocate,
 #endif
-        // #ifdef HAVE_SETXATTR
-        //     .setxattr = setxattr,
-        //     .getxattr = getxattr,
-        //     .listxattr = listxattr,
-        //     .removexattr = removexattr,
-        // #endif
         // #ifdef HAVE_COPY_FILE_RANGE
         //     .copy_file_range = copy_file_range,
         // #endif
@@ -246,6 +337,9 @@ int main(fuse_args args, app_params const& params)
         auto const rc = fuse_opt_add_arg(&args, "--help");
         assert(rc == 0);
         args.argv[0][0] = '\0';
+    } else if (params.low_level) {
+        // the requests are served by inodes, which the mount points are combined into whether there are many of them or one
+        return LowLevelFrontend{make_mfs(params)}.run(args);
     } else {
         fs = make_fs_noexcept(make_bfs(params));
     }
@@ -0,0 +1,41 @@
+#include "name_arena.hpp"
+
+#include <cassert>
+#include <cstring>
+
+using namespace multifs;
+
+NameArena::Name NameArena::add(std::string_view name)
+{
+    assert(name.size() <= kMaxSize);
+
+    auto const n = units(name.size());
+
+    char* slot = free_[n];
+    if (slot) {
+        std::memcpy(&free_[n], slot, sizeof(char*));
+    } else {
+        if (block_used_ + n * kSlotUnit > kBlockSize) {
+            blocks_.push_back(std::make_unique_for_overwrite<char[]>(kBlockSize));
+            block_used_ = 0;
+        }
+        slot = blocks_.back().get() + block_used_;
+        block_used_ += n * kSlotUnit;
+    }
+
+    slot[0] = static_cast<char>(name.size());
+    std::memcpy(slot + 1, name.data(), name.size());
+    slot[1 + name.size()] = '\0';
+
+    return Name{slot};
+}
+
+void NameArena::release(Name name) noexcept
+{
+    assert(name.slot_);
+
+    auto const n = units(name.size());
+    auto* slot   = const_cast<char*>(name.slot_);
+    std::memcpy(slot, &free_[n], sizeof(char*));
+    free_[n] = slot;
+}
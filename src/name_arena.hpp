@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace multifs
+{
+
+// Keeps the names of the entries of the directories. The names are packed into blocks that never move, every name is prefixed by its
+// size and terminated by a null character, so an entry refers to its name by a single pointer and the name is handed over to FUSE as it
+// is. Names take slots of a few sizes, the slot of a name released is reused by the next name of the slot size
+class NameArena final
+{
+public:
+    static constexpr size_t kMaxSize{255}; ///< Size of the longest name, the size of a name is kept in a single byte
+
+    // A name kept in the arena
+    class Name
+    {
+    private:
+        char const* slot_{nullptr};
+
+        explicit Name(char const* slot) noexcept
+            : slot_(slot)
+        {
+        }
+
+        friend class NameArena;
+
+    public:
+        Name() = default;
+
+        [[nodiscard]] size_t size() const noexcept { return static_cast<unsigned char>(slot_[0]); }
+        [[nodiscard]] char const* c_str() const noexcept { return slot_ + 1; }
+        [[nodiscard]] std::string_view view() const noexcept { return {c_str(), size()}; }
+    };
+
+private:
+    static constexpr size_t kSlotUnit{alignof(char*)}; ///< Slots are multiples of it, so a slot released holds the link to the next one
+    static constexpr size_t kBlockSize{64 * 1024};
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_used_{kBlockSize};                           ///< Number of bytes taken in the last block
+    std::array<char*, (kMaxSize + 2) / kSlotUnit + 2> free_{}; ///< Lists of the slots released by the numbers of units they consist of
+
+    static size_t units(size_t size) noexcept { return (size + 2 + kSlotUnit - 1) / kSlotUnit; }
+
+public:
+    NameArena() = default;
+
+    NameArena(NameArena const&)            = delete;
+    NameArena& operator=(NameArena const&) = delete;
+
+    NameArena(NameArena&&)            = delete;
+    NameArena& operator=(NameArena&&) = delete;
+
+    // Copies the name into the arena, the name must not be longer than kMaxSize
+    Name add(std::string_view name);
+    // Gives the slot of the name back, the name must have been added to the arena and not released ever since
+    void release(Name name) noexcept;
+
+    // Returns the number of bytes the blocks of the arena take
+    [[nodiscard]] size_t capacity() const noexcept { return blocks_.size() * kBlockSize; }
+};
+
+} // namespace multifs
@@ -0,0 +1,91 @@
+#include "placement.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+using namespace multifs;
+
+Placement::Placement(std::vector<std::shared_ptr<Backend>> backends, std::unique_ptr<IPlacementPolicy> policy)
+    : backends_(std::move(backends))
+    , policy_(std::move(policy))
+{
+    if (backends_.empty())
+        throw std::invalid_argument("backends provided cannot be empty");
+    if (!policy_)
+        throw std::invalid_argument("placement policy provided cannot be empty");
+}
+
+Placement::Slot Placement::slot(std::shared_ptr<Backend> const& backend)
+{
+    assert(backend);
+
+    std::lock_guard g{mtx_};
+    auto const taken = std::span{table_}.first(slots_);
+    if (auto const it = std::ranges::find(taken, backend); taken.end() != it)
+        return static_cast<Slot>(it - taken.begin());
+
+    if (kMaxSlots == slots_)
+        throw std::length_error("too many backends to refer to");
+    table_[slots_] = backend;
+
+    return static_cast<Slot>(slots_++);
+}
+
+size_t Placement::block_size() const
+{
+    return std::ranges::max(backends_locked() | std::views::transform([](auto const& backend) { return backend->block_size(); }));
+}
+
+std::shared_ptr<Backend> Placement::find(std::string_view name) const
+{
+    std::lock_guard g{mtx_};
+    auto const it = std::ranges::find(backends_, name, &Backend::name);
+    return backends_.end() != it ? *it : nullptr;
+}
+
+bool Placement::add(std::shared_ptr<Backend> backend)
+{
+    if (!backend)
+        throw std::invalid_argument("backend provided cannot be empty");
+
+    std::lock_guard g{mtx_};
+    if (!backend->name().empty() && std::ranges::count(backends_, backend->name(), &Backend::name))
+        return false;
+    backends_.push_back(std::move(backend));
+
+    return true;
+}
+
+void Placement::remove(std::shared_ptr<Backend> const& backend)
+{
+    std::lock_guard g{mtx_};
+    std::erase(backends_, backend);
+}
+
+std::shared_ptr<Backend> Placement::place(std::span<std::shared_ptr<Backend> const> excluded, Tier tier, size_t size)
+{
+    auto candidates = backends_locked();
+    std::erase_if(candidates, [=](auto const& backend) { return backend->draining() || std::ranges::find(excluded, backend) != excluded.end(); });
+
+    if (candidates.empty())
+        return nullptr;
+
+    // a chunk known to take a lot of space, e.g. being preallocated, goes to a backend it fits in if there is any
+    auto const fits = [=](auto const& backend) { return backend->free_space() >= size; };
+    if (size && std::ranges::any_of(candidates, fits))
+        std::erase_if(candidates, std::not_fn(fits));
+
+    // the backends of the tier requested are preferred as long as they have got some space
+    if (std::ranges::any_of(candidates, [=](auto const& backend) { return tier == backend->tier() && backend->free_space(); })) {
+        std::erase_if(candidates, [=](auto const& backend) { return tier != backend->tier() || !backend->free_space(); });
+    }
+
+    std::lock_guard g{mtx_};
+    return policy_->place(candidates);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "backend.hpp"
+#include "placement_policy_interface.hpp"
+
+namespace multifs
+{
+
+// Decides which of the backends new chunks of files are placed on according to the policy given,
+// backends may be added and removed while the file system is mounted
+class Placement
+{
+public:
+    using Slot = uint16_t; ///< Index of a backend in the table of the backends
+
+    static constexpr size_t kMaxSlots{1024};
+
+private:
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<Backend>> backends_;
+    std::unique_ptr<IPlacementPolicy> policy_;
+    // Every backend ever referred to by a chunk, so a chunk refers to its backend by a slot rather than by a pointer of its own. Slots are
+    // never reused, the backends removed stay in their slots, so a slot is read without locking
+    std::array<std::shared_ptr<Backend>, kMaxSlots> table_;
+    size_t slots_{0}; ///< Number of the slots taken
+
+    [[nodiscard]] std::vector<std::shared_ptr<Backend>> backends_locked() const
+    {
+        std::lock_guard g{mtx_};
+        return backends_;
+    }
+
+public:
+    explicit Placement(std::vector<std::shared_ptr<Backend>> backends, std::unique_ptr<IPlacementPolicy> policy);
+    ~Placement() = default;
+
+    Placement(Placement const&)            = delete;
+    Placement& operator=(Placement const&) = delete;
+
+    Placement(Placement&&)            = delete;
+    Placement& operator=(Placement&&) = delete;
+
+    // Returns a snapshot of the backends, the set may change right after
+    [[nodiscard]] std::vector<std::shared_ptr<Backend>> backends() const { return backends_locked(); }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        std::lock_guard g{mtx_};
+        return backends_.size();
+    }
+
+    // Returns the backend in the slot, the slot must have been returned by slot()
+    [[nodiscard]] std::shared_ptr<Backend> const& backend(Slot slot) const noexcept { return table_[slot]; }
+    // Returns the slot of the backend, the backend takes the next one if it has got none so far. Throws if the table is full
+    [[nodiscard]] Slot slot(std::shared_ptr<Backend> const& backend);
+
+    // Returns the backend known by the name given, nullptr if there is none
+    [[nodiscard]] std::shared_ptr<Backend> find(std::string_view name) const;
+
+    // Adds the backend to the ones new chunks are placed on, returns false if there is a backend of the same name already
+    bool add(std::shared_ptr<Backend> backend);
+    // Removes the backend, which is supposed to have been drained of the chunks
+    void remove(std::shared_ptr<Backend> const& backend);
+
+    // Returns the largest block size among the backends, so that a chunk boundary aligned to it is aligned for every backend
+    [[nodiscard]] size_t block_size() const;
+
+    // Chooses a backend for a new chunk among the ones not excluded and not draining preferring the tier given and the ones
+    // having got the number of bytes given free, returns nullptr if there is none
+    std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> excluded, Tier tier = Tier::kFast, size_t size = 0);
+};
+
+} // namespace multifs
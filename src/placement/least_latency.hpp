@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "backend.hpp"
+#include "placement_policy_interface.hpp"
+
+namespace multifs::placement
+{
+
+// Places chunks on the backend having responded the fastest recently, ties are broken by free space
+class LeastLatency final : public IPlacementPolicy
+{
+public:
+    std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> candidates) override
+    {
+        return *std::ranges::min_element(
+            candidates, std::less<>{}, [](auto const& backend) { return std::pair{backend->latency(), -static_cast<ssize_t>(backend->free_space())}; });
+    }
+};
+
+} // namespace multifs::placement
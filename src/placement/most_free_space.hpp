@@ -0,0 +1,23 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <span>
+
+#include "backend.hpp"
+#include "placement_policy_interface.hpp"
+
+namespace multifs::placement
+{
+
+// Places chunks on the backend having the most of free space
+class MostFreeSpace final : public IPlacementPolicy
+{
+public:
+    std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> candidates) override
+    {
+        return *std::ranges::max_element(candidates, std::less<>{}, [](auto const& backend) { return backend->free_space(); });
+    }
+};
+
+} // namespace multifs::placement
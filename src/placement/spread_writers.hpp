@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "backend.hpp"
+#include "placement_policy_interface.hpp"
+
+namespace multifs::placement
+{
+
+// Places chunks on the backend the fewest files are being written to, so that files written
+// at the same time land on different backends, ties are broken by free space
+class SpreadWriters final : public IPlacementPolicy
+{
+public:
+    std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> candidates) override
+    {
+        return *std::ranges::min_element(
+            candidates, std::less<>{}, [](auto const& backend) { return std::pair{backend->writers(), -static_cast<ssize_t>(backend->free_space())}; });
+    }
+};
+
+} // namespace multifs::placement
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <span>
+
+#include "backend.hpp"
+#include "placement_policy_interface.hpp"
+
+namespace multifs::placement
+{
+
+// Places chunks on backends in turn proportionally to the bandwidths configured for them,
+// the smooth weighted round-robin spreads picks of the same backend over the whole cycle
+class WeightedRoundRobin final : public IPlacementPolicy
+{
+private:
+    // the backends are held weakly, so that the credit of a backend removed is neither kept nor inherited by one added later
+    std::map<std::weak_ptr<Backend>, int64_t, std::owner_less<>> current_;
+
+public:
+    std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> candidates) override
+    {
+        std::erase_if(current_, [](auto const& entry) { return entry.first.expired(); });
+
+        int64_t total{0};
+        for (auto const& backend : candidates) {
+            current_[backend] += static_cast<int64_t>(backend->bandwidth());
+            total += static_cast<int64_t>(backend->bandwidth());
+        }
+
+        auto const& chosen = *std::ranges::max_element(candidates, std::less<>{}, [this](auto const& backend) { return current_[backend]; });
+        current_[chosen] -= total;
+
+        return chosen;
+    }
+};
+
+} // namespace multifs::placement
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <span>
+
+#include "backend.hpp"
+
+namespace multifs
+{
+
+class IPlacementPolicy
+{
+public:
+    IPlacementPolicy()          = default;
+    virtual ~IPlacementPolicy() = default;
+
+    IPlacementPolicy(IPlacementPolicy const&)            = default;
+    IPlacementPolicy& operator=(IPlacementPolicy const&) = default;
+
+    IPlacementPolicy(IPlacementPolicy&&) noexcept            = default;
+    IPlacementPolicy& operator=(IPlacementPolicy&&) noexcept = default;
+
+    // Chooses one of the candidates to place a new chunk on, candidates are never empty
+    virtual std::shared_ptr<Backend> place(std::span<std::shared_ptr<Backend> const> candidates) = 0;
+};
+
+} // namespace multifs
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+
+namespace multifs
+{
+
+// Paces consumers of bytes to the rate given, every acquisition is scheduled right after the previous one is done at the rate
+class RateLimiter
+{
+private:
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<size_t> rate_; ///< Bytes per second, 0 stands for unlimited
+    std::mutex mtx_;
+    std::condition_variable_any cv_;
+    clock::time_point next_{}; ///< Time point the next acquisition may happen at
+
+public:
+    explicit RateLimiter(size_t rate) noexcept
+        : rate_(rate)
+    {
+    }
+
+    [[nodiscard]] size_t rate() const noexcept { return rate_.load(std::memory_order_relaxed); }
+    void rate(size_t rate) noexcept { rate_.store(rate, std::memory_order_relaxed); }
+
+    // Waits until the bytes may be consumed, returns false if the stop has been requested meanwhile
+    bool acquire(size_t bytes, std::stop_token const& stoken)
+    {
+        auto const rate = this->rate();
+        if (0 == rate)
+            return !stoken.stop_requested();
+
+        std::unique_lock lk{mtx_};
+        auto const at = std::max(next_, clock::now());
+        next_         = at + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(static_cast<double>(bytes) / rate));
+        cv_.wait_until(lk, stoken, at, [] { return false; });
+        return !stoken.stop_requested();
+    }
+};
+
+} // namespace multifs
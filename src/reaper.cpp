@@ -0,0 +1,109 @@
+#include "reaper.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <boost/asio/post.hpp>
+
+#include <fuse.h>
+
+#include "io_pool.hpp"
+
+using namespace multifs;
+
+namespace
+{
+
+std::filesystem::path const kTrashDir{"/.multifs.trash"};
+
+} // anonymous namespace
+
+Reaper::Reaper(std::shared_ptr<IFileSystem> fs, size_t concurrency)
+    : fs_(std::move(fs))
+    , concurrency_(concurrency)
+    , next_name_(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()))
+{
+    if (!fs_)
+        throw std::invalid_argument("fs provided cannot be empty");
+    if (0 == concurrency_)
+        throw std::invalid_argument("concurrency of a reaper cannot be zero");
+}
+
+void Reaper::prepare() { fs_->mkdir(kTrashDir, S_IRWXU); }
+
+void Reaper::recover()
+{
+    std::vector<std::string> names;
+    auto const filler = [](void* buf, char const* name, struct stat const* /*stbuf*/, off_t /*off*/, fuse_fill_dir_flags /*flags*/) {
+        if (std::string_view{"."} != name && std::string_view{".."} != name)
+            static_cast<std::vector<std::string>*>(buf)->emplace_back(name);
+        return 0;
+    };
+    if (fs_->readdir(kTrashDir, &names, filler, 0, nullptr, fuse_readdir_flags{}) || names.empty())
+        return;
+
+    // the files discarded meanwhile may be listed as well, unlinking them twice does no harm
+    std::lock_guard g{mtx_};
+    for (auto const& name : names)
+        queue_.push_back(kTrashDir / name);
+    schedule();
+}
+
+void Reaper::schedule()
+{
+    // the workers are spawned up to the concurrency, each of them unlinks the files queued until there are none left
+    for (; workers_ < std::min(concurrency_, queue_.size()); ++workers_)
+        boost::asio::post(reaper_pool(), [self = shared_from_this()] { self->work(); });
+}
+
+void Reaper::work()
+{
+    std::unique_lock lk{mtx_};
+    while (!queue_.empty()) {
+        auto const path = std::move(queue_.front());
+        queue_.pop_front();
+        lk.unlock();
+
+        if (auto const r = fs_->unlink(path); 0 == r)
+            reclaimed_.fetch_add(1, std::memory_order_release);
+
+        lk.lock();
+    }
+    --workers_;
+}
+
+void Reaper::start()
+{
+    std::call_once(started_, [this] {
+        prepare();
+        boost::asio::post(reaper_pool(), [self = shared_from_this()] { self->recover(); });
+    });
+}
+
+int Reaper::discard(std::filesystem::path const& path)
+{
+    start();
+
+    auto trash = kTrashDir / std::to_string(next_name_.fetch_add(1, std::memory_order_relaxed));
+    if (fs_->rename(path, trash, 0))
+        return fs_->unlink(path);
+
+    std::lock_guard g{mtx_};
+    queue_.push_back(std::move(trash));
+    schedule();
+
+    return 0;
+}
+
+size_t Reaper::pending()
+{
+    std::lock_guard g{mtx_};
+    return queue_.size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+#include "file_system_interface.hpp"
+
+namespace multifs
+{
+
+// Deletes files off a backend in the background. A file is moved out of the way into the trash directory right away, so that its path
+// is free to be reused, and gets unlinked later, as unlinking a large file may take the backend a while. The trash directory makes up
+// the queue of the files to unlink, the files left in it by the previous run are unlinked once the reaper is started
+class Reaper final : public std::enable_shared_from_this<Reaper>
+{
+public:
+    static constexpr size_t kConcurrency{2}; ///< Number of files unlinked at once by default
+
+private:
+    std::shared_ptr<IFileSystem> fs_;
+    size_t concurrency_;                      ///< Number of files unlinked at once
+    std::once_flag started_;                  ///< Makes the trash directory be made and the files left in it be queued once
+    std::atomic<uint64_t> next_name_;         ///< Name of the next file moved to the trash, starting off the clock to not clash with the files left
+    std::mutex mtx_;                          ///< Guards the queue and the number of workers
+    std::deque<std::filesystem::path> queue_; ///< Files in the trash waiting to be unlinked
+    size_t workers_{0};                       ///< Number of workers unlinking the files queued
+    std::atomic<uint64_t> reclaimed_{0};      ///< Number of files unlinked
+
+    void prepare();
+    void recover();
+    void schedule();
+    void work();
+
+public:
+    explicit Reaper(std::shared_ptr<IFileSystem> fs, size_t concurrency = kConcurrency);
+
+    Reaper(Reaper const&)            = delete;
+    Reaper& operator=(Reaper const&) = delete;
+
+    Reaper(Reaper&&)            = delete;
+    Reaper& operator=(Reaper&&) = delete;
+
+    // Queues the files left in the trash by the previous run to be unlinked. Nothing is done on construction, as the process is forked
+    // on daemonizing and threads do not survive it
+    void start();
+
+    // Moves the file to the trash and queues it to be unlinked, the file is unlinked synchronously if it cannot be moved
+    int discard(std::filesystem::path const& path);
+
+    // Returns the number of files in the trash waiting to be unlinked
+    [[nodiscard]] size_t pending();
+
+    // Returns the number of files unlinked so far, the space of the backend grows every time it changes
+    [[nodiscard]] uint64_t reclaimed() const noexcept { return reclaimed_.load(std::memory_order_acquire); }
+};
+
+} // namespace multifs
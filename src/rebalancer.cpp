@@ -0,0 +1,218 @@
+#include "rebalancer.hpp"
+
+#include <cerrno>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace multifs;
+
+Rebalancer::Rebalancer(std::shared_ptr<Placement> placement, std::shared_ptr<FileRegistry> files, Config config)
+    : placement_(std::move(placement))
+    , files_(std::move(files))
+    , config_(config)
+    , limiter_(config.rate)
+{
+    if (!placement_)
+        throw std::invalid_argument("placement provided cannot be empty");
+    if (!files_)
+        throw std::invalid_argument("file registry provided cannot be empty");
+    if (0 == config_.io_size)
+        throw std::invalid_argument("size of I/Os cannot be zero");
+}
+
+Rebalancer::Progress Rebalancer::progress() const noexcept
+{
+    return {
+        .passes        = passes_.load(std::memory_order_relaxed),
+        .moved_chunks  = moved_chunks_.load(std::memory_order_relaxed),
+        .moved_bytes   = moved_bytes_.load(std::memory_order_relaxed),
+        .pending_bytes = pending_bytes_.load(std::memory_order_relaxed),
+    };
+}
+
+void Rebalancer::start()
+{
+    std::call_once(started_, [this] { worker_ = std::jthread{[this](std::stop_token stoken) { run(std::move(stoken)); }}; });
+}
+
+void Rebalancer::wake()
+{
+    {
+        std::lock_guard g{mtx_};
+        woken_ = true;
+    }
+    cv_.notify_one();
+}
+
+void Rebalancer::run(std::stop_token stoken)
+{
+    while (!stoken.stop_requested()) {
+        {
+            std::unique_lock lk{mtx_};
+            // chunks failed to be moved off the draining backends are retried soon, as the backends are waited to be removed
+            auto const draining = std::ranges::any_of(placement_->backends(), &Backend::draining);
+            cv_.wait_for(lk, stoken, draining ? std::min(config_.interval, kDrainRetry) : config_.interval, [this] { return std::exchange(woken_, false); });
+        }
+        if (stoken.stop_requested())
+            break;
+
+        try {
+            pass(stoken);
+        } catch (...) {
+            // chunks failed to be moved are retried on the next pass
+        }
+        passes_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::optional<uint64_t> Rebalancer::drain(std::span<std::shared_ptr<Backend> const> backends, std::stop_token const& stoken)
+{
+    // the backends found holding no chunks are removed, no chunks are placed on them since they were marked draining
+    std::vector<std::shared_ptr<Backend>> drained;
+    std::ranges::copy_if(backends, std::back_inserter(drained), &Backend::draining);
+
+    uint64_t left{0};
+    for (auto const& file : files_->files()) {
+        for (auto const& replica : file->chunk_replicas()) {
+            if (stoken.stop_requested())
+                return std::nullopt;
+            if (!replica.fs->draining())
+                continue;
+
+            auto const target = file->place_move(replica.chunk_idx, replica.fs->tier());
+            auto const moved  = target ? file->move_chunk(replica.chunk_idx,
+                                            replica.fs,
+                                            target,
+                                            File::MoveOptions{.block_size = config_.io_size, .limiter = &limiter_, .stoken = stoken})
+                                       : -ENOSPC;
+            if (-ECANCELED == moved)
+                return std::nullopt;
+            if (moved < 0) {
+                // the chunk is retried on the next pass
+                left += replica.size;
+                std::erase(drained, replica.fs);
+                continue;
+            }
+
+            moved_chunks_.fetch_add(1, std::memory_order_relaxed);
+            moved_bytes_.fetch_add(static_cast<uint64_t>(moved), std::memory_order_relaxed);
+        }
+    }
+
+    for (auto const& backend : drained)
+        placement_->remove(backend);
+
+    return left;
+}
+
+void Rebalancer::pass(std::stop_token const& stoken)
+{
+    auto const backends = placement_->backends();
+
+    // draining is requested explicitly, so it is done even if rebalancing is disabled
+    uint64_t draining_left{0};
+    if (std::ranges::any_of(backends, &Backend::draining)) {
+        auto const left = drain(backends, stoken);
+        if (!left)
+            return;
+        draining_left = *left;
+    }
+
+    pending_bytes_.store(draining_left, std::memory_order_relaxed);
+    if (0 == limiter_.rate())
+        return;
+
+    // the usage is kept up to date by the bytes moved, as the space reported by backends lags behind,
+    // the draining backends take no part in balancing
+    std::vector<double> total(backends.size());
+    std::vector<double> used(backends.size());
+    for (size_t i = 0; i < backends.size(); ++i) {
+        if (backends[i]->draining())
+            continue;
+        auto const space = backends[i]->total_space();
+        total[i]         = static_cast<double>(space);
+        used[i]          = static_cast<double>(space - std::min(space, backends[i]->free_space()));
+    }
+
+    auto const total_sum = std::accumulate(total.begin(), total.end(), 0.0);
+    if (0 == total_sum)
+        return;
+
+    auto const average = std::accumulate(used.begin(), used.end(), 0.0) / total_sum;
+    auto const fill    = [&](size_t i) { return total[i] ? used[i] / total[i] : average; };
+    auto const excess  = [&](size_t i) { return std::max(0.0, used[i] - (average + config_.tolerance) * total[i]); };
+
+    auto const pending_update = [&] {
+        double pending{0};
+        for (size_t i = 0; i < backends.size(); ++i)
+            pending += excess(i);
+        pending_bytes_.store(draining_left + static_cast<uint64_t>(pending), std::memory_order_relaxed);
+        return pending;
+    };
+
+    if (0 == pending_update())
+        return;
+
+    // the fullest backends are relieved first
+    std::vector<size_t> sources(backends.size());
+    std::iota(sources.begin(), sources.end(), size_t{0});
+    std::ranges::sort(sources, std::greater<>{}, fill);
+
+    auto const files = files_->files();
+
+    for (auto const source : sources) {
+        if (0 == excess(source))
+            break;
+
+        for (auto const& file : files) {
+            for (auto const& replica : file->chunk_replicas()) {
+                if (stoken.stop_requested())
+                    return;
+                if (0 == excess(source))
+                    break;
+                if (replica.fs != backends[source] || 0 == replica.size)
+                    continue;
+
+                // the target is the emptiest backend of the same tier, so that rebalancing does not interfere with tiering,
+                // which the chunk does not make fuller than the source is left
+                auto const excluded = file->move_excluded(replica.chunk_idx);
+                auto const size     = static_cast<double>(replica.size);
+
+                std::optional<size_t> target;
+                for (size_t i = 0; i < backends.size(); ++i) {
+                    if (backends[i]->tier() != backends[source]->tier() || 0 == total[i] || std::ranges::count(excluded, backends[i]))
+                        continue;
+                    if ((used[i] + size) / total[i] > (used[source] - size) / total[source])
+                        continue;
+                    if (!target || fill(i) < fill(*target))
+                        target = i;
+                }
+                if (!target)
+                    continue;
+
+                auto const moved = file->move_chunk(replica.chunk_idx,
+                    backends[source],
+                    backends[*target],
+                    File::MoveOptions{.block_size = config_.io_size, .limiter = &limiter_, .stoken = stoken});
+                if (-ECANCELED == moved)
+                    return;
+                if (moved < 0)
+                    continue;
+
+                used[source] -= static_cast<double>(moved);
+                used[*target] += static_cast<double>(moved);
+                moved_chunks_.fetch_add(1, std::memory_order_relaxed);
+                moved_bytes_.fetch_add(static_cast<uint64_t>(moved), std::memory_order_relaxed);
+                pending_update();
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+
+#include "backend.hpp"
+#include "file_registry.hpp"
+#include "placement.hpp"
+#include "rate_limiter.hpp"
+
+namespace multifs
+{
+
+// Moves chunks from the backends filled above the average to the ones filled below it in the background, the chunks are copied
+// at a limited rate while their files stay accessible. Draining backends are emptied first and removed once they hold no chunks
+class Rebalancer
+{
+public:
+    struct Config {
+        std::chrono::seconds interval{60}; ///< Period of checking whether the backends are balanced
+        double tolerance{0.05};            ///< Deviation of the fraction of the space used on a backend from the average, which is tolerated
+        size_t rate{64 * 1024 * 1024};     ///< Bytes per second chunks are copied at, 0 disables rebalancing
+        size_t io_size{4 * 1024 * 1024};   ///< Size of the I/Os chunks are copied by
+    };
+
+    struct Progress {
+        uint64_t passes;        ///< Number of passes done
+        uint64_t moved_chunks;  ///< Number of chunks moved
+        uint64_t moved_bytes;   ///< Number of bytes moved
+        uint64_t pending_bytes; ///< Number of bytes estimated to be moved yet for the backends to get balanced and drained
+    };
+
+private:
+    static constexpr std::chrono::seconds kDrainRetry{1};
+
+    std::shared_ptr<Placement> placement_;
+    std::shared_ptr<FileRegistry> files_;
+    Config config_;
+    RateLimiter limiter_;
+    std::atomic<uint64_t> passes_{0};
+    std::atomic<uint64_t> moved_chunks_{0};
+    std::atomic<uint64_t> moved_bytes_{0};
+    std::atomic<uint64_t> pending_bytes_{0};
+    std::mutex mtx_;
+    std::condition_variable_any cv_;
+    bool woken_{false};
+    std::once_flag started_;
+    std::jthread worker_; ///< Declared last to be stopped before the rest is destroyed
+
+    void run(std::stop_token stoken);
+    void pass(std::stop_token const& stoken);
+    // Moves the chunks off the draining backends, returns the number of bytes left on them or nullopt if stopped
+    std::optional<uint64_t> drain(std::span<std::shared_ptr<Backend> const> backends, std::stop_token const& stoken);
+
+public:
+    explicit Rebalancer(std::shared_ptr<Placement> placement, std::shared_ptr<FileRegistry> files, Config config);
+    ~Rebalancer() = default;
+
+    Rebalancer(Rebalancer const&)            = delete;
+    Rebalancer& operator=(Rebalancer const&) = delete;
+
+    Rebalancer(Rebalancer&&)            = delete;
+    Rebalancer& operator=(Rebalancer&&) = delete;
+
+    [[nodiscard]] Progress progress() const noexcept;
+
+    [[nodiscard]] size_t rate() const noexcept { return limiter_.rate(); }
+    // Changes the rate chunks are copied at, the chunks being copied are affected as well
+    void rate(size_t rate) noexcept { limiter_.rate(rate); }
+
+    // Makes the worker do a pass right away, e.g. once a backend has been added or is to be drained
+    void wake();
+
+    // Starts the worker unless it has been started, the worker is not started on construction
+    // as the process is forked on daemonizing and threads do not survive it
+    void start();
+};
+
+} // namespace multifs
@@ -4,24 +4,55 @@
 
 #include <utility>
 
-#include <fuse.h>
-
+#include "caller.hpp"
 #include "utilities.hpp"
 
 using namespace multifs;
 
-Symlink::Symlink(std::filesystem::path target) noexcept
+Symlink::Symlink(std::filesystem::path target, uint64_t ino) noexcept
     : target_(std::move(target))
+    , ino_(ino)
 {
-    auto const* ctx = fuse_get_context();
-    assert(ctx);
-    desc_.owner_uid = ctx->uid;
-    desc_.owner_gid = ctx->gid;
+    auto const [uid, gid] = caller();
+    desc_.owner_uid       = uid;
+    desc_.owner_gid       = gid;
     desc_.atime     = current_time();
     desc_.mtime     = desc_.atime;
     desc_.ctime     = desc_.atime;
 }
 
+Symlink::Symlink(InodeRecord const& record)
+    : target_(record.data)
+    , ino_(record.ino)
+{
+    assert(InodeRecord::Kind::kSymlink == record.kind);
+    desc_.mode      = record.mode;
+    desc_.owner_uid = record.owner_uid;
+    desc_.owner_gid = record.owner_gid;
+    desc_.atime     = record.atime;
+    desc_.mtime     = record.mtime;
+    desc_.ctime     = record.ctime;
+}
+
+InodeRecord Symlink::record() const noexcept
+{
+    return {
+        .ino        = ino_,
+        .kind       = InodeRecord::Kind::kSymlink,
+        .mode       = desc_.mode,
+        .owner_uid  = desc_.owner_uid,
+        .owner_gid  = desc_.owner_gid,
+        .flags      = 0,
+        .size       = target_.native().size(),
+        .atime      = desc_.atime,
+        .mtime      = desc_.mtime,
+        .ctime      = desc_.ctime,
+        .layout     = {},
+        .zero_block = 0,
+        .data       = target_.native(),
+    };
+}
+
 int Symlink::chown(uid_t uid, gid_t gid) noexcept
 {
     desc_.owner_uid = uid;
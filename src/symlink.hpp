@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstdint>
+
 #include <filesystem>
 
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "metadata_record.hpp"
+
 namespace multifs
 {
 
@@ -23,12 +27,16 @@ public:
 
 private:
     std::filesystem::path target_;
+    uint64_t ino_{0};  ///< Number the symlink is known by, in the metadata store as well
+    nlink_t nlink_{0}; ///< Number of the entries of the namespace the symlink is linked by
 
     Descriptor desc_;
 
 public:
     Symlink() = default;
-    explicit Symlink(std::filesystem::path target) noexcept;
+    explicit Symlink(std::filesystem::path target, uint64_t ino = 0) noexcept;
+    // Restores the symlink kept in the metadata store
+    explicit Symlink(InodeRecord const& record);
 
     Symlink(Symlink const&)            = default;
     Symlink& operator=(Symlink const&) = default;
@@ -38,6 +46,12 @@ public:
 
     [[nodiscard]] auto const& target() const noexcept { return target_; }
     [[nodiscard]] auto const& desc() const noexcept { return desc_; }
+    [[nodiscard]] uint64_t ino() const noexcept { return ino_; }
+    [[nodiscard]] nlink_t nlink() const noexcept { return nlink_; }
+    [[nodiscard]] InodeRecord record() const noexcept;
+
+    // Counts a link of the symlink made within the namespace, or removed if the delta is negative
+    void count_link(int delta) noexcept { nlink_ += delta; }
 
     int chown(uid_t uid, gid_t gid) noexcept;
     int utimens(const struct timespec ts[2]) noexcept;
@@ -116,6 +116,12 @@ public:
         return fs_->access(path, mask);
     }
 
+    int opendir(std::filesystem::path const& path, struct fuse_file_info* fi) override
+    {
+        std::shared_lock g{lock_};
+        return fs_->opendir(path, fi);
+    }
+
     int readdir(
         std::filesystem::path const& path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, fuse_readdir_flags flags) const override
     {
@@ -123,6 +129,12 @@ public:
         return fs_->readdir(path, buf, filler, offset, fi, flags);
     }
 
+    int releasedir(std::filesystem::path const& path, struct fuse_file_info* fi) override
+    {
+        std::shared_lock g{lock_};
+        return fs_->releasedir(path, fi);
+    }
+
     int unlink(std::filesystem::path const& path) override
     {
         std::lock_guard g{lock_};
@@ -205,6 +217,20 @@ public:
     }
 #endif // HAVE_POSIX_FALLOCATE
 
+#ifdef HAVE_SETXATTR
+    int setxattr(std::filesystem::path const& path, std::string_view name, std::span<char const> value, int flags) override
+    {
+        std::lock_guard g{lock_};
+        return fs_->setxattr(path, name, value, flags);
+    }
+
+    int getxattr(std::filesystem::path const& path, std::string_view name, std::span<char> value) const override
+    {
+        std::shared_lock g{lock_};
+        return fs_->getxattr(path, name, value);
+    }
+#endif // HAVE_SETXATTR
+
     off_t lseek(std::filesystem::path const& path, off_t off, int whence, struct fuse_file_info* fi) const override
     {
         std::shared_lock g{lock_};
@@ -0,0 +1,106 @@
+#include "tier_migrator.hpp"
+
+#include <cerrno>
+
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+#include <utility>
+
+using namespace multifs;
+
+TierMigrator::TierMigrator(std::shared_ptr<Placement> placement, std::shared_ptr<FileRegistry> files, Config config)
+    : placement_(std::move(placement))
+    , files_(std::move(files))
+    , config_(config)
+    , limiter_(config.rate)
+{
+    if (!placement_)
+        throw std::invalid_argument("placement provided cannot be empty");
+    if (!files_)
+        throw std::invalid_argument("file registry provided cannot be empty");
+}
+
+bool TierMigrator::applicable(Placement const& placement) noexcept
+{
+    auto const& backends = placement.backends();
+    return std::ranges::any_of(backends, [](auto const& backend) { return Tier::kFast == backend->tier(); }) &&
+           std::ranges::any_of(backends, [](auto const& backend) { return Tier::kSlow == backend->tier(); });
+}
+
+void TierMigrator::start()
+{
+    std::call_once(started_, [this] { worker_ = std::jthread{[this](std::stop_token stoken) { run(std::move(stoken)); }}; });
+}
+
+void TierMigrator::run(std::stop_token stoken)
+{
+    std::mutex mtx;
+    std::condition_variable_any cv;
+
+    while (!stoken.stop_requested()) {
+        {
+            std::unique_lock lk{mtx};
+            cv.wait_for(lk, stoken, config_.interval, [] { return false; });
+        }
+        if (stoken.stop_requested())
+            break;
+
+        try {
+            pass(stoken);
+        } catch (...) {
+            // chunks failed to be moved are retried on the next pass
+        }
+    }
+}
+
+void TierMigrator::pass(std::stop_token const& stoken)
+{
+    size_t fast_total{0};
+    size_t fast_used{0};
+    for (auto const& backend : placement_->backends()) {
+        if (Tier::kFast == backend->tier()) {
+            auto const total = backend->total_space();
+            fast_total += total;
+            fast_used += total - std::min(total, backend->free_space());
+        }
+    }
+    if (0 == fast_total)
+        return;
+
+    // the usage is kept up to date by the bytes moved, as the space reported by backends lags behind
+    auto const fast_full = [&] { return static_cast<double>(fast_used) > config_.fast_watermark * static_cast<double>(fast_total); };
+
+    for (auto const& file : files_->files()) {
+        for (auto const& chunk : file->chunks_heat()) {
+            if (stoken.stop_requested())
+                return;
+
+            Tier target_tier;
+            if (Tier::kFast == chunk.fs->tier() && 0 == chunk.heat && fast_full())
+                target_tier = Tier::kSlow;
+            else if (Tier::kSlow == chunk.fs->tier() && config_.hot_heat <= chunk.heat && !fast_full())
+                target_tier = Tier::kFast;
+            else
+                continue;
+
+            auto target = file->place_move(chunk.chunk_idx, target_tier);
+            if (!target || target_tier != target->tier())
+                continue;
+
+            auto const moved = file->move_chunk(chunk.chunk_idx,
+                chunk.fs,
+                std::move(target),
+                File::MoveOptions{.block_size = config_.io_size, .limiter = &limiter_, .stoken = stoken});
+            if (-ECANCELED == moved)
+                return;
+            if (moved < 0)
+                continue;
+
+            if (Tier::kSlow == target_tier)
+                fast_used -= std::min(fast_used, static_cast<size_t>(moved));
+            else
+                fast_used += static_cast<size_t>(moved);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "file_registry.hpp"
+#include "placement.hpp"
+#include "rate_limiter.hpp"
+
+namespace multifs
+{
+
+// Moves chunks between the tiers of backends according to how often the chunks are accessed,
+// cold chunks are demoted to the slow tier to make room on the fast one, hot chunks are promoted back
+class TierMigrator
+{
+public:
+    struct Config {
+        std::chrono::seconds interval{30}; ///< Period of surveying the chunks, the heat of a chunk halves every period
+        uint32_t hot_heat{16};             ///< Heat a chunk on the slow tier gets promoted at
+        double fast_watermark{0.8};        ///< Fraction of the fast tier space used, which cold chunks get demoted above
+        size_t rate{64 * 1024 * 1024};     ///< Bytes per second chunks are copied between the tiers at, 0 stands for unlimited
+        size_t io_size{4 * 1024 * 1024};   ///< Size of the I/Os chunks are copied by
+    };
+
+private:
+    std::shared_ptr<Placement> placement_;
+    std::shared_ptr<FileRegistry> files_;
+    Config config_;
+    RateLimiter limiter_;
+    std::once_flag started_;
+    std::jthread worker_; ///< Declared last to be stopped before the rest is destroyed
+
+    void run(std::stop_token stoken);
+    void pass(std::stop_token const& stoken);
+
+public:
+    explicit TierMigrator(std::shared_ptr<Placement> placement, std::shared_ptr<FileRegistry> files, Config config);
+    ~TierMigrator() = default;
+
+    TierMigrator(TierMigrator const&)            = delete;
+    TierMigrator& operator=(TierMigrator const&) = delete;
+
+    TierMigrator(TierMigrator&&)            = delete;
+    TierMigrator& operator=(TierMigrator&&) = delete;
+
+    // Checks whether there are backends of both tiers to migrate chunks between
+    [[nodiscard]] static bool applicable(Placement const& placement) noexcept;
+
+    // Starts the worker unless it has been started, the worker is not started on construction
+    // as the process is forked on daemonizing and threads do not survive it
+    void start();
+};
+
+} // namespace multifs
@@ -1,7 +1,17 @@
 #pragma once
 
+#include <cerrno>
+#include <cstddef>
 #include <ctime>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
 #include <type_traits>
 
 namespace multifs
@@ -32,4 +42,36 @@ inline auto current_time() noexcept
     return current_time;
 }
 
+// Parses the value of an extended attribute holding a number
+inline std::optional<size_t> xattr_parse(std::span<char const> value) noexcept
+{
+    size_t n{0};
+    if (auto const [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), n); std::errc{} != ec || value.data() + value.size() != ptr)
+        return std::nullopt;
+    return n;
+}
+
+// Copies the string as the value of an extended attribute, returns the length of the value, which is merely computed if the value is empty
+inline int xattr_format(std::string_view str, std::span<char> value) noexcept
+{
+    auto const len = static_cast<int>(str.size());
+
+    if (value.empty())
+        return len;
+
+    if (value.size() < str.size())
+        return -ERANGE;
+
+    std::ranges::copy(str, value.data());
+
+    return len;
+}
+
+// Formats the number as the value of an extended attribute
+inline int xattr_format(size_t n, std::span<char> value) noexcept
+{
+    std::array<char, std::numeric_limits<size_t>::digits10 + 1> str;
+    return xattr_format(std::string_view{str.data(), std::to_chars(str.data(), str.data() + str.size(), n).ptr}, value);
+}
+
 } // namespace multifs
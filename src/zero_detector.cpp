@@ -0,0 +1,137 @@
+#include "zero_detector.hpp"
+
+#include <cstring>
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MULTIFS_X86 1
+#endif
+
+using namespace multifs;
+
+namespace
+{
+
+// Bytes or-ed together before the accumulator is checked, a cache line
+constexpr size_t kLineSize{64};
+
+bool zero_tail(std::byte const* p, size_t n) noexcept
+{
+    for (size_t i = 0; i < n; ++i) {
+        if (std::byte{0} != p[i])
+            return false;
+    }
+    return true;
+}
+
+bool zero_scalar(std::byte const* p, size_t n) noexcept
+{
+    size_t i{0};
+    for (; i + kLineSize <= n; i += kLineSize) {
+        uint64_t acc{0};
+        for (size_t j = 0; j < kLineSize; j += sizeof(uint64_t)) {
+            uint64_t w;
+            std::memcpy(&w, p + i + j, sizeof(w));
+            acc |= w;
+        }
+        if (acc)
+            return false;
+    }
+    return zero_tail(p + i, n - i);
+}
+
+#ifdef MULTIFS_X86
+__attribute__((target("sse2"))) bool zero_sse2(std::byte const* p, size_t n) noexcept
+{
+    auto const zero = _mm_setzero_si128();
+
+    size_t i{0};
+    for (; i + kLineSize <= n; i += kLineSize) {
+        auto const* v  = reinterpret_cast<__m128i const*>(p + i);
+        auto const acc = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)), _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+        if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)))
+            return false;
+    }
+    return zero_scalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) bool zero_avx2(std::byte const* p, size_t n) noexcept
+{
+    // two cache lines are or-ed together per check, as the test is cheap compared to the loads
+    size_t i{0};
+    for (; i + 2 * kLineSize <= n; i += 2 * kLineSize) {
+        auto const* v  = reinterpret_cast<__m256i const*>(p + i);
+        auto const a   = _mm256_or_si256(_mm256_loadu_si256(v), _mm256_loadu_si256(v + 1));
+        auto const b   = _mm256_or_si256(_mm256_loadu_si256(v + 2), _mm256_loadu_si256(v + 3));
+        auto const acc = _mm256_or_si256(a, b);
+        if (!_mm256_testz_si256(acc, acc))
+            return false;
+    }
+    return zero_scalar(p + i, n - i);
+}
+#endif // MULTIFS_X86
+
+using Kernel = bool (*)(std::byte const* p, size_t n) noexcept;
+
+Kernel kernel(ZeroDetector::Isa isa) noexcept
+{
+#ifdef MULTIFS_X86
+    switch (isa) {
+        case ZeroDetector::Isa::kSse2:
+            return zero_sse2;
+        case ZeroDetector::Isa::kAvx2:
+            return zero_avx2;
+        default:
+            break;
+    }
+#endif // MULTIFS_X86
+    return zero_scalar;
+}
+
+} // anonymous namespace
+
+ZeroDetector::ZeroDetector(Isa isa)
+    : isa_(isa)
+{
+    if (!supported(isa_))
+        throw std::invalid_argument("instruction set is not supported by the CPU");
+}
+
+bool ZeroDetector::zero(std::span<std::byte const> buf) const noexcept { return kernel(isa_)(buf.data(), buf.size()); }
+
+ZeroDetector::Isa ZeroDetector::best_isa() noexcept
+{
+    static Isa const isa = supported(Isa::kAvx2) ? Isa::kAvx2 : supported(Isa::kSse2) ? Isa::kSse2 : Isa::kScalar;
+    return isa;
+}
+
+bool ZeroDetector::supported(Isa isa) noexcept
+{
+    switch (isa) {
+#ifdef MULTIFS_X86
+        case Isa::kSse2:
+            return __builtin_cpu_supports("sse2");
+        case Isa::kAvx2:
+            return __builtin_cpu_supports("avx2");
+#endif // MULTIFS_X86
+        case Isa::kScalar:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string_view ZeroDetector::name(Isa isa) noexcept
+{
+    switch (isa) {
+        case Isa::kScalar:
+            return "scalar";
+        case Isa::kSse2:
+            return "sse2";
+        case Isa::kAvx2:
+            return "avx2";
+    }
+    return "unknown";
+}
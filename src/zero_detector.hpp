@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+
+namespace multifs
+{
+
+// Tells whether buffers hold zeros only, so that blocks of zeros written are left holes rather than stored
+class ZeroDetector
+{
+public:
+    // Instruction sets the kernels of the detector are implemented for
+    enum class Isa : uint8_t {
+        kScalar,
+        kSse2,
+        kAvx2,
+    };
+
+private:
+    Isa isa_;
+
+public:
+    explicit ZeroDetector(Isa isa = best_isa());
+
+    [[nodiscard]] Isa isa() const noexcept { return isa_; }
+
+    // Returns true if every byte of the buffer is zero, the scan stops at the first cache line holding any other byte
+    [[nodiscard]] bool zero(std::span<std::byte const> buf) const noexcept;
+
+    // Returns the most capable instruction set supported by the CPU
+    [[nodiscard]] static Isa best_isa() noexcept;
+    [[nodiscard]] static bool supported(Isa isa) noexcept;
+    [[nodiscard]] static std::string_view name(Isa isa) noexcept;
+};
+
+} // namespace multifs